@@ -1,6 +1,7 @@
 #include "DOM.h"
 #include "dom_attatchment.h"
 #include <cassert>
+#include <new>
 
 // Initialize the DOM
 void InitDOM(Arena* master_arena, DOM* target)
@@ -12,20 +13,32 @@ void InitDOM(Arena* master_arena, DOM* target)
     target->pointer_arrays = (Arena*)Alloc(master_arena, sizeof(Arena));
     target->elements = (Arena*)Alloc(master_arena, sizeof(Arena));
     target->attributes = (Arena*)Alloc(master_arena, sizeof(Arena));
+    target->override_styles = (Arena*)Alloc(master_arena, sizeof(Arena));
     target->frame_arena = (Arena*)Alloc(master_arena, sizeof(Arena));
     target->events = (Arena*)Alloc(master_arena, sizeof(Arena));
     
     *(target->static_cstrings) = CreateArena(sizeof(char)*100000, sizeof(char));
     *(target->cached_cstrings) = CreateArena(sizeof(char)*100000, sizeof(char));
-    *(target->dynamic_cstrings) = CreateArena(sizeof(char)*100000, sizeof(char));
+    *(target->dynamic_cstrings) = CreateArena(sizeof(char)*10000000, sizeof(char));
     *(target->strings) = CreateArena(sizeof(StringBlock)*1000000, sizeof(StringBlock));
     *(target->pointer_arrays) = CreateArena(sizeof(LinkedPointer)*10000, sizeof(LinkedPointer));
     *(target->elements) = CreateArena(sizeof(Element)*1000000, sizeof(Element));
     *(target->attributes) = CreateArena(sizeof(Attribute)*200000, sizeof(Attribute));
+    *(target->override_styles) = CreateArena(sizeof(InFlightStyle)*100000, sizeof(InFlightStyle));
     *(target->frame_arena) = CreateArena(sizeof(char)*10000000, sizeof(char));
-    *(target->events) = CreateArena(sizeof(Event)*1000000, sizeof(Event));
+    *(target->events) = CreateArena(sizeof(Event)*(EVENT_QUEUE_CAPACITY + 1), sizeof(Event));
     
-    target->max_events = 1000000;
+    target->live_element_count = 0;
+    new(&target->frame_requested) std::atomic<bool>(false);
+    
+    target->hover_chain = (Arena*)Alloc(master_arena, sizeof(Arena));
+    *(target->hover_chain) = CreateArena(sizeof(uint32_t)*100000, sizeof(uint32_t));
+    target->hit_grid = NULL;
+    
+    target->event_slots = (Event*)Alloc(target->events, sizeof(Event)*(EVENT_QUEUE_CAPACITY + 1));
+    ClearEvents(target);
+    memset(target->free_text_buffers, 0, sizeof(target->free_text_buffers));
+    memset(target->free_attribute_blocks, 0, sizeof(target->free_attribute_blocks));
 }
 
 #define bound_expr(expr_context, fn_type, expr_type, union_name)                                                  \
@@ -70,18 +83,38 @@ BoundExpression* GetBoundExpression(int id)
     return (BoundExpression*)runtime.bound_expressions->mapped_address + id;
 }
 
+uint32_t count_set_bits(uint32_t value)
+{
+    value = value - ((value >> 1) & 0x55555555);
+    value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+    return (((value + (value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
 Attribute* GetAttribute(Element* element, AttributeType searched_type)
 {
-    Attribute* curr = element->first_attribute;
-    while(curr)
+    uint32_t searched_bit = attribute_bit(searched_type);
+    if(!(element->attribute_mask & searched_bit))
     {
-        if(curr->type == searched_type)
+        return NULL;
+    }
+    
+    // Note(Leo): Attributes are sorted by type so with one of each type present the index is the number of lower types present
+    uint32_t index = count_set_bits(element->attribute_mask & (searched_bit - 1));
+    if(count_set_bits(element->attribute_mask) == (uint32_t)element->num_attributes)
+    {
+        return element->first_attribute + index;
+    }
+    
+    // Some type appears more than once, the searched one can only be further along
+    for(int i = index; i < element->num_attributes; i++)
+    {
+        if(element->first_attribute[i].type == searched_type)
         {
-            return curr;
+            return element->first_attribute + i;
         }
-        curr = curr->next_attribute;
     }
     
+    assert(false);
     return NULL;
 }
 
@@ -171,9 +204,37 @@ void DefaultStyle(InFlightStyle* target)
     target->font_id_p = DEFAULT_PRIORITY;
 }
 
-Attribute* convert_saved_attribute(DOM* dom, Compiler::Attribute* converted_attribute)
+Attribute* alloc_attribute_block(DOM* dom, int count)
+{
+    if(count < ATTRIBUTE_BLOCK_CLASS_COUNT && dom->free_attribute_blocks[count].next_free)
+    {
+        FreeBlock* reused = dom->free_attribute_blocks[count].next_free;
+        dom->free_attribute_blocks[count].next_free = reused->next_free;
+        return (Attribute*)reused;
+    }
+    
+    // Note(Leo): Not zeroed since tag_to_element writes every attribute in the block
+    return (Attribute*)Alloc(dom->attributes, count*sizeof(Attribute), no_zero());
+}
+
+void dealloc_attribute_block(DOM* dom, Attribute* block, int count)
+{
+    if(count < ATTRIBUTE_BLOCK_CLASS_COUNT)
+    {
+        FreeBlock* freed = (FreeBlock*)block;
+        freed->next_free = dom->free_attribute_blocks[count].next_free;
+        dom->free_attribute_blocks[count].next_free = freed;
+        return;
+    }
+    
+    for(int i = 0; i < count; i++)
+    {
+        dealloc_attribute_block(dom, block + i, 1);
+    }
+}
+
+void convert_saved_attribute(Compiler::Attribute* converted_attribute, Attribute* added)
 {
-    Attribute* added = (Attribute*)Alloc(dom->attributes, sizeof(Attribute), zero());
     added->type = (AttributeType)((int)converted_attribute->type);
     
     switch(added->type)
@@ -203,6 +264,7 @@ Attribute* convert_saved_attribute(DOM* dom, Compiler::Attribute* converted_attr
             added->Loop.array_binding = converted_attribute->Loop.array_binding;
             added->Loop.length_binding = converted_attribute->Loop.length_binding;
             added->Loop.template_id = converted_attribute->Loop.template_id;
+            added->Loop.key_binding = converted_attribute->Loop.key_binding;
             break;
         }
         case(AttributeType::THIS_ELEMENT):
@@ -214,6 +276,16 @@ Attribute* convert_saved_attribute(DOM* dom, Compiler::Attribute* converted_attr
         {
             break;
         }
+        case(AttributeType::BAKED_CLASS):
+        {
+            added->BakedClass.styles = GetClassStyles(converted_attribute->BakedClass.selector_ids[0]);
+            break;
+        }
+        case(AttributeType::VIRTUAL):
+        {
+            added->Virtual.row_height = converted_attribute->Virtual.row_height;
+            break;
+        }
         default:
             text_like:
             added->Text.binding_id = converted_attribute->Text.binding_id;
@@ -222,8 +294,6 @@ Attribute* convert_saved_attribute(DOM* dom, Compiler::Attribute* converted_attr
             added->Text.value_length = converted_attribute->Text.value_length;
             break;
     }
-    
-    return added;
 }
 
 bool CheckElementValid(Element* el)
@@ -238,18 +308,48 @@ bool CheckElementValid(Element* el)
         return false;
     }
     
-    Attribute* curr = el->first_attribute;
-    
-    while(curr)
+    uint32_t attribute_mask = 0;
+    for(int i = 0; i < el->num_attributes; i++)
     {
-        if(curr == curr->next_attribute)
+        if(i && el->first_attribute[i].type < el->first_attribute[i - 1].type)
         {
             return false;
         }
-        curr = curr->next_attribute;
+        attribute_mask |= attribute_bit(el->first_attribute[i].type);
     }
     
-    return true;
+    return attribute_mask == el->attribute_mask;
+}
+
+// Whether the attribute has to be re-evaluated every frame, even when nothing about the element has changed.
+bool attribute_is_bound(Attribute* attribute)
+{
+    switch(attribute->type)
+    {
+        case(AttributeType::CONDITION):
+        case(AttributeType::LOOP):
+        case(AttributeType::TICKING):
+        {
+            return true;
+        }
+        case(AttributeType::TEXT):
+        case(AttributeType::CLASS):
+        {
+            // Note(Leo): Static text only has to be re-evaluated when the style it inherits from its parent changes
+            return attribute->Text.binding_id != 0;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+// Note(Leo): Elements have to be allocated through here so the dom's live element count stays exact
+Element* alloc_element(DOM* dom)
+{
+    dom->live_element_count++;
+    return (Element*)Alloc(dom->elements, sizeof(Element), zero());
 }
 
 Element* tag_to_element(DOM* dom, Arena* element_arena, Compiler::Tag* converted_tag, Element* target_element = NULL)
@@ -268,27 +368,36 @@ Element* tag_to_element(DOM* dom, Arena* element_arena, Compiler::Tag* converted
     // Note(Leo): We could probably just setup a const/global instance which gets memcpy'd instead of creating the default 
     //            style for every element but it might not be much faster anyway...
     DefaultStyle(&added->working_style);
-    DefaultStyle(&added->override_style);
     
-    Attribute* prev_added_attribute = NULL;
-    Attribute* curr_added_attribute; 
+    if(added->num_attributes)
+    {
+        added->first_attribute = alloc_attribute_block(dom, added->num_attributes);
+    }
     
     for(int i = 0; i < added->num_attributes; i++)
     {
-        curr_added_attribute = convert_saved_attribute(dom, converted_tag->first_attribute + i);
-        if(prev_added_attribute)
+        // Note(Leo): Insertion sort by type, stable so attributes of the same type keep the order they were written in
+        Attribute converted = {};
+        convert_saved_attribute(converted_tag->first_attribute + i, &converted);
+        
+        int position = i;
+        while(position > 0 && added->first_attribute[position - 1].type > converted.type)
         {
-            prev_added_attribute->next_attribute = curr_added_attribute;
+            added->first_attribute[position] = added->first_attribute[position - 1];
+            position--;
         }
-        else // This is the first attribute
+        added->first_attribute[position] = converted;
+        added->attribute_mask |= attribute_bit(converted.type);
+        
+        if(attribute_is_bound(&converted))
         {
-            added->first_attribute = curr_added_attribute;
+            added->flags |= is_bound();
         }
-        
-        prev_added_attribute = curr_added_attribute;
-        
     }
     
+    // Note(Leo): New elements have to be evaluated at least once and their children have to be visited.
+    added->flags |= structure_dirty() | subtree_dirty();
+    
     assert(CheckElementValid(added));
     
     return added;
@@ -323,10 +432,14 @@ void* InstancePage(DOM* target_dom, int id)
     // Note(Leo): Should already be aligned to Element requirements
     // Using an arena to reserve all the required contiguous slots for elements in this page.
     // Required since otherwise instance component will interfere with our pointers by allocing components
-    void* page_elements_mem = Alloc(target_dom->elements, page_bin->file_info.tag_count*sizeof(Element));
-    Arena page_elements = CreateArenaWith(page_elements_mem, page_bin->file_info.tag_count*sizeof(Element), sizeof(Element));
+    // Note(Leo): Only the static tags get elements here, template tags follow them and are instanced by each.
+    int static_tag_count = page_bin->file_info.static_tag_count;
+    void* page_elements_mem = Alloc(target_dom->elements, static_tag_count*sizeof(Element));
+    target_dom->live_element_count += static_tag_count;
+    Arena page_elements = CreateArenaWith(page_elements_mem, static_tag_count*sizeof(Element), sizeof(Element));
     
     Compiler::Tag* tag_base = (Compiler::Tag*)page_bin->root_tag;
+    Compiler::Tag* static_tag_end = tag_base + static_tag_count;
     Element* element_base = (Element*)page_elements_mem;
     
     // Adding root element
@@ -337,7 +450,7 @@ void* InstancePage(DOM* target_dom, int id)
     added->master = created_page;
     curr++;
     
-    while(curr->tag_id)
+    while(curr != static_tag_end)
     {
         added = tag_to_element(target_dom, &page_elements, curr);
         added->parent = (Element*)get_pointer(tag_base, element_base, curr->parent);;
@@ -423,9 +536,10 @@ void* InstanceComponent(DOM* target_dom, Element* parent, int id)
     //  they are in the range 1 to num_tags + 1
     
     Compiler::Tag* curr = comp_bin->root_tag;
+    Compiler::Tag* static_tag_end = comp_bin->root_tag + comp_bin->file_info.static_tag_count;
     
     // Adding root element
-    Element* added = (Element*)Alloc(target_dom->elements, sizeof(Element), zero());
+    Element* added = (Element*)alloc_element(target_dom);
     element_addresses[curr->tag_id] = (void*)added;
     tag_to_element(target_dom, target_dom->elements, curr, added);
     added->master = added_comp;
@@ -442,7 +556,7 @@ void* InstanceComponent(DOM* target_dom, Element* parent, int id)
     added->next_sibling = NULL;
     
     // Pre allocate an address for the first child element of root
-    element_addresses[curr->first_child->tag_id] = (void*)Alloc(target_dom->elements, sizeof(Element), zero());
+    element_addresses[curr->first_child->tag_id] = (void*)alloc_element(target_dom);
     if(curr->first_child)
     {
         added->first_child = (Element*)(element_addresses[curr->first_child->tag_id]); 
@@ -452,9 +566,10 @@ void* InstanceComponent(DOM* target_dom, Element* parent, int id)
     curr++;
     
     // Allocates an element for the given tag id and puts the pointer in element_addresses 
-    #define PushElement(tag_id) element_addresses[tag_id] = Alloc(target_dom->elements, sizeof(Element), zero())
+    #define PushElement(tag_id) element_addresses[tag_id] = alloc_element(target_dom)
     
-    while(curr->tag_id)
+    // Note(Leo): Template tags come after the static ones and reuse their tag ids, so they must not be walked here
+    while(curr != static_tag_end)
     {
         // An address has already been allocated for this element
         if(element_addresses[curr->tag_id])
@@ -464,7 +579,7 @@ void* InstanceComponent(DOM* target_dom, Element* parent, int id)
         // Element has not had an address allocated yet, allocate one
         else
         {
-            added = (Element*)Alloc(target_dom->elements, sizeof(Element), zero());
+            added = (Element*)alloc_element(target_dom);
             element_addresses[curr->tag_id] = (void*)added;
         }
         
@@ -517,6 +632,8 @@ void* InstanceComponent(DOM* target_dom, Element* parent, int id)
     
     DeAllocScratch(element_addresses_unaligned);
     
+    MarkDirty(parent, structure_dirty() | subtree_dirty());
+    
     return added_comp;
 }
 
@@ -543,7 +660,7 @@ void InstanceTemplate(DOM* target_dom, Element* parent, void* array_ptr, int tem
     Compiler::Tag* curr = used_template->first_tag;
     
     // Adding first element
-    Element* added = (Element*)Alloc(target_dom->elements, sizeof(Element), zero());
+    Element* added = (Element*)alloc_element(target_dom);
     element_addresses[curr->tag_id] = (void*)added;
     tag_to_element(target_dom, target_dom->elements, curr, added);
     added->master = parent->master;
@@ -562,12 +679,12 @@ void InstanceTemplate(DOM* target_dom, Element* parent, void* array_ptr, int tem
     // Pre allocate an address for the child/sibling of the first element
     if(curr->first_child)
     {
-        element_addresses[curr->first_child->tag_id] = (void*)Alloc(target_dom->elements, sizeof(Element), zero());
+        element_addresses[curr->first_child->tag_id] = (void*)alloc_element(target_dom);
         added->first_child = (Element*)(element_addresses[curr->first_child->tag_id]); 
     }
     if(curr->next_sibling)
     {
-        element_addresses[curr->next_sibling->tag_id] = (void*)Alloc(target_dom->elements, sizeof(Element), zero());
+        element_addresses[curr->next_sibling->tag_id] = (void*)alloc_element(target_dom);
         added->next_sibling = (Element*)(element_addresses[curr->next_sibling->tag_id]); 
     }
     // Note(Leo): The last top level element should have the previous first child of EACH as its sibling
@@ -580,7 +697,7 @@ void InstanceTemplate(DOM* target_dom, Element* parent, void* array_ptr, int tem
     curr++;
     
     // Allocates an element for the given tag id and puts the pointer in element_addresses 
-    #define PushElement(tag_id) element_addresses[tag_id] = Alloc(target_dom->elements, sizeof(Element), zero())
+    #define PushElement(tag_id) element_addresses[tag_id] = alloc_element(target_dom)
     
     for(int i = 0; i < (used_template->tag_count - 1); i++)
     {
@@ -592,7 +709,7 @@ void InstanceTemplate(DOM* target_dom, Element* parent, void* array_ptr, int tem
         // Element has not had an address allocated yet, allocate one
         else
         {
-            added = (Element*)Alloc(target_dom->elements, sizeof(Element), zero());
+            added = (Element*)alloc_element(target_dom);
             element_addresses[curr->tag_id] = (void*)added;
         }
         
@@ -661,6 +778,204 @@ void InstanceTemplate(DOM* target_dom, Element* parent, void* array_ptr, int tem
     }
     
     DeAllocScratch(element_addresses_unaligned);
+    
+    MarkDirty(parent, structure_dirty() | subtree_dirty());
+}
+
+// Moves the elements of a kept each instance over to its new index/array
+void recontext_subtree(DOM* dom, Element* start, void* old_array, int old_index, void* new_array, int new_index)
+{
+    // Note(Leo): Instances of nested eaches have their own context so they stop the walk
+    if(start->context_master != old_array || start->context_index != old_index)
+    {
+        return;
+    }
+    
+    start->context_master = new_array;
+    start->context_index = new_index;
+    start->flags |= structure_dirty() | subtree_dirty();
+    
+    if(start->type == ElementType::EACH)
+    {
+        // Note(Leo): The nested array most likely came from the old index so it has to be fetched again
+        InvalidateEach(start, dom);
+        return;
+    }
+    
+    // Todo(Leo): This is a recursive approach which isnt ideal, replace it!
+    Element* curr = start->first_child;
+    while(curr)
+    {
+        recontext_subtree(dom, curr, old_array, old_index, new_array, new_index);
+        curr = curr->next_sibling;
+    }
+}
+
+int get_instance_key(Element* each, Attribute* loop, void* array_ptr, int index)
+{
+    if(!loop->Loop.key_binding)
+    {
+        return index;
+    }
+    
+    BoundExpression* binding = GetBoundExpression(loop->Loop.key_binding);
+    assert(binding->type == BoundExpressionType::INT_RET && binding->context == BindingContext::LOCAL);
+    
+    return binding->arr_stub_int(array_ptr, (void*)each->master, index);
+}
+
+struct each_instance
+{
+    Element* first;
+    Element* last;
+    bool kept;
+};
+
+// Note(Leo): Instances are created for the count indices of the array starting at first_index, which is only ever
+//            non-zero for virtual eaches.
+void ReconcileEach(DOM* dom, Element* each, Attribute* loop, void* array_ptr, int first_index, int count)
+{
+    assert(each->type == ElementType::EACH && loop->type == AttributeType::LOOP);
+    
+    int old_count = each->Each.instance_keys ? each->Each.last_count : 0;
+    int old_first = each->Each.first_index;
+    void* old_array = each->Each.array_ptr;
+    
+    // Split the current children into their instances, the top level elements of an instance are consecutive and share
+    // its index
+    void* instances_mem = AllocScratch((old_count + 1)*sizeof(each_instance), zero());
+    each_instance* instances = align_mem(instances_mem, each_instance);
+    
+    Element* curr = each->first_child;
+    while(curr)
+    {
+        int index = curr->context_index - old_first;
+        assert(index >= 0 && index < old_count);
+        
+        if(!instances[index].first)
+        {
+            instances[index].first = curr;
+        }
+        instances[index].last = curr;
+        
+        curr = curr->next_sibling;
+    }
+    
+    // Open addressing table of old key -> old index + 1
+    uint32_t table_size = 16;
+    while(table_size < (uint32_t)old_count*2)
+    {
+        table_size <<= 1;
+    }
+    uint32_t table_mask = table_size - 1;
+    
+    void* table_mem = AllocScratch((table_size + 1)*sizeof(int), zero());
+    int* table = align_mem(table_mem, int);
+    
+    for(int i = 0; i < old_count; i++)
+    {
+        uint32_t slot = ((uint32_t)each->Each.instance_keys[i] * 2654435761u) & table_mask;
+        while(table[slot])
+        {
+            slot = (slot + 1) & table_mask;
+        }
+        table[slot] = i + 1;
+    }
+    
+    int* new_keys = NULL;
+    if(count > 0 && array_ptr)
+    {
+        new_keys = (int*)malloc(count*sizeof(int));
+    }
+    else
+    {
+        count = 0;
+    }
+    
+    // Note(Leo): Children are detached and rebuilt backwards since both kept and new instances get prepended to the each
+    each->first_child = NULL;
+    for(int i = count - 1; i >= 0; i--)
+    {
+        int array_index = first_index + i;
+        int key = get_instance_key(each, loop, array_ptr, array_index);
+        new_keys[i] = key;
+        
+        // Find an unused old instance with the same key
+        each_instance* found = NULL;
+        int found_index = 0;
+        uint32_t slot = ((uint32_t)key * 2654435761u) & table_mask;
+        while(table[slot])
+        {
+            int candidate = table[slot] - 1;
+            if(each->Each.instance_keys[candidate] == key && !instances[candidate].kept && instances[candidate].first)
+            {
+                found = &instances[candidate];
+                found_index = candidate;
+                break;
+            }
+            slot = (slot + 1) & table_mask;
+        }
+        
+        if(!found)
+        {
+            InstanceTemplate(dom, each, array_ptr, loop->Loop.template_id, array_index);
+            continue;
+        }
+        
+        found->kept = true;
+        if(old_first + found_index != array_index || old_array != array_ptr)
+        {
+            Element* curr_top = found->first;
+            while(true)
+            {
+                recontext_subtree(dom, curr_top, old_array, old_first + found_index, array_ptr, array_index);
+                if(curr_top == found->last)
+                {
+                    break;
+                }
+                curr_top = curr_top->next_sibling;
+            }
+        }
+        
+        found->last->next_sibling = each->first_child;
+        each->first_child = found->first;
+    }
+    
+    // Whatever wasnt matched is gone from the array
+    for(int i = 0; i < old_count; i++)
+    {
+        if(instances[i].kept || !instances[i].first)
+        {
+            continue;
+        }
+        
+        Element* curr_top = instances[i].first;
+        while(true)
+        {
+            Element* next_top = curr_top->next_sibling;
+            bool is_last = curr_top == instances[i].last;
+            FreeSubtreeObjects(curr_top, dom);
+            if(is_last)
+            {
+                break;
+            }
+            curr_top = next_top;
+        }
+    }
+    
+    DeAllocScratch(table_mem);
+    DeAllocScratch(instances_mem);
+    
+    if(each->Each.instance_keys)
+    {
+        free(each->Each.instance_keys);
+    }
+    each->Each.instance_keys = new_keys;
+    each->Each.array_ptr = array_ptr;
+    each->Each.first_index = first_index;
+    each->Each.last_count = count;
+    
+    MarkDirty(each, structure_dirty() | subtree_dirty());
 }
 
 // Merge the members of the secondary in-flight style into the main style
@@ -773,19 +1088,126 @@ void FreeSubtreeObjects(Element* start, DOM* dom)
         free(start->master);
     }
     
+    if(start->type == ElementType::EACH && start->Each.instance_keys)
+    {
+        free(start->Each.instance_keys);
+        start->Each.instance_keys = NULL;
+    }
+    
     if(dom)
     {
-        Attribute* curr_attribute = start->first_attribute;
-        Attribute* last_attribute = NULL;
-        while(curr_attribute)
+        if(start->type == ElementType::TEXT && start->Text.stable_text)
         {
-            assert(curr_attribute != curr_attribute->next_attribute);
-            last_attribute = curr_attribute; 
-            curr_attribute = curr_attribute->next_attribute;
-            DeAlloc(dom->attributes, last_attribute);
+            DeAllocTextBuffer(dom, start->Text.stable_text, start->Text.stable_text_capacity);
         }
         
+        if(start->num_attributes)
+        {
+            dealloc_attribute_block(dom, start->first_attribute, start->num_attributes);
+        }
+        
+        if(start->override_style)
+        {
+            DeAlloc(dom->override_styles, start->override_style);
+            start->override_style = NULL;
+        }
+        
+        if(start->type == ElementType::EACH)
+        {
+            dom->layout_spacer_count -= EachSpacerCount(start);
+        }
+        
+        // Note(Leo): The hover chain can still hold this id, clearing the flags makes the runtime treat it as stale
+        start->flags = 0;
         DeAlloc(dom->elements, start);
+        dom->live_element_count--;
+    }
+}
+
+// Returns the size class that fits size bytes or -1 if it wont fit in any class
+int text_buffer_class(uint32_t size)
+{
+    uint32_t class_size = TEXT_BUFFER_MIN_SIZE;
+    for(int i = 0; i < TEXT_BUFFER_CLASS_COUNT; i++)
+    {
+        if(size <= class_size)
+        {
+            return i;
+        }
+        class_size <<= 1;
+    }
+    
+    return -1;
+}
+
+char* AllocTextBuffer(DOM* dom, uint32_t size, uint32_t* capacity)
+{
+    int size_class = text_buffer_class(size);
+    if(size_class < 0)
+    {
+        *capacity = 0;
+        return NULL;
+    }
+    
+    *capacity = TEXT_BUFFER_MIN_SIZE << size_class;
+    
+    FreeBlock* free_list = &dom->free_text_buffers[size_class];
+    if(free_list->next_free)
+    {
+        FreeBlock* reused = free_list->next_free;
+        free_list->next_free = reused->next_free;
+        return (char*)reused;
+    }
+    
+    return (char*)Alloc(dom->dynamic_cstrings, *capacity, no_zero());
+}
+
+void DeAllocTextBuffer(DOM* dom, char* buffer, uint32_t capacity)
+{
+    int size_class = text_buffer_class(capacity);
+    assert(size_class >= 0 && (uint32_t)(TEXT_BUFFER_MIN_SIZE << size_class) == capacity);
+    
+    // Note(Leo): Buffers are at least TEXT_BUFFER_MIN_SIZE so a FreeBlock always fits
+    FreeBlock* freed = (FreeBlock*)buffer;
+    freed->next_free = dom->free_text_buffers[size_class].next_free;
+    dom->free_text_buffers[size_class].next_free = freed;
+}
+
+void MarkDirty(Element* element, uint64_t dirty)
+{
+    if(!element)
+    {
+        return;
+    }
+    
+    element->flags |= dirty;
+    
+    // Note(Leo): Children can be added/removed between the tick and layout (OnFrame) so structure changes are
+    //            invalidated for layout right away instead of waiting for the element to be evaluated.
+    uint64_t parent_flags = subtree_dirty();
+    if(dirty & structure_dirty())
+    {
+        element->flags |= layout_dirty();
+        parent_flags |= layout_dirty();
+    }
+    
+    // Note(Leo): We cant stop early when a parent already has the flag since the tick clears it while walking down
+    Element* curr = element->parent;
+    while(curr)
+    {
+        curr->flags |= parent_flags;
+        curr = curr->parent;
+    }
+}
+
+void MarkLayoutDirty(Element* element)
+{
+    // Note(Leo): Hidden subtrees arent laid out so they keep their flag, we cant stop at a parent that already has it
+    Element* curr = element;
+    while(curr)
+    {
+        curr->flags |= layout_dirty();
+        curr = curr->parent;
     }
 }
 
@@ -794,50 +1216,331 @@ Element* GetFocused(DOM* dom)
     return dom->focused_element;
 }
 
+enum class EventPolicy
+{
+    QUEUE, // Always queued, dropped only if the ring is full
+    COALESCE, // Dropped if the last queued event of its type is still waiting to be popped and carries the same thing
+};
+
+EventPolicy get_event_policy(EventType type)
+{
+    switch(type)
+    {
+        // Note(Leo): Ticks and keyboard visibility only tell user code about state so duplicates carry nothing new
+        case(EventType::TICK):
+        case(EventType::VIRTUAL_KEYBOARD):
+        {
+            return EventPolicy::COALESCE;
+        }
+        default:
+        {
+            return EventPolicy::QUEUE;
+        }
+    }
+}
+
+Event* get_event_slot(DOM* dom, uint32_t index)
+{
+    return dom->event_slots + (index & (EVENT_QUEUE_CAPACITY - 1));
+}
+
+// Whether pending carries nothing that the queued event of the same type doesnt already
+bool event_coalesces(Event* queued, Event* pending)
+{
+    switch(pending->type)
+    {
+        case(EventType::TICK):
+        {
+            return queued->Tick.target == pending->Tick.target;
+        }
+        case(EventType::VIRTUAL_KEYBOARD):
+        {
+            return queued->VirtualKeyboard.isShown == pending->VirtualKeyboard.isShown;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
 Event* PushEvent(DOM* dom)
 {
     assert(dom);
-    if(dom->event_count + 1 > dom->max_events)
+    
+    // Note(Leo): Events that havent been popped yet are never evicted so when the ring is full the newest event is
+    //            dropped. It still gets somewhere to be written to so callers dont have to check.
+    if(dom->event_reserved - dom->event_released >= EVENT_QUEUE_CAPACITY)
     {
-        if(dom->last_event >= dom->max_events)
+        dom->dropped_events++;
+        Event* overflow = dom->event_slots + EVENT_QUEUE_CAPACITY;
+        memset(overflow, 0, sizeof(Event));
+        return overflow;
+    }
+    
+    Event* reserved = get_event_slot(dom, dom->event_reserved);
+    memset(reserved, 0, sizeof(Event));
+    dom->event_reserved++;
+    
+    return reserved;
+}
+
+void CommitEvents(DOM* dom)
+{
+    uint32_t read = dom->event_read;
+    
+    // Compacting the pending events in place while dropping the ones that coalesce
+    uint32_t kept = dom->event_write;
+    for(uint32_t i = dom->event_write; i != dom->event_reserved; i++)
+    {
+        Event* pending = get_event_slot(dom, i);
+        
+        if(get_event_policy(pending->type) == EventPolicy::COALESCE)
         {
-            dom->last_event = 0; // Circle back to evicting from the front
+            // Note(Leo): Only the last queued event of the same type is compared against, it only counts while it
+            //            hasnt been popped yet
+            uint32_t last = dom->last_coalescing[(int)pending->type];
+            if(last - read < kept - read && event_coalesces(get_event_slot(dom, last), pending))
+            {
+                continue;
+            }
+            
+            dom->last_coalescing[(int)pending->type] = kept;
         }
         
-        // Evict the oldest event to make space for the new one
-        DeAlloc(dom->events, (Event*)dom->events->mapped_address + dom->last_event);
-        dom->last_event++;
-        dom->event_count--;
+        if(kept != i)
+        {
+            memcpy(get_event_slot(dom, kept), pending, sizeof(Event));
+        }
+        kept++;
     }
     
-    // Note(Leo): This always works cos of the Arena's freelist
-    Event* created = (Event*)Alloc(dom->events, sizeof(Event), zero());
-    dom->event_count++;
-    return created;
+    dom->event_reserved = kept;
+    dom->event_write = kept;
 }
 
-// Note(Leo): Returns NULL if there are no more events
 Event* PopEvent(DOM* dom)
 {
-    if(dom->event_count == 0)
+    // Note(Leo): The event handed out last time is done with once the next one is asked for
+    dom->event_released = dom->event_read;
+    
+    if(dom->event_read == dom->event_write)
+    {
+        return NULL;
+    }
+    
+    Event* popped = get_event_slot(dom, dom->event_read);
+    dom->event_read++;
+    
+    return popped;
+}
+
+void ClearEvents(DOM* dom)
+{
+    dom->event_write = 0;
+    dom->event_read = 0;
+    dom->event_released = 0;
+    dom->event_reserved = 0;
+    dom->dropped_events = 0;
+    memset(dom->last_coalescing, 0, sizeof(dom->last_coalescing));
+}
+
+// Note(Leo): Compacting touches every live element so its only worth it once holes outnumber them
+#define DOM_COMPACT_MIN_HOLES 4096
+
+bool ShouldCompactElements(DOM* dom)
+{
+    uint32_t span = (uint32_t)((dom->elements->next_address - dom->elements->mapped_address) / sizeof(Element));
+    uint32_t holes = span - dom->live_element_count;
+    
+    return holes >= DOM_COMPACT_MIN_HOLES && holes > dom->live_element_count;
+}
+
+Element* relocated_element(Element* base, uint32_t* new_index, Element* old)
+{
+    if(!old)
     {
-        ResetArena(dom->events);
         return NULL;
     }
+    
+    assert(new_index[old - base] != UINT32_MAX);
+    return base + new_index[old - base];
+}
 
-    // Todo(Leo): Fix this by changing it to a circular buffer instead of an arena thing.
-    // Note(Leo): This is a really silly way of popping of the start of the arena to get events in-order
-    Event* popped = (Event*)dom->events->next_address - dom->event_count;
+bool CompactElements(DOM* dom)
+{
+    Element* base = (Element*)dom->elements->mapped_address;
+    uint32_t span = (uint32_t)((dom->elements->next_address - dom->elements->mapped_address) / sizeof(Element));
+    if(!span)
+    {
+        return false;
+    }
+    
+    // Note(Leo): Compaction is rare enough that its working memory gets its own mapping instead of living in the dom
+    Arena compact_arena = CreateArena((span + 1)*(sizeof(uint32_t) + sizeof(bool)) + sizeof(uint32_t), sizeof(uint32_t));
+    uint32_t* new_index = (uint32_t*)Alloc(&compact_arena, span*sizeof(uint32_t), no_zero());
+    bool* moved = (bool*)Alloc(&compact_arena, span*sizeof(bool), zero());
+    memset(new_index, 0xFF, span*sizeof(uint32_t));
+    
+    // Depth first walk from the page root to give each live element its new index
+    uint32_t next_index = 0;
+    Element* curr = base;
+    while(curr)
+    {
+        new_index[curr - base] = next_index;
+        next_index++;
+        
+        if(curr->first_child)
+        {
+            curr = curr->first_child;
+            continue;
+        }
+        
+        while(curr && !curr->next_sibling)
+        {
+            curr = curr->parent;
+        }
+        if(curr)
+        {
+            curr = curr->next_sibling;
+        }
+    }
+    
+    // Note(Leo): Anything live that isnt in the tree would lose its slot so leave everything where it is.
+    //            Every instance path keeps live_element_count in step with the tree so this means a count is broken.
+    if(next_index != dom->live_element_count)
+    {
+        printf("Error while compacting elements, %u reachable but %u live. Compaction skipped\n", next_index, dom->live_element_count);
+        FreeArena(&compact_arena);
+        return false;
+    }
+    
+    // Fix up pointers while everything is still in its old slot
+    for(uint32_t i = 0; i < span; i++)
+    {
+        if(new_index[i] == UINT32_MAX)
+        {
+            continue;
+        }
+        
+        Element* element = base + i;
+        element->parent = relocated_element(base, new_index, element->parent);
+        element->next_sibling = relocated_element(base, new_index, element->next_sibling);
+        element->first_child = relocated_element(base, new_index, element->first_child);
+        element->id = (int)new_index[i];
+        
+        // Note(Leo): The last layouts refer to elements by their old ids so they cant be used anymore
+        element->last_sizing = NULL;
+        
+        // Component roots are the only element their component's custom_element is fixed up through
+        if(element->type == ElementType::ROOT && element->parent && element->master)
+        {
+            Component* component = (Component*)element->master;
+            component->custom_element = relocated_element(base, new_index, component->custom_element);
+        }
+    }
+    
+    dom->focused_element = relocated_element(base, new_index, dom->focused_element);
+    
+    for(uint32_t i = dom->event_released; i != dom->event_reserved; i++)
+    {
+        Event* pending = get_event_slot(dom, i);
+        switch(pending->type)
+        {
+            case(EventType::FOCUSED):
+            {
+                pending->Focused.target = relocated_element(base, new_index, pending->Focused.target);
+                break;
+            }
+            case(EventType::DE_FOCUSED):
+            {
+                pending->DeFocused.target = relocated_element(base, new_index, pending->DeFocused.target);
+                break;
+            }
+            case(EventType::TICK):
+            {
+                pending->Tick.target = relocated_element(base, new_index, pending->Tick.target);
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+    }
     
-    void* allocated = Alloc(dom->frame_arena, sizeof(Event)*2);
-    Event* copied = align_mem(allocated, Event);
-    memcpy(copied, popped, sizeof(Event));
+    // Note(Leo): Hover chain entries for elements that were free-ed would alias live elements after this so they go
+    uint32_t* hover_ids = (uint32_t*)dom->hover_chain->mapped_address;
+    uint32_t hover_count = (dom->hover_chain->next_address - dom->hover_chain->mapped_address)/sizeof(uint32_t);
+    uint32_t kept_hovers = 0;
+    for(uint32_t i = 0; i < hover_count; i++)
+    {
+        if(hover_ids[i] < span && new_index[hover_ids[i]] != UINT32_MAX)
+        {
+            hover_ids[kept_hovers] = new_index[hover_ids[i]];
+            kept_hovers++;
+        }
+    }
+    dom->hover_chain->next_address = dom->hover_chain->mapped_address + kept_hovers*sizeof(uint32_t);
+    dom->hit_grid = NULL;
     
-    DeAlloc(dom->events, popped);
-    dom->event_count--;
-    dom->last_event = dom->event_count;
+    // Move every element into its new slot by following the cycles of the permutation, holes are where cycles end
+    for(uint32_t i = 0; i < span; i++)
+    {
+        if(new_index[i] == UINT32_MAX || moved[i])
+        {
+            continue;
+        }
+        
+        Element carried = base[i];
+        uint32_t curr_slot = i;
+        while(true)
+        {
+            moved[curr_slot] = true;
+            uint32_t destination = new_index[curr_slot];
+            
+            if(new_index[destination] != UINT32_MAX && !moved[destination])
+            {
+                Element displaced = base[destination];
+                base[destination] = carried;
+                carried = displaced;
+                curr_slot = destination;
+            }
+            else
+            {
+                base[destination] = carried;
+                break;
+            }
+        }
+    }
+    
+    // Note(Leo): The free list pointed into what are now live elements
+    dom->elements->first_free = {};
+    dom->elements->next_address = dom->elements->mapped_address + dom->live_element_count*sizeof(Element);
+    TrimArena(dom->elements, dom->live_element_count*sizeof(Element));
     
-    return copied;
+    FreeArena(&compact_arena);
+    
+    // Hand out the moved elements again to user code that asked for them
+    for(uint32_t i = 0; i < dom->live_element_count; i++)
+    {
+        Element* element = base + i;
+        Attribute* curr_attribute = GetAttribute(element, AttributeType::THIS_ELEMENT);
+        if(curr_attribute && curr_attribute->This.is_initialized)
+        {
+            BoundExpression* binding = GetBoundExpression(curr_attribute->This.binding_id);
+            if(binding->context == BindingContext::GLOBAL)
+            {
+                binding->stub_ptr((void*)element->master, (void*)element);
+            }
+            else
+            {
+                binding->arr_stub_ptr((void*)element->context_master, element->context_index, (void*)element);
+            }
+        }
+    }
+    
+    return true;
 }
 
 void RouteEvent(void* master, Event* event)
@@ -851,87 +1554,116 @@ void RouteEvent(void* master, Event* event)
     call_comp_event(((ElementMaster*)master)->master_dom, event, ((ElementMaster*)master)->file_id, master);
 }
 
+// Gets the element's override style, giving it one if it doesnt have one yet
+InFlightStyle* get_override_style(Element* element)
+{
+    if(!element->override_style)
+    {
+        DOM* dom = ((ElementMaster*)element->master)->master_dom;
+        element->override_style = (InFlightStyle*)Alloc(dom->override_styles, sizeof(InFlightStyle), no_zero());
+        DefaultStyle(element->override_style);
+    }
+    
+    return element->override_style;
+}
+
 // Convenience methods for setting style overrides
 void SetColor(Element* element, StyleColor color)
 {
-    element->override_style.color = color;
-    element->override_style.color_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->color = color;
+    override_style->color_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetTextColor(Element* element, StyleColor color)
 {
-    element->override_style.text_color = color;
-    element->override_style.text_color_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->text_color = color;
+    override_style->text_color_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetMarginL(Element* element, Measurement sizing)
 {
-    element->override_style.margin.left = sizing;
-    element->override_style.margin_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->margin.left = sizing;
+    override_style->margin_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetMarginR(Element* element, Measurement sizing)
 {
-    element->override_style.margin.right = sizing;
-    element->override_style.margin_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->margin.right = sizing;
+    override_style->margin_p = 100;
+    MarkDirty(element, override_dirty());
 }
 void SetMarginT(Element* element, Measurement sizing)
 {
-    element->override_style.margin.top = sizing;
-    element->override_style.margin_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->margin.top = sizing;
+    override_style->margin_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetMarginB(Element* element, Measurement sizing)
 {
-    element->override_style.margin.bottom = sizing;
-    element->override_style.margin_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->margin.bottom = sizing;
+    override_style->margin_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetMargin(Element* element, Margin margin)
 {
-    element->override_style.margin = margin;
-    element->override_style.margin_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->margin = margin;
+    override_style->margin_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetHeight(Element* element, Measurement sizing)
 {
-    element->override_style.height = sizing;
-    element->override_style.height_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->height = sizing;
+    override_style->height_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetWidth(Element* element, Measurement sizing)
 {
-    element->override_style.width = sizing;
-    element->override_style.width_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->width = sizing;
+    override_style->width_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetFont(Element* element, FontHandle font)
 {
-    element->override_style.font_id = font;
-    element->override_style.font_id_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->font_id = font;
+    override_style->font_id_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void SetFontSize(Element* element, uint16_t sizing)
 {
-    element->override_style.font_size = sizing;
-    element->override_style.font_size_p = 100;
-    element->do_override_style = true;
+    InFlightStyle* override_style = get_override_style(element);
+    override_style->font_size = sizing;
+    override_style->font_size_p = 100;
+    MarkDirty(element, override_dirty());
 }
 
 void ClearOverrideStyle(Element* element)
 {
-    DefaultStyle(&element->override_style);
-    element->do_override_style = false;
+    if(element->override_style)
+    {
+        DOM* dom = ((ElementMaster*)element->master)->master_dom;
+        DeAlloc(dom->override_styles, element->override_style);
+        element->override_style = NULL;
+    }
+    MarkDirty(element, override_dirty());
 }
 
 void InvalidateEach(Element* element, DOM* dom)
@@ -942,6 +1674,9 @@ void InvalidateEach(Element* element, DOM* dom)
     }
     
     element->Each.last_count = 0;
+    element->Each.first_index = 0;
+    element->Each.total_count = 0;
+    SetEachSpace(dom, element, 0.0f, 0.0f);
     
     // Remove old array elements
     if(element->first_child)
@@ -961,4 +1696,21 @@ void InvalidateEach(Element* element, DOM* dom)
         
         element->first_child = NULL;
     }
+    
+    MarkDirty(element, structure_dirty() | subtree_dirty());
+}
+
+uint32_t EachSpacerCount(Element* each)
+{
+    return (each->Each.leading_space != 0.0f) + (each->Each.trailing_space != 0.0f);
+}
+
+void SetEachSpace(DOM* dom, Element* each, float leading_space, float trailing_space)
+{
+    assert(each->type == ElementType::EACH);
+    
+    dom->layout_spacer_count -= EachSpacerCount(each);
+    each->Each.leading_space = leading_space;
+    each->Each.trailing_space = trailing_space;
+    dom->layout_spacer_count += EachSpacerCount(each);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <cstring>
 #include <map>
+#include <atomic>
 
 #include "file_system.h"
 #include "arena.h"
@@ -16,6 +17,19 @@
 #define is_clicked() (uint64_t)(1 << 3)
 #define is_focusable() (uint64_t)(1 << 4)
 
+// Dirty tracking flags, elements that are clean (and arent under the cursor) are not re-evaluated each frame.
+// Note(Leo): Bindings can change at any point without us knowing so elements with bound attributes are always evaluated.
+#define is_bound() (uint64_t)(1 << 5) // Element has attributes that have to be evaluated every frame (bindings, ticking, ...)
+#define hover_dirty() (uint64_t)(1 << 6)
+#define click_dirty() (uint64_t)(1 << 7)
+#define override_dirty() (uint64_t)(1 << 8)
+#define structure_dirty() (uint64_t)(1 << 9) // Element was just instanced or had its children changed
+#define subtree_dirty() (uint64_t)(1 << 10) // Some element below this one needs to be visited
+#define static_text() (uint64_t)(1 << 11) // Text.temporal_text points at an attribute's static value instead of the frame arena
+#define in_hover_query() (uint64_t)(1 << 12) // Only set while the runtime diffs the elements under the cursors
+#define layout_dirty() (uint64_t)(1 << 13) // Something layout depends on changed in this subtree since it was last laid out
+#define dirty_flags() (hover_dirty() | click_dirty() | override_dirty() | structure_dirty())
+
 // Aligns the given pointer to where the type wants it to start in memory
 // Note(Leo): GCC doesnt need decltype inside of alignof but msvc does and will error otherwise
 #define align_mem(ptr, type) (type*)((uintptr_t)ptr + alignof(type) - ((uintptr_t)ptr % alignof(type)))
@@ -52,8 +66,24 @@ struct PageSwitchRequest
 };
 
 struct Element;
+struct Event;
 struct PlatformControlState;
 
+// Note(Leo): Text buffers on dynamic_cstrings are handed out in power of 2 size classes starting at TEXT_BUFFER_MIN_SIZE
+//            so they can be recycled through a free list per class. Text larger than the biggest class stays on the frame arena.
+#define TEXT_BUFFER_MIN_SIZE 32
+#define TEXT_BUFFER_CLASS_COUNT 12
+
+// Note(Leo): An element's attributes are one block on the attributes arena, blocks are recycled through a free list per
+//            attribute count. Blocks bigger than the last class are given back one attribute at a time to the 1 class.
+#define ATTRIBUTE_BLOCK_CLASS_COUNT 8
+
+// Note(Leo): Has to be a power of 2 so ring indices can wrap with a mask
+#define EVENT_QUEUE_CAPACITY 65536
+#define EVENT_TYPE_COUNT 8
+
+struct HitTestGrid;
+
 struct DOM
 {
     Arena* static_cstrings;
@@ -64,21 +94,41 @@ struct DOM
     Arena* pointer_arrays;
     
     Arena* elements;
+    uint32_t live_element_count; // Exact number of elements in use, the elements arena can have free-ed holes in it
+    uint32_t layout_spacer_count; // Spacers the virtual eaches lay out on top of the live elements, see SetEachSpace
+    Arena* override_styles; // Only the few elements that have their style overriden by user code get one
     Arena* attributes;
 
     Arena* events;
     
     PlatformControlState* controls;
     
-    uint32_t event_count;
-    uint32_t max_events;
-    uint32_t last_event; // Used to keep track of where the last event was popped from
+    // Note(Leo): Events are a ring that only the thread ticking the dom touches. Both the platform (input while polling)
+    //            and the runtime (ticks and focus changes) push into it. Indices only ever count up and are masked to
+    //            find their slot.
+    Event* event_slots; // EVENT_QUEUE_CAPACITY slots followed by 1 overflow slot that is handed out when the ring is full
+    uint32_t event_write; // End of the events visible to PopEvent
+    uint32_t event_read; // Next event PopEvent will hand out
+    uint32_t event_released; // Slots before this can be reused by PushEvent
+    uint32_t event_reserved; // Slots from event_write up to this are pushed but not committed yet
+    uint32_t dropped_events; // Events that didnt fit in the ring
+    uint32_t last_coalescing[EVENT_TYPE_COUNT]; // Slot of the last committed event of each coalescing type
     
     Arena* frame_arena; // Composted every frame
     
     Element* focused_element;
     
     PageSwitchRequest switch_request;
+    
+    FreeBlock free_text_buffers[TEXT_BUFFER_CLASS_COUNT];
+    FreeBlock free_attribute_blocks[ATTRIBUTE_BLOCK_CLASS_COUNT]; // Indexed by the number of attributes in the block
+    
+    // Note(Leo): The hit grid lives in the shape arena of the last layout so it is only valid until the next one.
+    HitTestGrid* hit_grid;
+    Arena* hover_chain; // Ids of the elements that were under any cursor last frame
+    
+    // Note(Leo): Set from any thread through RequestFrame. The dom is zeroed arena memory so InitDOM constructs it.
+    std::atomic<bool> frame_requested; // Something needs the dom to be ticked again even if there is no input
 };
 
 struct ElementMaster 
@@ -107,6 +157,8 @@ enum class EventType
     TICK,
 };
 
+static_assert((int)EventType::TICK + 1 == EVENT_TYPE_COUNT, "EVENT_TYPE_COUNT has to be one past the last EventType");
+
 struct Event
 {
     EventType type;
@@ -154,6 +206,8 @@ struct Runtime
     Arena* static_combined_values;
     Arena* bound_expressions;
     
+    Arena* type_styles; // FileTypeStyles indexed by file id
+    Arena* class_styles; // SelectorVariants of baked classes indexed by the class's selector id
 };
 
 typedef Compiler::MeasurementType MeasurementType;
@@ -235,6 +289,8 @@ ON_FOCUS,
 FOCUSABLE,
 ID,
 TICKING, // The runtime sends an event every frame to "tick" this element
+BAKED_CLASS, // Single selector class resolved at compile time
+VIRTUAL, // Each only instances the rows visible in its parent
 };
 
 struct attr_comp_id_body 
@@ -268,6 +324,7 @@ struct attr_loop_body
     int array_binding;
     int length_binding;
     int template_id;
+    int key_binding; // Optional, 0 if the each is keyed by index
 };
 
 struct attr_text_like_body
@@ -277,6 +334,7 @@ struct attr_text_like_body
     int binding_position;
     int binding_id;
     bool is_cached;
+    uint32_t text_key; // Text cache key of the static value, computed the first time it gets shaped
 };
 
 struct attr_args_body
@@ -284,9 +342,24 @@ struct attr_args_body
     int binding_id;  
 };
 
+struct SelectorVariants;
+
+struct attr_baked_class_body
+{
+    SelectorVariants* styles; // Resolved from the class's selector id when the attribute is created
+};
+
+struct attr_virtual_body
+{
+    float row_height; // 0 if estimated
+};
+
+#define attribute_bit(attribute_type) ((uint32_t)1 << (int)(attribute_type))
+// Note(Leo): Element::attribute_mask has one bit per type, widen it before adding a 33rd type
+static_assert((int)AttributeType::VIRTUAL < 32, "AttributeType no longer fits in attribute_mask");
+
 struct Attribute
 {
-    Attribute* next_attribute;
     AttributeType type;
     
     union 
@@ -299,6 +372,8 @@ struct Attribute
         attr_condition_body Condition;
         attr_loop_body Loop;
         attr_args_body Args;
+        attr_baked_class_body BakedClass;
+        attr_virtual_body Virtual;
     };
 };
 
@@ -316,6 +391,32 @@ enum class ElementType
     EACH,
 };
 
+#define ELEMENT_TYPE_COUNT ((int)ElementType::EACH + 1)
+
+// States that a selector can have a variant for (hdiv, hdiv!hover, hdiv!mousedown)
+enum class SelectorState
+{
+    NORMAL,
+    HOVER,
+    MOUSEDOWN,
+    COUNT,
+};
+
+// Note(Leo): Merged styles of a selector and its state variants. Each state is pre-merged with the states before it
+//            (an element with mouse down on it is also hovered) so evaluating an element only needs one merge.
+struct SelectorVariants
+{
+    InFlightStyle styles[(int)SelectorState::COUNT];
+    bool has_style[(int)SelectorState::COUNT];
+};
+
+// Type selector styles of a file resolved once at load time so that evaluating an element's type style is just an
+// index instead of building and looking up the selector's name.
+struct FileTypeStyles
+{
+    SelectorVariants types[ELEMENT_TYPE_COUNT];
+};
+
 struct LoadedImageHandle;
 
 struct size_axis
@@ -381,10 +482,21 @@ enum class LayoutElementType
     TEXT,
     TEXT_COMBINED,
     IMAGE,
+    SPACER, // Fixed size gap that stands in for the instances a virtual each left out, it is never drawn
     END,
 };
 
 struct FontPlatformShapedGlyph;
+struct FontPlatformShapedLine;
+
+// Note(Leo): Fixed size subtrees that havent changed since the last layout are relayout boundaries, their children are
+//            copied from the last layout instead of being unpacked and shaped again.
+enum class LayoutCache
+{
+    NONE,
+    BOUNDARY, // Sized normally but its children come from the last layout
+    COPIED, // Copied from the last layout along with its sizing
+};
 
 struct LayoutElement
 {
@@ -400,6 +512,10 @@ struct LayoutElement
     LayoutElement* children;
     uint16_t child_count;
     
+    LayoutCache cache;
+    uint32_t generation; // Which layout of the dom this was produced by
+    bool split_off; // The subtree is laid out on the job pool so the main loop skips it
+    
     union 
     {
         struct
@@ -416,11 +532,16 @@ struct LayoutElement
             uint16_t font_size;     
             uint32_t text_length;
             char* text_content;
+            uint32_t text_key; // Text cache key precomputed by the runtime, 0 if the shaper should hash the text itself
         } TEXT;
         struct
         {
             FontPlatformShapedGlyph* first_glyph;
             uint32_t glyph_count;
+            FontPlatformShapedLine* first_line;
+            uint32_t line_count;
+            uint32_t* buffer_order;
+            uint32_t buffer_glyph_count;
         } TEXT_COMBINED;
         struct 
         {
@@ -430,6 +551,27 @@ struct LayoutElement
     };
 };
 
+// Note(Leo): Hit test grid emitted by the final layout pass. Visible elements are listed in every cell their bounds 
+//            overlap, in draw order, so finding what is under a cursor only has to look at one cell.
+#define HIT_TEST_CELL_SIZE 128
+
+struct HitTestEntry
+{
+    bounding_box bounds;
+    uint32_t element_id;
+};
+
+struct HitTestGrid
+{
+    HitTestEntry* entries;
+    uint32_t entry_count;
+    
+    uint32_t* cell_offsets; // Where each cell starts in cell_entries, has one extra offset for the end of the last cell
+    uint32_t* cell_entries; // Indices into entries
+    uint16_t columns;
+    uint16_t rows;
+};
+
 enum class ClickState
 {
     NONE, // Element has no current click state
@@ -438,31 +580,34 @@ enum class ClickState
 
 struct Element 
 {
-    void* master;
-    void* context_master;
+    // Note(Leo): What the dom walk touches for every element is kept at the front so it fits in one cache line, 
+    //            everything after it is only read for elements the walk actually evaluates or lays out.
     uint64_t flags;
-    
-    int id;
-    int global_id; // From the Id attribute.
-    int context_index; // For keeping track of which index in an each element spawned this element.
     ElementType type;
-    ClickState click_state;
-    
-    // Note(Leo): Attributes are not contiguous in memory
-    Attribute* first_attribute;
-    int num_attributes;
+    int id;
     
     Element* parent;
     Element* next_sibling;
     Element* first_child;
     
+    // Note(Leo): Attributes are contiguous and sorted by type, attribute_mask has a bit set for each type present
+    Attribute* first_attribute;
+    void* master;
+    uint32_t attribute_mask;
+    int num_attributes;
+    
+    void* context_master;
+    int global_id; // From the Id attribute.
+    int context_index; // For keeping track of which index in an each element spawned this element.
+    ClickState click_state;
+    
     LayoutElement* last_sizing;
+    uint64_t layout_fingerprint; // Hash of the evaluated state that the layout of this element depends on
     
     // In Flight Vars
     InFlightStyle working_style;
     
-    InFlightStyle override_style;
-    bool do_override_style;
+    InFlightStyle* override_style; // ---> dom override styles, NULL until something overrides the element's style
     
     struct
     {
@@ -473,9 +618,18 @@ struct Element
     union
     {
         struct {
-            // Note(Leo): temporal since its on the frame arena
+            // Note(Leo): temporal since its on the frame arena (or points at stable_text for bound text and at the 
+            //            attribute's static value if the static_text() flag is set)
             char* temporal_text;
             uint32_t temporal_text_length;
+            
+            // Note(Leo): Bound text keeps its last output in stable_text so an unchanged binding can skip the copy and 
+            //            the shaper can skip hashing/looking up the text in its cache.
+            uint64_t fingerprint; // Hash + length of the last binding output
+            char* stable_text;
+            uint32_t stable_text_capacity;
+            uint32_t text_key; // Text cache key for stable_text
+            uint32_t shaped_handle; // Text cache handle stable_text was last shaped into, may be stale
         } Text;
         struct 
         {
@@ -494,8 +648,17 @@ struct Element
         } Grid;
         struct {
             Compiler::Tag* inner_template;
-            int last_count;
+            int last_count; // Number of instances
             void* array_ptr;
+            int* instance_keys; // Key of each of the last_count instances (malloc'ed)
+            
+            int first_index; // Array index of the first instance
+            int total_count; // Length of the array when it was last reconciled
+            // Note(Leo): Virtual eaches only instance a window of the array, the space of the instances before and after
+            //            it gets laid out as a spacer on either side of the window. Set through SetEachSpace.
+            float row_height; // Fixed or estimated size of an instance along its parent's direction
+            float leading_space;
+            float trailing_space;
         } Each;
     };
 };
@@ -603,12 +766,20 @@ Selector* GetSelectorFromName(const char* name);
 
 Style* GetStyleFromID(int style_id);
 
+// Returns the type selector styles resolved for the given file, NULL if the file has none
+FileTypeStyles* GetFileTypeStyles(int file_id);
+
+// Returns the merged styles of a baked class, NULL if the selector was never baked
+SelectorVariants* GetClassStyles(int selector_id);
+
 Element* CreateElement(DOM* dom, SavedTag* tag_template);
 
 void InitDOM(Arena* master_arena, DOM* target);
 
 void ConvertSelectors(Compiler::Selector* selector);
 void ConvertStyles(Compiler::Style* style);
+void ConvertTypeStyles(int file_id);
+void ConvertClassStyles(Compiler::Attribute* baked_class);
 
 // Merge the members of the secondary in-flight style into the main style
 void MergeStyles(InFlightStyle* main, InFlightStyle* secondary);
@@ -633,13 +804,25 @@ void* InstancePage(DOM* target_dom, int id);
 void* InstanceComponent(DOM* target_dom, Element* parent, int id);
 
 void InstanceTemplate(DOM* target_dom, Element* parent, void* array_ptr, int template_id, int index);
+// Brings the instances of an each up to date with a new array, instances whose key is still in the array are kept
+void ReconcileEach(DOM* dom, Element* each, Attribute* loop, void* array_ptr, int first_index, int count);
 
 void* AllocPage(DOM* dom, int size, int file_id);
 
 void* AllocComponent(DOM* dom, int size, int file_id);
 
+// Note(Leo): PushEvent hands out a zeroed slot to fill in, it only becomes visible to PopEvent once CommitEvents is
+//            called. The queue isnt synchronized, everything has to happen on the thread that ticks the dom.
 Event* PushEvent(DOM* dom);
+void CommitEvents(DOM* dom);
+// Note(Leo): Returns a pointer into the ring that is valid until the next call to PopEvent, NULL once drained.
 Event* PopEvent(DOM* dom);
+// Empties the queue
+void ClearEvents(DOM* dom);
+
+// Note(Leo): The platform stops ticking a dom once it has no input and its output stops changing. Anything that changes
+//            state outside of events (timers, other threads...) has to call this for the change to show up.
+void RequestFrame(DOM* dom);
 
 // Route an event to a component object to be handled
 void RouteEvent(void* master, Event* event);
@@ -660,6 +843,21 @@ void RuntimeClearTemporal(DOM* target);
 // Optionally DeAlloc's all the elements/attributes that are encountered aswell
 void FreeSubtreeObjects(Element* start, DOM* dom = NULL); // If DOM is given then elements are DeAlloc'ed
 
+// Note(Leo): Moves the live elements to the front of the elements arena in depth first order and gives them their new
+//            index as their id. Only safe between frames, pointers user code got through THIS_ELEMENT bindings are 
+//            handed out again but any other Element* held outside of the dom goes stale. 
+bool ShouldCompactElements(DOM* dom);
+bool CompactElements(DOM* dom); // Returns whether the elements were moved
+
+// Sets the given dirty flags on the element and flags all of its parents so that the next tick visits it
+void MarkDirty(Element* element, uint64_t dirty);
+// Flags the element and its parents so the layout of the subtree isnt reused
+void MarkLayoutDirty(Element* element);
+
+// Get a buffer of at least size bytes from the dom's text buffers, returns NULL if size is larger than the largest class
+char* AllocTextBuffer(DOM* dom, uint32_t size, uint32_t* capacity);
+void DeAllocTextBuffer(DOM* dom, char* buffer, uint32_t capacity);
+
 // Convenience methods for setting style overrides
 void SetColor(Element* element, StyleColor color);
 void SetTextColor(Element* element, StyleColor color);
@@ -673,4 +871,6 @@ void SetWidth(Element* element, Measurement sizing);
 void SetFont(Element* element, FontHandle font);
 void SetFontSize(Element* element, uint16_t size);
 void SetScroll(Element* element, float vertical, float horizontal);
-void InvalidateEach(Element* element, DOM* dom); // Clears children and flags the each to have them re-created
\ No newline at end of file
+void InvalidateEach(Element* element, DOM* dom); // Clears children and flags the each to have them re-created
+void SetEachSpace(DOM* dom, Element* each, float leading_space, float trailing_space); // Keeps the dom's spacer count exact
+uint32_t EachSpacerCount(Element* each); // How many spacers the each adds to the layout
\ No newline at end of file
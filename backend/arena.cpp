@@ -197,6 +197,20 @@ void ResetArena(Arena* arena)
     arena->first_free = {};
 }
 
+void TrimArena(Arena* arena, int kept_size)
+{
+    uintptr_t trim_start = (arena->mapped_address + kept_size + WINDOWS_PAGE_MASK) & ~WINDOWS_PAGE_MASK;
+    assert(arena->next_address <= trim_start);
+    
+    // Note(Leo): Keep the first page committed like CreateArena does
+    trim_start = trim_start > arena->mapped_address ? trim_start : arena->mapped_address + WINDOWS_PAGE_SIZE;
+    if(trim_start < arena->furthest_committed)
+    {
+        VirtualFree((void*)trim_start, arena->furthest_committed - trim_start, MEM_DECOMMIT);
+        arena->furthest_committed = trim_start;
+    }
+}
+
 void FreeArena(Arena* arena)
 {
     VirtualFree((void*)arena->mapped_address, arena->size, MEM_RELEASE);
@@ -208,6 +222,7 @@ void FreeArena(Arena* arena)
 #elif defined(__linux__) && !defined(_WIN32)
 // Unix definitions for memory management
 #include <sys/mman.h>
+#include <unistd.h>
 Arena CreateArena(int reserved_size, int alloc_size, uint64_t flags)
 {
     Arena newArena = Arena(mmap(NULL, reserved_size,  PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, 0, 0), reserved_size, alloc_size, flags);
@@ -272,6 +287,20 @@ void ResetArena(Arena* arena)
     arena->first_free = {};
 }
 
+void TrimArena(Arena* arena, int kept_size)
+{
+    uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t trim_start = (arena->mapped_address + kept_size + page_size - 1) & ~(page_size - 1);
+    uintptr_t arena_end = arena->mapped_address + arena->size;
+    assert(arena->next_address <= trim_start);
+    
+    // Note(Leo): The range stays mapped, its pages just read back as zero the next time they are touched
+    if(trim_start < arena_end)
+    {
+        madvise((void*)trim_start, arena_end - trim_start, MADV_DONTNEED);
+    }
+}
+
 void FreeArena(Arena* arena)
 {
     munmap((void*)arena->mapped_address, arena->size);
@@ -326,7 +355,7 @@ void DeAllocScratch(void* address)
 }
 
 
-Arena scratch_arena = Arena();
+thread_local Arena scratch_arena = Arena();
 
 void InitScratch(int reserved_size, uint64_t flags)
 {
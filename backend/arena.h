@@ -53,7 +53,8 @@ struct Arena
 
 #define no_water_level() (uint64_t)(1 << 2)
 
-extern Arena scratch_arena;
+// Note(Leo): Every thread gets its own scratch arena, threads other than the main one have to call InitScratch first
+extern thread_local Arena scratch_arena;
 
 Arena CreateArena(int reserved_size, int alloc_size, uint64_t flags = 0);
 
@@ -77,6 +78,8 @@ void ResetArena(Arena* arena);
 
 void FreeArena(Arena* arena); // Free the memory region associated with an arena.
 
+void TrimArena(Arena* arena, int kept_size); // Give the pages past the first kept_size bytes back to the OS, the arena must not be using them
+
 void InitScratch(int reserved_size, uint64_t flags = 0);
 
 bool CompareArenaContents(Arena* first, Arena* second);
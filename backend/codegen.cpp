@@ -70,7 +70,7 @@ static bool expect_eat(TokenType expected_type);
 #define BINDING_ARR_BOOL_STUB_TEMPLATE "\nbool %s(void* a_void, void* d_void, int index)\n{\nauto a = (%.*s*)a_void; auto e = (%s*)d_void; %s;\n}\n"
 #define BINDING_ARR_VOID_PTR_STUB_TEMPLATE "\nvoid %s(void* a_void, int index, void* ptr_void)\n{\n((%.*s*)a_void + index)->%s = ptr_void;\n}\n"
 #define BINDING_ARR_PTR_STUB_TEMPLATE "\nvoid* %s(void* a_void, int index)\n{\nauto a = (%.*s*)a_void; auto e = (%s*)d_void; %s;\n}\n"
-#define BINDING_ARR_INT_STUB_TEMPLATE "\nint %s(void* a_void, void* d_void, int index)\n{\nauto a = (%.*s*)a_void;\nauto e = (%s)d_void;\n %s;\n}\n"
+#define BINDING_ARR_INT_STUB_TEMPLATE "\nint %s(void* a_void, void* d_void, int index)\n{\nauto a = (%.*s*)a_void;\nauto e = (%s*)d_void;\n %s;\n}\n"
 #define BINDING_ARR_ARG_STUB_TEMPLATE "\nvoid %s(void* a_void, void* d_void, int index, CustomArgs* ARGS)\n{\nauto a = (%.*s*)a_void;\nauto e = (%s*)d_void;\n *ARGS = {%s};\nARGS->count = %d;\n}\n"
 
 static Token* curr_token;
@@ -123,6 +123,8 @@ enum class AttributeType
     FOCUSABLE,
     ID,
     TICKING, // The runtime sends an event every frame to "tick" this element
+    BAKED_CLASS, // A class attribute with a single selector and no bindings, resolved to selector ids at compile time
+    VIRTUAL, // For the each element, only instances the rows that are visible in the parent
 };
 
 #define MAX_TAGS_PER_BINDING 20
@@ -204,6 +206,7 @@ struct attr_loop_body
     int length_binding;
     StringView type_name;
     int template_id;
+    int key_binding; // Optional, 0 if the each is keyed by index
 };
 
 struct attr_custom_body : attr_text_like_body
@@ -217,6 +220,18 @@ struct attr_args_body
     int binding_id;
 };
 
+// Note(Leo): Order of the variants is normal, !hover, !mousedown. An id of 0 means the class has no such variant.
+#define BAKED_CLASS_VARIANTS 3
+struct attr_baked_class_body
+{
+    int selector_ids[BAKED_CLASS_VARIANTS];
+};
+
+struct attr_virtual_body
+{
+    float row_height; // Pixel height of one instance, 0 if it should be estimated from the instances that were laid out
+};
+
 struct Attribute
 {
     AttributeType type;
@@ -232,6 +247,8 @@ struct Attribute
         attr_loop_body Loop;
         attr_on_focus_body OnFocus;
         attr_args_body Args;
+        attr_baked_class_body BakedClass;
+        attr_virtual_body Virtual;
     };
 };
 
@@ -557,6 +574,7 @@ void ProduceAST(Compiler::AST* target, Arena* tokens, Arena* token_values, Compi
 
 // Register a style selector if it doesnt exist and return its ID.
 int RegisterSelectorByName(Compiler::LocalStyles* target, StringView* name, int style_id, int global_prefix, Compiler::CompilerState* state);
+int GetRegisteredSelectorId(StringView* name);
 void ClearRegisteredSelectors();
 
 // NOTE: file_prefix_string should be NULL terminated!!
@@ -67,6 +67,8 @@ void SavePage(AST* saved_tree, LocalStyles* saved_styles, const char* file_name,
         curr_tag++;
     }
     
+    header.static_tag_count = header.tag_count;
+    
     RegisteredTemplate* curr_template = (RegisteredTemplate*)saved_tree->templates->mapped_address;
     
     int template_count = (RegisteredTemplate*)saved_tree->templates->next_address - (RegisteredTemplate*)saved_tree->templates->mapped_address;
@@ -161,6 +163,7 @@ void SavePage(AST* saved_tree, LocalStyles* saved_styles, const char* file_name,
                 added_attribute.Loop.array_binding = curr_attribute->Loop.array_binding;
                 added_attribute.Loop.length_binding = curr_attribute->Loop.length_binding;
                 added_attribute.Loop.template_id = curr_attribute->Loop.template_id;
+                added_attribute.Loop.key_binding = curr_attribute->Loop.key_binding;
                 break;
             }
             case(AttributeType::FOCUSABLE):
@@ -176,6 +179,16 @@ void SavePage(AST* saved_tree, LocalStyles* saved_styles, const char* file_name,
                 added_attribute.Args.binding_id = curr_attribute->Args.binding_id;
                 break;
             }
+            case(AttributeType::BAKED_CLASS):
+            {
+                memcpy(added_attribute.BakedClass.selector_ids, curr_attribute->BakedClass.selector_ids, sizeof(added_attribute.BakedClass.selector_ids));
+                break;
+            }
+            case(AttributeType::VIRTUAL):
+            {
+                added_attribute.Virtual.row_height = curr_attribute->Virtual.row_height;
+                break;
+            }
             default: // Text like attributes
             {
                 text_like:
@@ -426,6 +439,17 @@ LoadedFileHandle LoadPage(FILE* file, Arena* tags, Arena* templates, Arena* attr
                 added_attribute->Loop.array_binding = read_attribute.Loop.array_binding;
                 added_attribute->Loop.length_binding = read_attribute.Loop.length_binding;
                 added_attribute->Loop.template_id = read_attribute.Loop.template_id;
+                added_attribute->Loop.key_binding = read_attribute.Loop.key_binding;
+                break;
+            }
+            case(AttributeType::BAKED_CLASS):
+            {
+                memcpy(added_attribute->BakedClass.selector_ids, read_attribute.BakedClass.selector_ids, sizeof(added_attribute->BakedClass.selector_ids));
+                break;
+            }
+            case(AttributeType::VIRTUAL):
+            {
+                added_attribute->Virtual.row_height = read_attribute.Virtual.row_height;
                 break;
             }
             default:
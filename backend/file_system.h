@@ -9,6 +9,7 @@ struct PageFileHeader
     int file_id;
     int first_tag_index;
     int tag_count;
+    int static_tag_count; // Tags outside of templates, always the first tags in the file
     int first_template_index;
     int template_count;
     int first_attribute_index;
@@ -86,6 +87,17 @@ struct saved_attr_loop_body
     int array_binding;
     int length_binding;
     int template_id;
+    int key_binding;
+};
+
+struct saved_attr_baked_class_body
+{
+    int selector_ids[BAKED_CLASS_VARIANTS];
+};
+
+struct saved_attr_virtual_body
+{
+    float row_height;
 };
 
 struct saved_attr_text_like_body
@@ -110,6 +122,8 @@ struct SavedAttribute
         saved_attr_condition_body Condition;
         saved_attr_loop_body Loop;
         saved_attr_args_body Args;
+        saved_attr_baked_class_body BakedClass;
+        saved_attr_virtual_body Virtual;
     };
 };
 
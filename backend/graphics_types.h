@@ -180,6 +180,10 @@ struct PushConstants
     alignas(4) int32_t shape_count;
     alignas(4) bool invert_horizontal_axis;
     alignas(4) bool invert_vertical_axis;
+    alignas(4) int32_t bin_columns; // 0 when there are no tile bins and every tile has to test every shape
+    alignas(4) int32_t bin_tile_count;
+    alignas(4) int32_t dirty_tile_offset; // Where the dirty tile list starts in the bin buffer
+    alignas(4) int32_t dirty_tile_count; // 0 when every tile is being drawn
 };
 
 struct SpecializationData 
@@ -0,0 +1,93 @@
+// Note(Leo): The standard threading headers have to come before the arena macros
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "platform.h"
+#include "job_pool.h"
+
+struct job_pool
+{
+    uint32_t worker_count;
+    std::once_flag started;
+
+    std::mutex dispatch_lock; // Held for a whole dispatch so only one runs at a time
+
+    std::mutex lock;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    uint32_t dispatch; // Bumped every time new work is handed out
+    uint32_t busy_workers;
+
+    JobPoolFn fn;
+    void* data;
+};
+
+// Note(Leo): Never destroyed, the detached workers are still waiting on it when the process exits
+static job_pool& pool = *(new job_pool);
+
+void job_worker_main(uint32_t worker_index)
+{
+    InitScratch(JOB_WORKER_SCRATCH_SIZE);
+
+    uint32_t last_dispatch = 0;
+    while(true)
+    {
+        JobPoolFn fn;
+        void* data;
+        {
+            std::unique_lock<std::mutex> lock(pool.lock);
+            pool.work_ready.wait(lock, [&]{ return pool.dispatch != last_dispatch; });
+            last_dispatch = pool.dispatch;
+            fn = pool.fn;
+            data = pool.data;
+        }
+
+        fn(data, worker_index + 1);
+
+        {
+            std::unique_lock<std::mutex> lock(pool.lock);
+            pool.busy_workers--;
+        }
+        pool.work_done.notify_one();
+    }
+}
+
+uint32_t JobPoolWorkerCount()
+{
+    std::call_once(pool.started, []
+    {
+        uint32_t thread_count = std::thread::hardware_concurrency();
+        pool.worker_count = thread_count > 1 ? MIN(thread_count - 1, JOB_POOL_MAX_WORKERS) : 0;
+        for(uint32_t i = 0; i < pool.worker_count; i++)
+        {
+            std::thread(job_worker_main, i).detach();
+        }
+    });
+
+    return pool.worker_count;
+}
+
+void JobPoolRun(JobPoolFn fn, void* data)
+{
+    std::unique_lock<std::mutex> dispatch_lock(pool.dispatch_lock);
+
+    if(!JobPoolWorkerCount())
+    {
+        fn(data, 0);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(pool.lock);
+        pool.fn = fn;
+        pool.data = data;
+        pool.dispatch++;
+        pool.busy_workers = pool.worker_count;
+    }
+    pool.work_ready.notify_all();
+
+    fn(data, 0);
+
+    std::unique_lock<std::mutex> lock(pool.lock);
+    pool.work_done.wait(lock, []{ return pool.busy_workers == 0; });
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+
+// Note(Leo): Worker threads shared by everything that splits its work across cores (layout and the software renderer).
+//            A dispatch runs the same function on every worker and on the calling thread, the function is expected to
+//            pull its work off of its own atomic counter until there is none left.
+
+#define JOB_POOL_MAX_WORKERS 31
+#define JOB_WORKER_SCRATCH_SIZE 1000000 // Every worker gets its own scratch arena
+
+// thread_index is 0 for the calling thread and 1 up to JobPoolWorkerCount() for the workers
+typedef void (*JobPoolFn)(void* data, uint32_t thread_index);
+
+// Returns the number of workers not counting the calling thread, the first call starts them
+uint32_t JobPoolWorkerCount();
+
+// Runs fn on every worker and the calling thread and blocks until all of them have returned.
+// Note(Leo): Dispatches from different threads wait on each other, fn itself must not dispatch.
+void JobPoolRun(JobPoolFn fn, void* data);
@@ -358,6 +358,7 @@ std::map<std::string, AttributeType> attribute_map =
     {"id", AttributeType::ID },
     {"args", AttributeType::CUSTOM},
     {"ticking", AttributeType::TICKING},
+    {"virtual", AttributeType::VIRTUAL},
 };
 
 
@@ -607,6 +608,66 @@ int RegisterSelectorByName(Compiler::LocalStyles* target, StringView* name, int
     return new_selector->global_id;
 }
 
+// Returns the global id of a selector registered in the file being compiled, 0 if it isnt registered.
+int GetRegisteredSelectorId(StringView* name)
+{
+    char* terminated_name = (char*)AllocScratch((name->len + 1) * sizeof(char), no_zero()); // extra charachter to fit the NULL terminator
+    memcpy(terminated_name, name->value, name->len*sizeof(char)); 
+    terminated_name[name->len] = '\0';
+    
+    auto search = registered_selector_map.find((const char*)terminated_name);
+    DeAllocScratch(terminated_name);
+    
+    if(search == registered_selector_map.end())
+    {
+        return 0;
+    }
+    
+    return search->second->global_id;
+}
+
+// Tries to resolve a class attribute's selector and its state variants, returns false if the class cant be baked.
+bool bake_class_attribute(Attribute* target, StringView* class_name)
+{
+    const char* variant_suffixes[BAKED_CLASS_VARIANTS] = { "", "!hover", "!mousedown" };
+    
+    StringView stripped_name = StripOuterWhitespace(class_name);
+    
+    // Multiple selectors in one class have to be merged by the runtime
+    for(uint32_t i = 0; i < stripped_name.len; i++)
+    {
+        if(stripped_name.value[i] == ' ')
+        {
+            return false;
+        }
+    }
+    
+    int selector_ids[BAKED_CLASS_VARIANTS] = {};
+    
+    for(int i = 0; i < BAKED_CLASS_VARIANTS; i++)
+    {
+        int variant_length = snprintf(NULL, 0, "%.*s%s", stripped_name.len, stripped_name.value, variant_suffixes[i]);
+        char* variant_name = (char*)AllocScratch((variant_length + 1)*sizeof(char)); // +1 to fit \0
+        sprintf(variant_name, "%.*s%s", stripped_name.len, stripped_name.value, variant_suffixes[i]);
+        
+        StringView variant_view = {variant_name, (uint32_t)variant_length};
+        selector_ids[i] = GetRegisteredSelectorId(&variant_view);
+        
+        DeAllocScratch(variant_name);
+    }
+    
+    // Note(Leo): The base selector is what the runtime indexes the baked styles by
+    if(!selector_ids[0])
+    {
+        return false;
+    }
+    
+    target->type = AttributeType::BAKED_CLASS;
+    memcpy(target->BakedClass.selector_ids, selector_ids, sizeof(selector_ids));
+    
+    return true;
+}
+
 // Returns true if the next token is the expected type.
 bool expect_eat(TokenType expected_type)
 {
@@ -686,6 +747,35 @@ Attribute* parse_attribute_expr(AST* target, Tag* parent_tag, Token* attribute_s
             parent_tag->num_attributes++;
             continue;
         }
+        case(AttributeType::VIRTUAL): // Optional value
+        {
+            if(parent_tag->type != TagType::EACH)
+            {
+                printf("Warning: Virtual attribute on non-each tag, it will be ignored.\n");
+            }
+            
+            new_attribute->Virtual.row_height = 0.0f;
+            
+            // Note(Leo): Without a value the row height gets estimated at runtime
+            if((curr_token + 1)->type == TokenType::EQUALS)
+            {
+                break;
+            }
+            
+            eat();
+            if(curr_token->type != TokenType::ATTRIBUTE_IDENTIFIER && curr_token->type != TokenType::END)
+            {
+                printf("Unexpected token while parsing attribute!\n");
+                return NULL;
+            }
+            
+            parent_tag->num_attributes++;
+            continue;
+        }
+        default:
+        {
+            break;
+        }
         }
         
         if(!expect_eat(TokenType::EQUALS))
@@ -763,6 +853,11 @@ Attribute* parse_attribute_expr(AST* target, Tag* parent_tag, Token* attribute_s
                 printf("Found a binding while parsing id attribute. Bindings are not allowed for id attributes since they baked at compile time.\n");
                 break;
             }
+            case(AttributeType::VIRTUAL):
+            {
+                printf("Found a binding while parsing virtual attribute. The row height of a virtual each must be a fixed pixel size.\n");
+                break;
+            }
             case(AttributeType::CUSTOM):
             {
                 if(parent_tag->type != TagType::CUSTOM)
@@ -826,13 +921,41 @@ Attribute* parse_attribute_expr(AST* target, Tag* parent_tag, Token* attribute_s
                     printf("Error: Needed a type name in loop attribute binding!\n");
                     break;
                 }
-                new_attribute->Loop.type_name.len = curr_token->body.len - (array_name.len + count_name.len + 2);
+                // +2 to account for 2 skipped ; chars
+                // Note(Leo): Cant underflow, type_name was checked to be inside the body above
+                uint32_t remaining_length = curr_token->body.len - (array_name.len + count_name.len + 2);
+                
+                // Note(Leo): The type name can optionally be followed by a key expression which is evaluated in the
+                //            context of the array like a local binding (a[index]) and used to match up instances when the
+                //            array changes.
+                new_attribute->Loop.type_name.len = 0;
+                for(uint32_t i = 0; i < remaining_length; i++)
+                {
+                    if(type_name[i] == ';')
+                    {
+                        break;
+                    }
+                    new_attribute->Loop.type_name.len++;
+                }
                 
-                assert(type_name + new_attribute->Loop.type_name.len == curr_token->body.value + curr_token->body.len);
+                assert(type_name + remaining_length == curr_token->body.value + curr_token->body.len);
                 
-                // +2 to account for 2 skipped ; chars
                 new_attribute->Loop.type_name.value = (char*)Alloc(values_arena, new_attribute->Loop.type_name.len*sizeof(char));
                 memcpy(new_attribute->Loop.type_name.value, type_name, new_attribute->Loop.type_name.len);
+                
+                new_attribute->Loop.key_binding = 0;
+                if(new_attribute->Loop.type_name.len < remaining_length)
+                {
+                    // +1 to step over ;
+                    StringView key_name = {type_name + (new_attribute->Loop.type_name.len + 1), (uint32_t)(remaining_length - (new_attribute->Loop.type_name.len + 1))};
+                    if(key_name.len == 0)
+                    {
+                        printf("Error: Expected a key expression after the ; following the type name in loop attribute binding!\n");
+                        break;
+                    }
+                    
+                    new_attribute->Loop.key_binding = RegisterBindingByName(registered_bindings_arena, values_arena, &key_name, RegisteredBindingType::INT_RET, true, state, new_attribute->Loop.type_name);
+                }
             
                 break;
             }
@@ -894,6 +1017,40 @@ Attribute* parse_attribute_expr(AST* target, Tag* parent_tag, Token* attribute_s
                 
                 break;
             }
+            case(AttributeType::VIRTUAL):
+            {
+                if(!front_value || back_value)
+                {
+                    break;
+                }
+                
+                StringView row_height = {front_value, (uint32_t)front_length};
+                Measurement parsed = parse_size_field(&row_height);
+                if(parsed.type != MeasurementType::PIXELS)
+                {
+                    printf("Warning: The row height of a virtual each must be in px, it will be estimated instead.\n");
+                    break;
+                }
+                
+                new_attribute->Virtual.row_height = parsed.size;
+                break;
+            }
+            case(AttributeType::CLASS):
+            {
+                // Note(Leo): A class with a single selector and no bindings gets baked down to selector ids so the
+                //            runtime doesnt need to look it up by name every time it evaluates the element.
+                if(!new_attribute->Text.binding_id && !back_value && front_value)
+                {
+                    StringView class_name = {front_value, (uint32_t)front_length};
+                    if(bake_class_attribute(new_attribute, &class_name))
+                    {
+                        break;
+                    }
+                }
+                
+                // Note(Leo): Falls through, dynamic classes are handled like any other text like attribute
+            }
+            [[fallthrough]];
             // Text like attributes
             default:
             {
@@ -1,9 +1,11 @@
 #include <vulkan/vulkan.h>
 #include "DOM.h"
 #include "graphics_types.h"
+#include "tile_binning.h"
 #include <cassert>
 #pragma once
 #define MAX_WINDOW_COUNT 100
+#define FRAMES_IN_FLIGHT 2 // Frames each window can have queued on the gpu while the next one is built
 #define MAX_TEXTURE_COUNT 30
 #define GLYPH_ATLAS_COUNT 200
 #define FontHandle uint16_t
@@ -21,6 +23,11 @@ struct vk_swapchain_image
     vk_swapchain_image* next;
     VkImageView image_view;
     VkImage image;
+    uint32_t drawn_frame; // Draw this image was last drawn in, 0 if it has never been drawn into
+    
+    // Note(Leo): Per image rather than per frame since a frame's fence doesnt say the present waiting on this has
+    //            happened, the image being acquired again does
+    VkSemaphore render_finished_semaphore;
 };
 
 enum class MouseState 
@@ -84,20 +91,16 @@ struct PlatformControlState
     VirtualKeyboard* keyboard_state; 
 };
 
-struct shared_window 
+// Note(Leo): Everything a single frame in flight uses, the cpu only touches a frame again once its fence has signalled
+struct vk_window_frame
 {
-    void* window_dom;
-    Arena* last_renderque;
-
     VkCommandBuffer vk_command_buffer;
-    VkSurfaceKHR vk_window_surface;
-    VkSwapchainKHR vk_window_swapchain;
-    vk_swapchain_image* vk_first_image;
     
     VkSemaphore vk_image_available_semaphore;
-    VkSemaphore vk_render_finished_semaphore;
     VkFence vk_in_flight_fence;
     
+    // Persistently mapped, the renderque and bins are written here and copied into the input buffer by the frame's own
+    // command buffer
     void* vk_staging_mapped_address;
     int vk_staging_buffer_size;
     VkBuffer vk_staging_buffer;
@@ -108,6 +111,35 @@ struct shared_window
     VkDeviceMemory vk_input_memory;
 
     VkDescriptorSet vk_combined_descriptor;
+};
+
+struct shared_window 
+{
+    void* window_dom;
+    Arena* last_renderque;
+    
+    VkSurfaceKHR vk_window_surface;
+    VkSwapchainKHR vk_window_swapchain;
+    vk_swapchain_image* vk_first_image;
+    
+    vk_window_frame vk_frames[FRAMES_IN_FLIGHT];
+    uint32_t vk_frame_index; // The frame that gets built next
+    
+    // Note(Leo): Only used by the software renderer, frames are drawn here and then handed to the platform to present
+    uint32_t* sw_pixels;
+    int sw_pixels_capacity;
+    uint32_t sw_drawn_frame;
+    
+    // Note(Leo): Damage tracking, the instances of the last draw and which tiles each of the last few draws changed so
+    //            only those tiles have to be drawn again (see record_window_damage).
+    Arena drawn_instances;
+    uint8_t* damage_history;
+    uint32_t damage_columns;
+    uint32_t damage_rows;
+    int damage_width; // Size of the last draw
+    int damage_height;
+    uint32_t damage_frame; // Number of draws so far
+    bool damage_reset; // The next draw has to dirty every tile
     
     PlatformControlState controls; 
 
@@ -170,6 +202,9 @@ char* PlatformGetTextClipboard(uint32_t* buffer_len); // UTF8 on the scratch are
 
 void PlatformSetWindowTitle(DOM* dom, const char* utf8_buffer, uint32_t buffer_len);
 
+// Wakes the main loop if it is idling, safe to call from any thread
+void PlatformWakeMainLoop();
+
 extern float SCROLL_MULTIPLIER;
 #define PREFETCH_INTRINSIC(...)
 
@@ -235,6 +270,19 @@ struct PlatformWindow : shared_window
     Window window_handle;
     GC window_gc;
     XIC window_input_context;
+    uint32_t active_frames; // Ticks left before the window goes idle
+    
+    // Note(Leo): Each window alternates between its own renderques so the layout from its last tick stays intact 
+    //            however long it idles for.
+    Arena renderques[2];
+    uint32_t used_renderque;
+    
+    // Note(Leo): Renderques keep the pages of the biggest layout they have held until the window has gone a while
+    //            without needing them (see linux_trim_renderque).
+    uint32_t renderque_extents[2]; // How far into each renderque has been touched
+    uint32_t renderque_high_water; // Most a tick has used since the current trim interval started
+    uint32_t last_renderque_high_water; // Most a tick used during the last trim interval
+    uint32_t trim_interval_ticks;
 };
 
 void linux_vk_create_window_surface(PlatformWindow* window, Display* x_display);
@@ -266,6 +314,9 @@ void android_vk_create_window_surface(PlatformWindow* window);
 void vk_destroy_window_surface(PlatformWindow* window);
 void vk_window_resized(PlatformWindow* window);
 
+// Copies a software rendered frame (0xAARRGGBB pixels, pitch == width) onto the window, only the given rects if there are any
+void PlatformPresentSoftwareFrame(PlatformWindow* window, uint32_t* pixels, int width, int height, DirtyRect* rects = NULL, uint32_t rect_count = 0);
+
 // Vulkan extension name macros
 #define VK_E_KHR_SURFACE_NAME "VK_KHR_surface"
 #define VK_E_KHR_WIN32_SURFACE_NAME "VK_KHR_win32_surface"
@@ -305,6 +356,10 @@ void RenderplatformDrawWindow(PlatformWindow* window, Arena* renderque);
 
 bool RenderplatformSafeToDelete(PlatformWindow* window);
 
+// Part of the window was uncovered and may have lost its contents. Returns whether the window has to be drawn again, if
+// so the next draw redraws and presents all of it.
+bool RenderplatformWindowExposed(PlatformWindow* window);
+
 void RenderplatformLoadImage(FILE* image_file, const char* name);
 
 void RenderplatformUploadGlyph(void* glyph_data, int glyph_width, int glyph_height, int glyph_slot);
@@ -374,11 +429,29 @@ struct FontPlatformGlyph
     FontHandle font;
 };
 
+// Note(Leo): The top and bottom of lines only ever grow down the text (they cover any glyph that reaches past its line) 
+//            so the lines that overlap a range of heights can be binary searched.
+struct FontPlatformShapedLine
+{
+    uint32_t first_glyph; // Index into the shaped text's glyphs
+    uint32_t glyph_count;
+    float top; // Relative to the top of the shaped text
+    float bottom;
+};
+
 struct FontPlatformShapedText
 {
     FontPlatformShapedGlyph* first_glyph;
     uint32_t glyph_count;
     
+    FontPlatformShapedLine* first_line;
+    uint32_t line_count;
+    
+    // Note(Leo): Lookups by buffer index only cover the glyphs of the first text. buffer_order lists their indices 
+    //            sorted by buffer_index, its NULL when the glyphs are already in buffer order.
+    uint32_t* buffer_order;
+    uint32_t buffer_glyph_count;
+    
     uint32_t required_width;
     uint32_t required_height;
 };
@@ -388,14 +461,22 @@ int InitializeFontPlatform(Arena* master_arena, int standard_glyph_size);
 
 void FontPlatformLoadFace(const char* font_name, FILE* font_file);
 void FontPlatformLoadFace(const char* font_name, PlatformFile* font_file);
-void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result, StringView* utf8_strings, FontHandle* font_handles, uint16_t* font_sizes, StyleColor* colors, int text_block_count, uint32_t wrapping_point);
+// Note(Leo): text_keys are optional keys from FontPlatformHashText (0 means hash it here). shaped_handles are optional 
+//            in/out handles from a previous shape of the same text that let the cache lookup be skipped (0 if unknown).
+void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result, StringView* utf8_strings, FontHandle* font_handles, uint16_t* font_sizes, StyleColor* colors, int text_block_count, uint32_t wrapping_point, uint32_t* text_keys = NULL, uint32_t* shaped_handles = NULL);
+// Get the key the text cache would use for a buffer
+uint32_t FontPlatformHashText(char* utf8_buffer, uint32_t buffer_length);
 FontHandle FontPlatformGetFont(const char* font_name);
 
 int FontPlatformGetGlyphSize();
 void FontPlatformUpdateCache(int new_size_glyphs);
 
 Arena* RuntimeTickAndBuildRenderque(Arena* renderque, DOM* dom, PlatformControlState* controls, int window_width, int window_height);
-Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int element_count, int window_width, int window_height);
+// Whether the dom has asked to be ticked again (ticking elements, page switches, RequestFrame)
+bool RuntimeWantsFrame(DOM* dom);
+Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int element_count, int window_width, int window_height, HitTestGrid** hit_grid = NULL);
+// Writes the ids of the elements under the point into element_ids (which must fit grid->entry_count) in draw order.
+uint32_t HitTestGridQuery(HitTestGrid* grid, vec2 point, uint32_t* element_ids);
 
 bool PointInsideBounds(const bounding_box bounds, const vec2 point);
 
@@ -410,6 +491,7 @@ bool PointInsideBounds(const bounding_box bounds, const vec2 point);
         TIMED_BLOCKS_WAIT_FENCE,
         TIMED_BLOCKS_RENDER_SUBMIT,
         TIMED_BLOCKS_RENDER_PRESENT,
+        TIMED_BLOCKS_BIN_TILES,
         TIMED_BLOCKS_TICK_AND_BUILD,
         TIMED_BLOCKS_HARFBUZZ,
         TIMED_BLOCKS_MEOW,
@@ -419,10 +501,21 @@ bool PointInsideBounds(const bounding_box bounds, const vec2 point);
         TIMED_BLOCKS_SECOND_PASS,
         TIMED_BLOCKS_FINAL_PASS,
         TIMED_BLOCKS_TEXT_SHAPE,
+        TIMED_BLOCKS_SPLIT_LAYOUT,
         TIMED_BLOCKS_SECTION_A,
         TIMED_BLOCKS_BLOCKS_MAX, // Note(Leo): Should be at the end of the enum
     };
     
+    // Note(Leo): High water marks are the most a value has reached since the last dump
+    enum
+    {
+        HIGH_WATER_DOM_ELEMENTS,
+        HIGH_WATER_LAYOUT_ELEMENTS,
+        HIGH_WATER_SHAPE_ARENA_BYTES,
+        HIGH_WATER_RENDERQUE_BYTES,
+        HIGH_WATER_MAX, // Note(Leo): Should be at the end of the enum
+    };
+    
 
     struct timing_info 
     {
@@ -432,6 +525,9 @@ bool PointInsideBounds(const bounding_box bounds, const vec2 point);
     };
     
     extern timing_info INSTRUMENT_TIMINGS[TIMED_BLOCKS_BLOCKS_MAX];
+    extern uint64_t INSTRUMENT_HIGH_WATER[HIGH_WATER_MAX];
+    
+    #define TRACK_HIGH_WATER(name, value) INSTRUMENT_HIGH_WATER[HIGH_WATER_##name] = MAX(INSTRUMENT_HIGH_WATER[HIGH_WATER_##name], (uint64_t)(value));
     
     #define SetupInstrumentation() 
     
@@ -455,6 +551,7 @@ bool PointInsideBounds(const bounding_box bounds, const vec2 point);
     // Define once at the platform implementation like an STB style lib
     #if INSTRUMENT_IMPLEMENTATION
         timing_info INSTRUMENT_TIMINGS[TIMED_BLOCKS_BLOCKS_MAX] = {};
+        uint64_t INSTRUMENT_HIGH_WATER[HIGH_WATER_MAX] = {};
         
         const char* BLOCK_NAMES[] = 
         {
@@ -463,6 +560,7 @@ bool PointInsideBounds(const bounding_box bounds, const vec2 point);
             "WAIT_FENCE",
             "RENDER_SUBMIT",
             "RENDER_PRESENT",
+            "BIN_TILES",
             "TICK_AND_BUILD",
             "HARFBUZZ",
             "MEOW_HASH",
@@ -472,9 +570,19 @@ bool PointInsideBounds(const bounding_box bounds, const vec2 point);
             "SECOND_PASS",
             "FINAL_PASS",
             "TEXT_SHAPE",
+            "SPLIT_LAYOUT",
             "SECTION_A",
             "BLOCKS_MAX",
         };
+        
+        const char* HIGH_WATER_NAMES[] = 
+        {
+            "DOM_ELEMENTS",
+            "LAYOUT_ELEMENTS",
+            "SHAPE_ARENA_BYTES",
+            "RENDERQUE_BYTES",
+            "MAX",
+        };
 
         
         void DUMP_TIMINGS()
@@ -504,12 +612,23 @@ bool PointInsideBounds(const bounding_box bounds, const vec2 point);
                     
                 }
             }
+            
+            printf("High water:\n");
+            for(int i = 0; i < HIGH_WATER_MAX; i++)
+            {
+                if(INSTRUMENT_HIGH_WATER[i])
+                {
+                    printf("\t%s: %lu\n", HIGH_WATER_NAMES[i], (unsigned long)INSTRUMENT_HIGH_WATER[i]);
+                    INSTRUMENT_HIGH_WATER[i] = 0;
+                }
+            }
         }
     #endif
     
 #else
     #define BEGIN_TIMED_BLOCK(a) (void)0
     #define END_TIMED_BLOCK(a) (void)0
+    #define TRACK_HIGH_WATER(a, b) (void)0
     #define SetupInstrumentation() (void)0
     #define DUMP_TIMINGS (void)0
 #endif
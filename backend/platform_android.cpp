@@ -8,6 +8,9 @@
 #include <string>
 #include <android/log.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include <android/native_window_jni.h>
 #include <android/asset_manager_jni.h>
 
@@ -86,6 +89,8 @@ struct android_platform_state
 
     android_semaphore platform_mutex;
     android_semaphore events_semaphore;
+    
+    int wake_fd; // eventfd written to by PlatformWakeMainLoop to cut the wait between unchanged frames short
 };
 
 android_platform_state platform;
@@ -539,6 +544,49 @@ void initialize_window()
     android_vk_create_window_surface(&platform.window);
 }
 
+void PlatformPresentSoftwareFrame(PlatformWindow* window, uint32_t* pixels, int width, int height, DirtyRect* rects, uint32_t rect_count)
+{
+    ANativeWindow_setBuffersGeometry(window->window_handle, width, height, WINDOW_FORMAT_RGBA_8888);
+    
+    // Note(Leo): The dirty bounds are only a hint, lock hands back the area that actually has to be written
+    ARect dirty_bounds = { 0, 0, width, height };
+    if(rects && rect_count)
+    {
+        dirty_bounds = { (int32_t)rects[0].x, (int32_t)rects[0].y, (int32_t)(rects[0].x + rects[0].width), (int32_t)(rects[0].y + rects[0].height) };
+        for(uint32_t i = 1; i < rect_count; i++)
+        {
+            dirty_bounds.left = MIN(dirty_bounds.left, (int32_t)rects[i].x);
+            dirty_bounds.top = MIN(dirty_bounds.top, (int32_t)rects[i].y);
+            dirty_bounds.right = MAX(dirty_bounds.right, (int32_t)(rects[i].x + rects[i].width));
+            dirty_bounds.bottom = MAX(dirty_bounds.bottom, (int32_t)(rects[i].y + rects[i].height));
+        }
+    }
+    
+    ANativeWindow_Buffer buffer;
+    if(ANativeWindow_lock(window->window_handle, &buffer, &dirty_bounds) != 0)
+    {
+        return;
+    }
+    
+    int first_column = MAX(dirty_bounds.left, 0);
+    int first_row = MAX(dirty_bounds.top, 0);
+    int last_column = MIN(MIN(dirty_bounds.right, width), buffer.width);
+    int last_row = MIN(MIN(dirty_bounds.bottom, height), buffer.height);
+    for(int row = first_row; row < last_row; row++)
+    {
+        uint32_t* source = pixels + row*width;
+        uint32_t* target = (uint32_t*)buffer.bits + row*buffer.stride;
+        for(int i = first_column; i < last_column; i++)
+        {
+            // Note(Leo): RGBA_8888 is 0xAABBGGRR so red and blue swap over
+            uint32_t pixel = source[i];
+            target[i] = (pixel & 0xFF00FF00) | ((pixel >> 16) & 0xFF) | ((pixel & 0xFF) << 16);
+        }
+    }
+    
+    ANativeWindow_unlockAndPost(window->window_handle);
+}
+
 // Updates conrol state button states from THIS_FRAME to normal
 // Updates scroll to 0
 void android_update_control_state()
@@ -764,6 +812,8 @@ void android_process_window_events()
             }
         }
     }
+    
+    CommitEvents((DOM*)platform.window.window_dom);
 }
 
 FILE* android_open_relative_file_path(Arena* binary_arena, const char* relative_path, const char* open_params)
@@ -923,6 +973,8 @@ void* android_main(void* arguments)
     platform.runtime_master_arena = (Arena*)Alloc(&(platform.master_arena), sizeof(Arena));
     *(platform.runtime_master_arena) = CreateArena(sizeof(Arena)*1000, sizeof(Arena));
 
+    platform.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    
     platform.platform_events[0] = (Arena*)Alloc(&(platform.master_arena), sizeof(Arena));
     *(platform.platform_events[0]) = CreateArena(sizeof(android_event)*1000, sizeof(android_event));
     platform.platform_events[1] = (Arena*)Alloc(&(platform.master_arena), sizeof(Arena));
@@ -1007,7 +1059,13 @@ void* android_main(void* arguments)
         if(platform.window.last_renderque && CompareArenaContents(platform.window.last_renderque, final_renderque))
         {
             // Todo(Leo): Figure out a more dynamic way of deciding how much we wanna wait!
-            usleep(10000);
+            // Note(Leo): A PlatformWakeMainLoop from another thread ends the wait early
+            pollfd wake_wait = { platform.wake_fd, POLLIN, 0 };
+            if(poll(&wake_wait, 1, 10) > 0)
+            {
+                uint64_t drained;
+                read(platform.wake_fd, &drained, sizeof(uint64_t));
+            }
         }
         else
         {
@@ -1032,4 +1090,11 @@ void PlatformRegisterDom(void* dom)
 {
     platform.window.window_dom = dom;
 }
+
+// Note(Leo): The main loop here keeps ticking and only waits between unchanged frames, this ends that wait early
+void PlatformWakeMainLoop()
+{
+    uint64_t wake = 1;
+    write(platform.wake_fd, &wake, sizeof(uint64_t));
+}
 #endif
@@ -1,3 +1,5 @@
+// Note(Leo): The standard threading headers have to come before the arena macros
+#include <mutex>
 #include "platform.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -55,6 +57,16 @@ struct cached_shaped_glyph
     
 };
 
+// A glyph in a shaped run that a line is allowed to start at. A run's breaks are found once so wrapping it at a new
+// width only needs a search over them instead of re-measuring every glyph.
+struct cached_line_break
+{
+    uint32_t glyph_ordinal; // How many glyphs into the run the break is
+    uint32_t next_forced; // Index of the next break a line has to end at ('\n' or the end of the run)
+    float advance; // Pen position at the break relative to the start of the run
+    float ink_end; // Furthest any visible glyph before the break reaches, relative to the start of the run
+};
+
 // A run of glyphs that we get back from harfbuzz. Unlike FontPlatformShapedText where we would have placed
 // the glyphs in accordance with wrapping requirements.
 struct cached_shaped_text_handle
@@ -88,6 +100,10 @@ struct cached_shaped_text_handle
     uint32_t first_glyph; // ---> cached glyph runs
     uint32_t last_glyph; // ---> cached glyph runs
     
+    uint32_t first_break; // ---> cached line breaks, only valid if break_epoch matches the table's
+    uint32_t break_count;
+    uint32_t break_epoch;
+    
     // Stuff for verifying this is our intended text and not a hash colision.
     FontHandle font;
     uint16_t font_size;
@@ -100,6 +116,13 @@ struct text_handle_table
     cached_shaped_text_handle* cached_text_handles;
     uint32_t* hash_table;
     
+    // Note(Leo): Line breaks are bump allocated, once they run out of space the whole table is dropped by moving to
+    //            the next epoch and runs find their breaks again the next time they are wrapped.
+    cached_line_break* cached_breaks;
+    uint32_t break_capacity;
+    uint32_t breaks_allocated;
+    uint32_t break_epoch;
+    
     uint32_t text_handle_count;
     uint32_t glyph_run_count;
     uint32_t hash_count;
@@ -126,8 +149,6 @@ struct FontPlatform
     
     std::map<std::string, loaded_font_handle*>* loaded_font_map;
     
-    hb_buffer_t* shaping_buffer;
-    
     int standard_glyph_size;
     int cache_slot_count;
 
@@ -136,6 +157,50 @@ struct FontPlatform
 
 FontPlatform font_platform;
 
+// Note(Leo): Layout jobs shape text on several threads at once. The text cache, the rasterized glyphs and the faces
+//            (they are resized to shape at a font size) are shared so they are only touched while holding this.
+//            Shaping takes it once per text block to find or shape the run and copies the run out, placing the
+//            glyphs into lines happens after it is let go.
+std::mutex font_cache_lock;
+
+// A glyph of a cached run copied out along with where its raster is in the atlas
+struct run_glyph
+{
+    uint32_t buffer_index;
+    uint32_t run_length;
+    vec2 placement_offsets;
+    vec2 placement_advances;
+    vec2 placement_size;
+    vec3 atlas_offsets;
+    vec2 atlas_size;
+};
+
+// Everything a thread needs to shape on its own, made the first time the thread shapes something
+struct font_shaping_state
+{
+    hb_buffer_t* shaping_buffer;
+    Arena shaping_scratch; // Working memory for the text being shaped (its lines before they are copied in after its glyphs)
+    Arena run_glyphs; // The run being placed
+    Arena run_breaks; // Line breaks of the run being placed
+};
+
+thread_local font_shaping_state shaping_state = {};
+
+font_shaping_state* get_shaping_state()
+{
+    if(!shaping_state.shaping_buffer)
+    {
+        shaping_state.shaping_buffer = hb_buffer_create();
+        hb_buffer_set_cluster_level(shaping_state.shaping_buffer, HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
+        
+        shaping_state.shaping_scratch = CreateArena(Megabytes(32), sizeof(FontPlatformShapedLine));
+        shaping_state.run_glyphs = CreateArena(Megabytes(32), sizeof(run_glyph));
+        shaping_state.run_breaks = CreateArena(Megabytes(8), sizeof(cached_line_break));
+    }
+    
+    return &shaping_state;
+}
+
 cached_shaped_text_handle* get_master_text_handle(text_handle_table* table)
 {
     return table->cached_text_handles;
@@ -147,7 +212,7 @@ cached_shaped_glyph* get_master_shaped_glyph(text_handle_table* table)
 }
 
 // hash_count should be a power of 2 for masking to work properly
-uint64_t get_table_footprint(uint32_t hash_count, uint32_t text_handle_count, uint32_t glyph_run_count)
+uint64_t get_table_footprint(uint32_t hash_count, uint32_t text_handle_count, uint32_t glyph_run_count, uint32_t break_capacity)
 {
     uint64_t size = 0;
     size += sizeof(text_handle_table);
@@ -155,19 +220,20 @@ uint64_t get_table_footprint(uint32_t hash_count, uint32_t text_handle_count, ui
     size += (hash_count + 1) * sizeof(uint32_t); 
     size += (text_handle_count + 1) * sizeof(cached_shaped_text_handle);
     size += (glyph_run_count + 1) * sizeof(cached_shaped_glyph);
+    size += (break_capacity + 1) * sizeof(cached_line_break);
     return size;
 }
 
-text_handle_table* create_text_cache_table(uint32_t hash_count, uint32_t text_handle_count, uint32_t glyph_run_count)
+text_handle_table* create_text_cache_table(uint32_t hash_count, uint32_t text_handle_count, uint32_t glyph_run_count, uint32_t break_capacity)
 {
-    assert(hash_count && text_handle_count && glyph_run_count);
+    assert(hash_count && text_handle_count && glyph_run_count && break_capacity);
     
     // Note(Leo): From https://github.com/cmuratori/refterm/blob/main/refterm.h
     #define IsPowerOfTwo(Value) (((Value) & ((Value) - 1)) == 0)
     // Note(Leo): The hash count should be a power of two for its hash mask to work 
     assert(IsPowerOfTwo(hash_count));
     
-    uint64_t table_size = get_table_footprint(hash_count, text_handle_count, glyph_run_count);
+    uint64_t table_size = get_table_footprint(hash_count, text_handle_count, glyph_run_count, break_capacity);
     text_handle_table* table = (text_handle_table*)malloc(table_size);
     
     if(!table)
@@ -192,6 +258,12 @@ text_handle_table* create_text_cache_table(uint32_t hash_count, uint32_t text_ha
     
     memset(hash_table, 0, hash_count);
     
+    void* cached_breaks = (void*)(table->hash_table + hash_count);
+    table->cached_breaks = align_mem(cached_breaks, cached_line_break);
+    table->break_capacity = break_capacity;
+    table->breaks_allocated = 0;
+    table->break_epoch = 1; // Note(Leo): Handles start at epoch 0 so they have no breaks
+    
     // Note(Leo): The freelist is maintained using the first element of the array as a master. The master maintains the
     //            LRU first/last items aswell. The master also keeps track of the furthest weve allocated into the array
     cached_shaped_text_handle* master_text_handle = get_master_text_handle(table);
@@ -205,34 +277,22 @@ text_handle_table* create_text_cache_table(uint32_t hash_count, uint32_t text_ha
     return table;
 }
 
-cached_shaped_text_handle* get_cached_text_handle(text_handle_table* table, char* buffer, uint32_t buffer_len, FontHandle font, uint16_t font_size)
+uint32_t FontPlatformHashText(char* utf8_buffer, uint32_t buffer_length)
 {
     BEGIN_TIMED_BLOCK(MEOW);
-    meow_u128 buffer_hash = MeowHash(MeowDefaultSeed, buffer_len, buffer);
+    meow_u128 buffer_hash = MeowHash(MeowDefaultSeed, buffer_length, utf8_buffer);
     END_TIMED_BLOCK(MEOW);
-    uint32_t text_hash = MeowU32From(buffer_hash, 0);
-    
-    uint32_t lookup_index = table->hash_table[text_hash & table->hash_mask];
-    if(!lookup_index)
-    {
-        return NULL;
-    }
-    
-    cached_shaped_text_handle* found = &table->cached_text_handles[lookup_index];
-    // Search until we find a match or run out of candidates
-    while(found->font != font || found->buffer_length != buffer_len || found->font_size != font_size)
-    {
-        // No more candidates
-        if(!found->next_with_same_hash)
-        {
-            return NULL;
-        }
-        
-        found = &table->cached_text_handles[found->next_with_same_hash];
-        
-    }
+    return MeowU32From(buffer_hash, 0);
+}
+
+inline bool text_handle_matches(cached_shaped_text_handle* handle, uint32_t text_hash, uint32_t buffer_len, FontHandle font, uint16_t font_size)
+{
+    return handle->hash == text_hash && handle->font == font && handle->buffer_length == buffer_len && handle->font_size == font_size;
+}
 
-    // Update the lru order to reflect this handle being touched
+// Update the lru order to reflect this handle being touched
+void touch_cached_text_handle(text_handle_table* table, cached_shaped_text_handle* found)
+{
     if(found->prev_lru)
     {
         cached_shaped_text_handle* prev = &table->cached_text_handles[found->prev_lru];
@@ -262,7 +322,57 @@ cached_shaped_text_handle* get_cached_text_handle(text_handle_table* table, char
     found->prev_lru = 0;
     found->next_lru = master_text_handle->most_ru;
     master_text_handle->most_ru = found_index;
+}
 
+// Note(Leo): text_hash can be given if its already known, otherwise pass 0 and it will be computed from the buffer
+cached_shaped_text_handle* get_cached_text_handle(text_handle_table* table, char* buffer, uint32_t buffer_len, FontHandle font, uint16_t font_size, uint32_t text_hash = 0)
+{
+    if(!text_hash)
+    {
+        text_hash = FontPlatformHashText(buffer, buffer_len);
+    }
+    
+    uint32_t lookup_index = table->hash_table[text_hash & table->hash_mask];
+    if(!lookup_index)
+    {
+        return NULL;
+    }
+    
+    cached_shaped_text_handle* found = &table->cached_text_handles[lookup_index];
+    // Search until we find a match or run out of candidates
+    while(!text_handle_matches(found, text_hash, buffer_len, font, font_size))
+    {
+        // No more candidates
+        if(!found->next_with_same_hash)
+        {
+            return NULL;
+        }
+        
+        found = &table->cached_text_handles[found->next_with_same_hash];
+        
+    }
+    
+    touch_cached_text_handle(table, found);
+    return found;
+}
+
+// Gets the handle from a previous shape of the same text if it hasnt been evicted/reused since, NULL otherwise
+cached_shaped_text_handle* get_previous_text_handle(text_handle_table* table, uint32_t handle_index, uint32_t text_hash, uint32_t buffer_len, FontHandle font, uint16_t font_size)
+{
+    cached_shaped_text_handle* master_text_handle = get_master_text_handle(table);
+    if(!handle_index || !text_hash || handle_index >= master_text_handle->furthest_allocated)
+    {
+        return NULL;
+    }
+    
+    // Note(Leo): Evicted and free handles are zeroed (font 0) so they wont match
+    cached_shaped_text_handle* found = &table->cached_text_handles[handle_index];
+    if(!text_handle_matches(found, text_hash, buffer_len, font, font_size))
+    {
+        return NULL;
+    }
+    
+    touch_cached_text_handle(table, found);
     return found;
 }
 
@@ -331,14 +441,14 @@ cached_shaped_text_handle* get_or_evict_text_handle(text_handle_table* table, bo
     return used;
 }
 
-cached_shaped_text_handle* insert_cached_text_handle(text_handle_table* table, char* buffer, uint32_t buffer_len, FontHandle font, uint16_t font_size)
+cached_shaped_text_handle* insert_cached_text_handle(text_handle_table* table, char* buffer, uint32_t buffer_len, FontHandle font, uint16_t font_size, uint32_t text_hash = 0)
 {
     assert(table && buffer && buffer_len && font && font_size);
     
-    BEGIN_TIMED_BLOCK(MEOW);
-    meow_u128 buffer_hash = MeowHash(MeowDefaultSeed, buffer_len, buffer);
-    END_TIMED_BLOCK(MEOW);
-    uint32_t text_hash = MeowU32From(buffer_hash, 0);
+    if(!text_hash)
+    {
+        text_hash = FontPlatformHashText(buffer, buffer_len);
+    }
     
     cached_shaped_text_handle* created = NULL;
     
@@ -463,12 +573,8 @@ int InitializeFontPlatform(Arena* master_arena, int standard_glyph_size)
     
     font_platform.loaded_font_map = new std::map<std::string, loaded_font_handle*>;
     
-    font_platform.shaping_buffer = hb_buffer_create();
-    hb_buffer_set_cluster_level(font_platform.shaping_buffer, HB_BUFFER_CLUSTER_LEVEL_CHARACTERS);
-    //hb_buffer_pre_allocate(font_platform.shaping_buffer, Megabytes(1));
-
     // Todo(Leo): Tune these values
-    font_platform.text_cache = create_text_cache_table(0x1000, 1000, 1000000);
+    font_platform.text_cache = create_text_cache_table(0x1000, 1000, 1000000, 500000);
     
     return 0;
 }
@@ -748,6 +854,199 @@ inline FontPlatformGlyph* plaform_get_glyph_or_raster(FontHandle font_handle, ui
     return found;
 }
 
+inline bool is_break_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Lines can start at the start of the run, at the first glyph of every word and at manual newlines
+inline bool is_line_break(cached_shaped_glyph* glyph, char* utf8_buffer, uint32_t glyph_ordinal, bool after_space)
+{
+    char c = utf8_buffer[glyph->buffer_index];
+    return glyph_ordinal == 0 || c == '\n' || (after_space && !is_break_space(c));
+}
+
+// Gets the line breaks of a shaped run, finding them if the run doesnt have any in the table yet. Returns NULL if the
+// run has more breaks than the table can hold.
+cached_line_break* get_line_breaks(text_handle_table* table, cached_shaped_text_handle* handle, char* utf8_buffer)
+{
+    if(handle->break_epoch == table->break_epoch)
+    {
+        return &table->cached_breaks[handle->first_break];
+    }
+    
+    // Note(Leo): Counted first so the breaks can be placed in one piece, +1 for the end of the run
+    uint32_t break_count = 1;
+    uint32_t glyph_ordinal = 0;
+    bool after_space = false;
+    cached_shaped_glyph* curr = &table->cached_glyph_runs[handle->first_glyph];
+    while(curr)
+    {
+        if(is_line_break(curr, utf8_buffer, glyph_ordinal, after_space))
+        {
+            break_count++;
+        }
+        after_space = is_break_space(utf8_buffer[curr->buffer_index]);
+        glyph_ordinal++;
+        curr = curr->next_glyph ? &table->cached_glyph_runs[curr->next_glyph] : NULL;
+    }
+    
+    if(break_count > table->break_capacity)
+    {
+        return NULL;
+    }
+    if(table->breaks_allocated + break_count > table->break_capacity)
+    {
+        table->breaks_allocated = 0;
+        table->break_epoch++;
+    }
+    
+    handle->first_break = table->breaks_allocated;
+    handle->break_count = break_count;
+    handle->break_epoch = table->break_epoch;
+    table->breaks_allocated += break_count;
+    cached_line_break* breaks = &table->cached_breaks[handle->first_break];
+    
+    float advance = 0.0f;
+    float ink_end = 0.0f;
+    uint32_t curr_break = 0;
+    glyph_ordinal = 0;
+    after_space = false;
+    curr = &table->cached_glyph_runs[handle->first_glyph];
+    while(curr)
+    {
+        char c = utf8_buffer[curr->buffer_index];
+        if(is_line_break(curr, utf8_buffer, glyph_ordinal, after_space))
+        {
+            // Note(Leo): next_forced marks forced breaks until it is filled in below
+            breaks[curr_break] = {glyph_ordinal, c == '\n' ? UINT_MAX : 0, advance, ink_end};
+            curr_break++;
+        }
+        
+        after_space = is_break_space(c);
+        if(!after_space)
+        {
+            ink_end = MAX(ink_end, advance + curr->placement_offsets.x + curr->placement_size.x);
+        }
+        advance += curr->placement_advances.x;
+        
+        glyph_ordinal++;
+        curr = curr->next_glyph ? &table->cached_glyph_runs[curr->next_glyph] : NULL;
+    }
+    breaks[curr_break] = {glyph_ordinal, curr_break, advance, ink_end};
+    
+    uint32_t next_forced = curr_break;
+    for(int i = (int)curr_break - 1; i >= 0; i--)
+    {
+        bool forced = breaks[i].next_forced == UINT_MAX;
+        breaks[i].next_forced = next_forced;
+        if(forced)
+        {
+            next_forced = i;
+        }
+    }
+    
+    return breaks;
+}
+
+// Finds the furthest break that the line starting at the given break can end at without anything passing the wrapping
+// point. Lines never go past the next forced break, returns line_start if not even the first word fits.
+uint32_t find_line_end(cached_line_break* breaks, uint32_t line_start, float line_x, float wrapping_point)
+{
+    // Note(Leo): ink_end only grows so whether a break fits only goes from true to false along the line
+    float line_origin = breaks[line_start].advance - line_x;
+    uint32_t low = line_start + 1;
+    uint32_t high = breaks[line_start].next_forced;
+    uint32_t found = line_start;
+    while(low <= high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if(breaks[middle].ink_end - line_origin < wrapping_point)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    
+    return found;
+}
+
+// Adds the line height to the glyphs of the line that was just finished and records the line
+void finish_shaped_line(Arena* glyph_arena, Arena* lines, FontPlatformShapedText* result, FontPlatformShapedGlyph* line_first, uint32_t line_count, float line_y, float top_line_height)
+{
+    uint32_t line_end = (uint32_t)((FontPlatformShapedGlyph*)glyph_arena->next_address - result->first_glyph);
+    
+    FontPlatformShapedLine* line = (FontPlatformShapedLine*)Alloc(lines, sizeof(FontPlatformShapedLine), no_zero());
+    line->first_glyph = line_end - line_count;
+    line->glyph_count = line_count;
+    line->top = line_y;
+    line->bottom = line_y + top_line_height;
+    
+    FontPlatformShapedGlyph* curr_glyph = line_first;
+    for(uint32_t j = 0; j < line_count; j++)
+    {
+        assert(curr_glyph);
+        curr_glyph->placement_offsets.y += top_line_height; 
+        
+        line->top = MIN(line->top, curr_glyph->placement_offsets.y);
+        line->bottom = MAX(line->bottom, curr_glyph->placement_offsets.y + curr_glyph->placement_size.y);
+        
+        curr_glyph++;
+    }
+}
+
+// Sorts glyph indices by the buffer index of their glyphs, keeping glyphs of the same cluster in order. 
+// temp has to fit as many indices as order.
+void sort_by_buffer_index(uint32_t* order, uint32_t* temp, uint32_t count, FontPlatformShapedGlyph* glyphs)
+{
+    uint32_t* from = order;
+    uint32_t* to = temp;
+    for(uint32_t width = 1; width < count; width *= 2)
+    {
+        for(uint32_t start = 0; start < count; start += 2*width)
+        {
+            uint32_t middle = MIN(start + width, count);
+            uint32_t end = MIN(start + 2*width, count);
+            
+            uint32_t left = start;
+            uint32_t right = middle;
+            uint32_t out = start;
+            while(left < middle && right < end)
+            {
+                if(glyphs[from[right]].buffer_index < glyphs[from[left]].buffer_index)
+                {
+                    to[out++] = from[right++];
+                }
+                else
+                {
+                    to[out++] = from[left++];
+                }
+            }
+            while(left < middle)
+            {
+                to[out++] = from[left++];
+            }
+            while(right < end)
+            {
+                to[out++] = from[right++];
+            }
+        }
+        
+        uint32_t* swap = from;
+        from = to;
+        to = swap;
+    }
+    
+    if(from != order)
+    {
+        memcpy(order, from, count*sizeof(uint32_t));
+    }
+}
+
 //const hb_feature_t shaping_features[] = { { HB_TAG('k', 'e', 'r', 'n'), 1, 0, UINT_MAX }, { HB_TAG('l', 'i', 'g', 'a'), 1, 0, UINT_MAX }, { HB_TAG('c', 'l', 'i', 'g'), 1, 0, UINT_MAX } };
 const hb_feature_t shaping_features[] = {
     { HB_TAG('k', 'e', 'r', 'n'), 1, HB_FEATURE_GLOBAL_START, HB_FEATURE_GLOBAL_END },
@@ -756,13 +1055,15 @@ const hb_feature_t shaping_features[] = {
 };
 
 // Note(Leo): Area height and width are expected in pixels
-void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result, StringView* utf8_strings, FontHandle* font_handles, uint16_t* font_sizes, StyleColor* colors, int text_block_count, uint32_t wrapping_point)
+void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result, StringView* utf8_strings, FontHandle* font_handles, uint16_t* font_sizes, StyleColor* colors, int text_block_count, uint32_t wrapping_point, uint32_t* text_keys, uint32_t* shaped_handles)
 {
     // Used to mark the end of our sequence of glyphs
     #define mark_end() Alloc(glyph_arena, sizeof(FontPlatformShapedGlyph), zero())
     assert(result);
     assert(glyph_arena);
     
+    font_shaping_state* state = get_shaping_state();
+    
     // Note(Leo): glyph_arena may be unaligned (if other types have been getting allocated) 
     //            so ensure its aligned to what we want.
     glyph_arena->next_address = (uintptr_t)align_mem(glyph_arena->next_address, FontPlatformShapedGlyph);
@@ -775,6 +1076,12 @@ void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result,
     result->required_width = 0;
     result->required_height = 0;
     result->glyph_count = 0;
+    result->first_line = NULL;
+    result->line_count = 0;
+    result->buffer_order = NULL;
+    result->buffer_glyph_count = 0;
+    
+    ResetArena(&state->shaping_scratch);
     
     float top_line_height = 0.0f;
     float lower_line_height = 0.0f;
@@ -798,13 +1105,26 @@ void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result,
             return;
         }
         
-        cached_shaped_text_handle* cached_glyphs = get_cached_text_handle(font_platform.text_cache, utf8_buffer, buffer_length, font_handle, font_size);
-        
         if(!buffer_length)
         {
             continue;
         }
         
+        uint32_t text_key = text_keys ? text_keys[i] : 0;
+        
+        // Note(Leo): Held until the run has been copied out, see font_cache_lock
+        std::unique_lock<std::mutex> cache_lock(font_cache_lock);
+        
+        cached_shaped_text_handle* cached_glyphs = NULL;
+        if(shaped_handles)
+        {
+            cached_glyphs = get_previous_text_handle(font_platform.text_cache, shaped_handles[i], text_key, buffer_length, font_handle, font_size);
+        }
+        if(!cached_glyphs)
+        {
+            cached_glyphs = get_cached_text_handle(font_platform.text_cache, utf8_buffer, buffer_length, font_handle, font_size, text_key);
+        }
+        
         float font_scale = (float)font_size / (float)font_platform.standard_glyph_size;
         top_line_height = MAX(top_line_height, used_font->line_top_height * font_scale); // See if this font's height should be the current lines height
         lower_line_height = MAX(lower_line_height, used_font->line_bottom_height * font_scale);
@@ -815,22 +1135,22 @@ void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result,
         }
         {
         
-        cached_glyphs = insert_cached_text_handle(font_platform.text_cache, utf8_buffer, buffer_length, font_handle, font_size);
-        hb_buffer_reset(font_platform.shaping_buffer);
-        hb_buffer_add_utf8(font_platform.shaping_buffer, utf8_buffer, buffer_length, 0, -1);
-        hb_buffer_guess_segment_properties(font_platform.shaping_buffer);
+        cached_glyphs = insert_cached_text_handle(font_platform.text_cache, utf8_buffer, buffer_length, font_handle, font_size, text_key);
+        hb_buffer_reset(state->shaping_buffer);
+        hb_buffer_add_utf8(state->shaping_buffer, utf8_buffer, buffer_length, 0, -1);
+        hb_buffer_guess_segment_properties(state->shaping_buffer);
         
         // Change font size to the desired size so that shaping will have the offsets already in the correct size
         FT_Set_Pixel_Sizes(used_font->face, font_size, font_size);
         hb_ft_font_changed(used_font->font);
         
         BEGIN_TIMED_BLOCK(HARFBUZZ);
-        hb_shape(used_font->font, font_platform.shaping_buffer, shaping_features, sizeof(shaping_features) / sizeof(hb_feature_t));
+        hb_shape(used_font->font, state->shaping_buffer, shaping_features, sizeof(shaping_features) / sizeof(hb_feature_t));
         END_TIMED_BLOCK(HARFBUZZ);
         
         unsigned int glyph_count;
-        hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(font_platform.shaping_buffer, &glyph_count);
-        hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(font_platform.shaping_buffer, &glyph_count);
+        hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos(state->shaping_buffer, &glyph_count);
+        hb_glyph_position_t* glyph_pos = hb_buffer_get_glyph_positions(state->shaping_buffer, &glyph_count);
         
         //result->glyph_count += glyph_count;
         
@@ -887,18 +1207,104 @@ void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result,
         }
         shape_glyphs:
         
+        if(shaped_handles)
+        {
+            shaped_handles[i] = index_of(cached_glyphs, font_platform.text_cache->cached_text_handles, cached_shaped_text_handle);
+        }
+        
+        // Copy the run out along with where its glyphs are in the atlas so it can be placed without holding the cache
+        ResetArena(&state->run_glyphs);
+        ResetArena(&state->run_breaks);
+        
+        uint32_t run_glyph_count = 0;
         cached_shaped_glyph* curr_cached_glyph = &font_platform.text_cache->cached_glyph_runs[cached_glyphs->first_glyph];
+        while(curr_cached_glyph)
+        {
+            FontPlatformGlyph* raster_info = plaform_get_glyph_or_raster(font_handle, curr_cached_glyph->glyph_code);
+            
+            run_glyph* copied = (run_glyph*)Alloc(&state->run_glyphs, sizeof(run_glyph), no_zero());
+            copied->buffer_index = curr_cached_glyph->buffer_index;
+            copied->run_length = curr_cached_glyph->run_length;
+            copied->placement_offsets = curr_cached_glyph->placement_offsets;
+            copied->placement_advances = curr_cached_glyph->placement_advances;
+            copied->placement_size = curr_cached_glyph->placement_size;
+            copied->atlas_offsets = RenderPlatformGetGlyphPosition(GlyphSlot(raster_info));
+            copied->atlas_size = { (float)raster_info->width, (float)raster_info->height };
+            run_glyph_count++;
+            
+            if(!curr_cached_glyph->next_glyph)
+            {
+                curr_cached_glyph = NULL;    
+            }
+            else
+            {
+                curr_cached_glyph = &font_platform.text_cache->cached_glyph_runs[curr_cached_glyph->next_glyph];
+            }
+        }
+        
+        // Note(Leo): Lines are planned a word at a time from the run's breaks, the glyphs only have to be checked one by 
+        //            one for words that are wider than a whole line or if the breaks didnt fit in the table.
+        cached_line_break* breaks = NULL;
+        if(wrapping_point)
+        {
+            cached_line_break* cached_breaks = get_line_breaks(font_platform.text_cache, cached_glyphs, utf8_buffer);
+            if(cached_breaks)
+            {
+                breaks = (cached_line_break*)Alloc(&state->run_breaks, cached_glyphs->break_count*sizeof(cached_line_break), no_zero());
+                memcpy(breaks, cached_breaks, cached_glyphs->break_count*sizeof(cached_line_break));
+            }
+        }
+        
+        cache_lock.unlock();
+        
+        run_glyph* curr_run_glyph = (run_glyph*)state->run_glyphs.mapped_address;
+        run_glyph* run_end = curr_run_glyph + run_glyph_count;
         
         FontPlatformShapedGlyph* added_glyph = NULL;
+        uint32_t glyph_ordinal = 0;
+        uint32_t plan_break = 0; // The line is planned again once we get to this break
+        bool wrap_at_plan = false; // The line wraps once we get to plan_break
+        uint32_t glyph_wrap_end = breaks ? 0 : UINT_MAX; // Glyphs before this are wrapped one by one
     
-        while(curr_cached_glyph)
+        while(curr_run_glyph != run_end)
         {
             result->glyph_count++;
         
             // Check linewrap
-            // Todo(Leo): Implement word wrapping as an option
-            bool auto_wrap = wrapping_point && (curr_cached_glyph->placement_offsets.x + curr_cached_glyph->placement_size.x + cursor_x) >= wrapping_point; 
-            bool manual_wrap = utf8_buffer[curr_cached_glyph->buffer_index] == '\n';
+            bool auto_wrap = false;
+            bool manual_wrap = utf8_buffer[curr_run_glyph->buffer_index] == '\n';
+            if(breaks && glyph_ordinal == breaks[plan_break].glyph_ordinal)
+            {
+                auto_wrap = wrap_at_plan && !manual_wrap;
+                float line_x = auto_wrap || manual_wrap ? 0.0f : cursor_x;
+                
+                uint32_t line_end = find_line_end(breaks, plan_break, line_x, (float)wrapping_point);
+                if(line_end == plan_break && line_x > 0.0f)
+                {
+                    // The word doesnt fit after what is already on the line so it starts the next one
+                    auto_wrap = true;
+                    line_end = find_line_end(breaks, plan_break, 0.0f, (float)wrapping_point);
+                }
+                
+                if(line_end == plan_break)
+                {
+                    // The word is wider than a whole line so it has to be broken up
+                    plan_break++;
+                    glyph_wrap_end = breaks[plan_break].glyph_ordinal;
+                    wrap_at_plan = false;
+                }
+                else
+                {
+                    wrap_at_plan = line_end != breaks[plan_break].next_forced;
+                    plan_break = line_end;
+                }
+            }
+            else if(wrapping_point && glyph_ordinal < glyph_wrap_end && cursor_x > 0.0f)
+            {
+                auto_wrap = (curr_run_glyph->placement_offsets.x + curr_run_glyph->placement_size.x + cursor_x) >= wrapping_point; 
+            }
+            glyph_ordinal++;
+            
             if(auto_wrap || manual_wrap)
             {
                 if(auto_wrap)
@@ -907,14 +1313,7 @@ void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result,
                 }
                 
                 // Go back and add line heights to all the glyphs
-                FontPlatformShapedGlyph* curr_glyph = line_first;
-                for(uint32_t j = 0; j < line_count; j++)
-                {
-                    assert(curr_glyph);
-                    curr_glyph->placement_offsets.y += top_line_height; 
-                    
-                    curr_glyph++;
-                }
+                finish_shaped_line(glyph_arena, &state->shaping_scratch, result, line_first, line_count, cursor_y, top_line_height);
                 
                 result->required_height += top_line_height;
                 result->required_height += lower_line_height;
@@ -929,9 +1328,9 @@ void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result,
             
             added_glyph = (FontPlatformShapedGlyph*)Alloc(glyph_arena, sizeof(FontPlatformShapedGlyph), no_zero());
             
-            added_glyph->buffer_index = curr_cached_glyph->buffer_index;
+            added_glyph->buffer_index = curr_run_glyph->buffer_index;
             
-            added_glyph->run_length = curr_cached_glyph->run_length;
+            added_glyph->run_length = curr_run_glyph->run_length;
             
             if(!line_first)
             {
@@ -940,53 +1339,84 @@ void FontPlatformShapeMixed(Arena* glyph_arena, FontPlatformShapedText* result,
             
             line_count++;
             
-            FontPlatformGlyph* added_glyph_raster_info = plaform_get_glyph_or_raster(font_handle, curr_cached_glyph->glyph_code);
-            
             added_glyph->color = color;
             
-            added_glyph->atlas_offsets = RenderPlatformGetGlyphPosition(GlyphSlot(added_glyph_raster_info));
+            added_glyph->atlas_offsets = curr_run_glyph->atlas_offsets;
             
-            added_glyph->atlas_size = { (float)added_glyph_raster_info->width, (float)added_glyph_raster_info->height };
+            added_glyph->atlas_size = curr_run_glyph->atlas_size;
             
-            added_glyph->placement_offsets.x = curr_cached_glyph->placement_offsets.x + cursor_x;
+            added_glyph->placement_offsets.x = curr_run_glyph->placement_offsets.x + cursor_x;
             
-            added_glyph->placement_offsets.y = curr_cached_glyph->placement_offsets.y + cursor_y;
+            added_glyph->placement_offsets.y = curr_run_glyph->placement_offsets.y + cursor_y;
             added_glyph->base_line = cursor_y + top_line_height;
     
-            added_glyph->placement_size.x = curr_cached_glyph->placement_size.x;
-            added_glyph->placement_size.y = curr_cached_glyph->placement_size.y;
+            added_glyph->placement_size.x = curr_run_glyph->placement_size.x;
+            added_glyph->placement_size.y = curr_run_glyph->placement_size.y;
             
             result->required_width = MAX(result->required_width, added_glyph->placement_offsets.x + added_glyph->placement_size.x);
             
-            cursor_x += curr_cached_glyph->placement_advances.x;
-            cursor_y += curr_cached_glyph->placement_advances.y;
+            cursor_x += curr_run_glyph->placement_advances.x;
+            cursor_y += curr_run_glyph->placement_advances.y;
             
-            if(!curr_cached_glyph->next_glyph)
-            {
-                curr_cached_glyph = NULL;    
-            }
-            else
-            {
-                curr_cached_glyph = &font_platform.text_cache->cached_glyph_runs[curr_cached_glyph->next_glyph];
-            }
+            curr_run_glyph++;
         }
         
-         
+        if(i == 0)
+        {
+            result->buffer_glyph_count = result->glyph_count;
+        }
     }
     
     // Add line height to last line
-    FontPlatformShapedGlyph* curr_glyph = line_first;
-    for(uint32_t j = 0; j < line_count; j++ )
-    {
-        assert(curr_glyph);
-        curr_glyph->placement_offsets.y += top_line_height; 
-        
-        curr_glyph++;
-    }
+    finish_shaped_line(glyph_arena, &state->shaping_scratch, result, line_first, line_count, cursor_y, top_line_height);
     
     result->required_height += top_line_height;
     result->required_height += lower_line_height;
     
     mark_end();
+    
+    // Copy the lines in after the glyphs
+    result->line_count = (uint32_t)((state->shaping_scratch.next_address - state->shaping_scratch.mapped_address) / sizeof(FontPlatformShapedLine));
+    void* line_memory = Alloc(glyph_arena, (result->line_count + 1)*sizeof(FontPlatformShapedLine), no_zero());
+    result->first_line = align_mem(line_memory, FontPlatformShapedLine);
+    memcpy(result->first_line, (void*)state->shaping_scratch.mapped_address, result->line_count*sizeof(FontPlatformShapedLine));
+    
+    // Note(Leo): Glyphs can reach into the lines around them so the extents are spread until they only ever grow
+    for(uint32_t i = 1; i < result->line_count; i++)
+    {
+        result->first_line[i].bottom = MAX(result->first_line[i].bottom, result->first_line[i - 1].bottom);
+    }
+    for(int i = (int)result->line_count - 2; i >= 0; i--)
+    {
+        result->first_line[i].top = MIN(result->first_line[i].top, result->first_line[i + 1].top);
+    }
+    
+    // Note(Leo): Harfbuzz hands glyphs back in visual order so right to left text comes out backwards
+    bool in_buffer_order = true;
+    for(uint32_t i = 1; i < result->buffer_glyph_count; i++)
+    {
+        if(result->first_glyph[i].buffer_index < result->first_glyph[i - 1].buffer_index)
+        {
+            in_buffer_order = false;
+            break;
+        }
+    }
+    
+    if(!in_buffer_order)
+    {
+        uint32_t count = result->buffer_glyph_count;
+        void* order_memory = Alloc(glyph_arena, (count + 1)*sizeof(uint32_t), no_zero());
+        result->buffer_order = align_mem(order_memory, uint32_t);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            result->buffer_order[i] = i;
+        }
+        
+        // The lines have been copied out so the scratch is free to sort with
+        ResetArena(&state->shaping_scratch);
+        uint32_t* temp = (uint32_t*)Alloc(&state->shaping_scratch, count*sizeof(uint32_t), no_zero());
+        sort_by_buffer_index(result->buffer_order, temp, count, result->first_glyph);
+    }
+    
     return;
 }
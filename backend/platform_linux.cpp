@@ -9,9 +9,13 @@
 #include <cassert>
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
+#include <X11/Xutil.h>
 #include <unistd.h>
 #include <libgen.h>
 #include <climits>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 Display* x_display = {};
 Visual* x_visual = {};
@@ -28,6 +32,12 @@ float SCROLL_MULTIPLIER;
 
 const char* linux_required_vk_extensions[] = {VK_E_KHR_SURFACE_NAME, VK_E_KHR_XLIB_SURFACE_NAME};
 
+// Note(Leo): A window keeps being ticked for this many frames after its last input/change so that states which take
+//            a frame to settle (mouse up/down this frame, dirty flags set mid tick...) get picked up before it idles.
+#define IDLE_SETTLE_FRAMES 2
+// Note(Leo): How long to wait between ticks when a window is active but its output isnt changing (ticking elements...)
+#define IDLE_FRAME_INTERVAL_NS 6000000
+
 // Left/right scroll buttons for XButtonEvent
 #define Button6 6
 #define Button7 7
@@ -48,6 +58,9 @@ struct linux_platform_state
     uint32_t clipboard_len;
     
     VirtualKeyboard keyboard_state;
+    
+    int wake_fd; // eventfd written to by PlatformWakeMainLoop
+    int frame_timer_fd; // timerfd that paces active windows whose output isnt changing
 };
 
 linux_platform_state platform;
@@ -83,12 +96,42 @@ PlatformWindow* linux_create_window(Arena* windows_arena)
     created_window->height = WINDOW_HEIGHT;
     created_window->controls.keyboard_state = &platform.keyboard_state;
     created_window->window_input_context = xic;
+    created_window->active_frames = IDLE_SETTLE_FRAMES; // Has to be ticked at least once to have anything to show
+    created_window->renderques[0] = CreateArena(sizeof(Element) * 10000, sizeof(Element));
+    created_window->renderques[1] = CreateArena(sizeof(Element) * 10000, sizeof(Element));
     
     linux_vk_create_window_surface(created_window, x_display);
     
     return created_window;
 }
 
+void PlatformPresentSoftwareFrame(PlatformWindow* window, uint32_t* pixels, int width, int height, DirtyRect* rects, uint32_t rect_count)
+{
+    // Note(Leo): 0xAARRGGBB is what a 24/32 bit TrueColor ZPixmap expects so the frame can be put straight onto the window
+    XImage* frame = XCreateImage(x_display, x_visual, x_defaults.default_depth, ZPixmap, 0, (char*)pixels, width, height, 32, width*sizeof(uint32_t));
+    if(!frame)
+    {
+        return;
+    }
+    
+    if(rects)
+    {
+        for(uint32_t i = 0; i < rect_count; i++)
+        {
+            XPutImage(x_display, window->window_handle, window->window_gc, frame, rects[i].x, rects[i].y, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+        }
+    }
+    else
+    {
+        XPutImage(x_display, window->window_handle, window->window_gc, frame, 0, 0, 0, 0, width, height);
+    }
+    XFlush(x_display);
+    
+    // Note(Leo): The pixels belong to the window, XDestroyImage would free them otherwise
+    frame->data = NULL;
+    XDestroyImage(frame);
+}
+
 void print_input_state(PlatformWindow* window)
 {
     printf("Window input state: \n");
@@ -153,6 +196,16 @@ int linux_process_window_event(PlatformWindow* target_window, XEvent* x_event)
             }
             break;
         }
+        case(Expose):
+        {
+            // Note(Leo): Software frames are only presented where they changed and the window has no backing store, so
+            //            skipping the draw for an unchanged renderque would leave the uncovered part empty
+            if(x_event->xexpose.window == target_window->window_handle && RenderplatformWindowExposed(target_window))
+            {
+                target_window->last_renderque = NULL;
+            }
+            break;
+        }
         case(ConfigureNotify):
         {
             target_window->width = x_event->xconfigure.width;
@@ -349,16 +402,63 @@ int linux_process_window_event(PlatformWindow* target_window, XEvent* x_event)
     return return_value;
 }
 
-// Returns flags for the runtime to know the status of the window
-void linux_process_window_events(PlatformWindow* target_window)
+// Sets flags for the runtime to know the status of the window, returns whether there were any events
+bool linux_process_window_events(PlatformWindow* target_window)
 {
     update_control_state(target_window);
     XEvent x_event;
+    bool had_events = false;
     while(XPending(x_display))
     {
         XNextEvent(x_display, &x_event);
         
         target_window->flags |= linux_process_window_event(target_window, &x_event);
+        had_events = true;
+    }
+    
+    if(had_events)
+    {
+        CommitEvents((DOM*)target_window->window_dom);
+    }
+    
+    return had_events;
+}
+
+void PlatformWakeMainLoop()
+{
+    uint64_t wake = 1;
+    write(platform.wake_fd, &wake, sizeof(uint64_t));
+}
+
+// Blocks until there is X input, someone called PlatformWakeMainLoop or, if a window is active, the frame timer fires
+void linux_wait_for_work(bool any_active)
+{
+    // Note(Leo): Xlib may have already read events off the connection into its queue which poll wont see
+    if(XEventsQueued(x_display, QueuedAfterFlush))
+    {
+        return;
+    }
+    
+    itimerspec frame_timer = {};
+    frame_timer.it_value.tv_nsec = any_active ? IDLE_FRAME_INTERVAL_NS : 0; // 0 disarms the timer
+    timerfd_settime(platform.frame_timer_fd, 0, &frame_timer, NULL);
+    
+    pollfd wait_fds[3] = {};
+    wait_fds[0] = { ConnectionNumber(x_display), POLLIN, 0 };
+    wait_fds[1] = { platform.wake_fd, POLLIN, 0 };
+    wait_fds[2] = { platform.frame_timer_fd, POLLIN, 0 };
+    
+    poll(wait_fds, any_active ? 3 : 2, -1);
+    
+    // Drain the counters so they dont wake us again
+    uint64_t drained;
+    if(wait_fds[1].revents & POLLIN)
+    {
+        read(platform.wake_fd, &drained, sizeof(uint64_t));
+    }
+    if(wait_fds[2].revents & POLLIN)
+    {
+        read(platform.frame_timer_fd, &drained, sizeof(uint64_t));
     }
 }
 
@@ -655,9 +755,53 @@ void linux_destroy_window(Arena* windows_arena, PlatformWindow* window)
     
     vk_destroy_window_surface(window);
     
+    FreeArena(&window->renderques[0]);
+    FreeArena(&window->renderques[1]);
+    
     DeAlloc(windows_arena, window);
 }
 
+// Note(Leo): How many ticks a trim interval lasts, a renderque is only trimmed once a whole interval has gone by
+//            needing less than half of what it has touched.
+#define RENDERQUE_TRIM_TICKS 600
+
+// Gives back the pages of the window's current renderque past what recent ticks needed, it has to have just been reset
+void linux_trim_renderque(PlatformWindow* window)
+{
+    window->trim_interval_ticks++;
+    if(window->trim_interval_ticks >= RENDERQUE_TRIM_TICKS)
+    {
+        window->last_renderque_high_water = window->renderque_high_water;
+        window->renderque_high_water = 0;
+        window->trim_interval_ticks = 0;
+    }
+    
+    // Nothing to compare against until a whole interval has gone by
+    if(!window->last_renderque_high_water)
+    {
+        return;
+    }
+    
+    uint32_t needed = MAX(window->last_renderque_high_water, window->renderque_high_water);
+    uint32_t* extent = &window->renderque_extents[window->used_renderque];
+    if(*extent > 2*needed)
+    {
+        TrimArena(&window->renderques[window->used_renderque], needed);
+        *extent = needed;
+    }
+}
+
+// Records how much of its current renderque the window's last tick used
+void linux_track_renderque(PlatformWindow* window)
+{
+    Arena* renderque = &window->renderques[window->used_renderque];
+    uint32_t used = (uint32_t)(renderque->next_address - renderque->mapped_address);
+    
+    window->renderque_high_water = MAX(window->renderque_high_water, used);
+    window->renderque_extents[window->used_renderque] = MAX(window->renderque_extents[window->used_renderque], used);
+    TRACK_HIGH_WATER(RENDERQUE_BYTES, used);
+}
+
 KeyState GetKeyState(uint8_t key_code)
 {
     assert(key_code < VIRTUAL_KEY_COUNT);
@@ -765,14 +909,11 @@ int main()
     
     PlatformWindow* curr_window = platform.first_window;
     
-    // Note(Leo): We use 1 renderque for all the windows then when we loop back we swap them so that we write into the 
-    //            other. This is done so we can safely access the sizing data of elements from the last frame.
-    Arena* renderques[2] = {};  
-    renderques[0] = (Arena*)Alloc(runtime.master_arena, sizeof(Arena), zero());
-    renderques[1] = (Arena*)Alloc(runtime.master_arena, sizeof(Arena), zero());
-    *renderques[0] = CreateArena(sizeof(Element) * 10000, sizeof(Element));
-    *renderques[1] = CreateArena(sizeof(Element) * 10000, sizeof(Element));
-    uint32_t used_renderque = 0;
+    platform.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    platform.frame_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    
+    bool drew_this_pass = false;
+    bool any_active = true;
     
     while(true)
     {
@@ -780,12 +921,20 @@ int main()
         if(!curr_window)
         {
             curr_window = platform.first_window;
-            used_renderque = 1 >> used_renderque;
-            // Reset the arena we will use
-            ResetArena(renderques[used_renderque]);
+            
+            // Note(Leo): Drawing is already throttled by presenting, otherwise sleep until there is something to do
+            if(!drew_this_pass)
+            {
+                linux_wait_for_work(any_active);
+            }
+            drew_this_pass = false;
+            any_active = false;
         }
         
-        linux_process_window_events(curr_window);
+        if(linux_process_window_events(curr_window))
+        {
+            curr_window->active_frames = IDLE_SETTLE_FRAMES;
+        }
                 
         if(curr_window->flags)
         {
@@ -795,6 +944,7 @@ int main()
                 {
                     vk_window_resized(curr_window);
                     curr_window->flags = 0;
+                    curr_window->active_frames = IDLE_SETTLE_FRAMES;
                     continue;
                 }
             }
@@ -812,25 +962,50 @@ int main()
             }
             continue;
         }
-    
+        
+        if(RuntimeWantsFrame((DOM*)curr_window->window_dom))
+        {
+            curr_window->active_frames = IDLE_SETTLE_FRAMES;
+        }
+        
+        // Nothing could have changed since the last tick so theres no need to tick
+        if(!curr_window->active_frames)
+        {
+            curr_window = curr_window->next_window;
+            END_TIMED_BLOCK(PLATFORM_LOOP);
+            continue;
+        }
+        curr_window->active_frames--;
+        
+        // Note(Leo): Write into the renderque we didnt use last tick so we can safely access the sizing data of elements 
+        //            from the last frame.
+        curr_window->used_renderque = 1 >> curr_window->used_renderque;
+        Arena* renderque = &curr_window->renderques[curr_window->used_renderque];
+        ResetArena(renderque);
+        linux_trim_renderque(curr_window);
+        
         BEGIN_TIMED_BLOCK(TICK_AND_BUILD);
-        Arena* final_renderque = RuntimeTickAndBuildRenderque(renderques[used_renderque], (DOM*)curr_window->window_dom, &curr_window->controls, curr_window->width, curr_window->height);
+        Arena* final_renderque = RuntimeTickAndBuildRenderque(renderque, (DOM*)curr_window->window_dom, &curr_window->controls, curr_window->width, curr_window->height);
         END_TIMED_BLOCK(TICK_AND_BUILD);
+        linux_track_renderque(curr_window);
         BEGIN_TIMED_BLOCK(DRAW_WINDOW);
         if(curr_window->width && curr_window->height)
         {
-            if(curr_window->last_renderque && CompareArenaContents(curr_window->last_renderque, final_renderque))
-            {
-                // Todo(Leo): Figure out a more dynamic way of deciding how much we wanna wait!
-                usleep(6000); // Note(Leo): 10ms
-            }
-            else
+            if(!curr_window->last_renderque || !CompareArenaContents(curr_window->last_renderque, final_renderque))
             {
                 RenderplatformDrawWindow(curr_window, final_renderque);
+                curr_window->active_frames = IDLE_SETTLE_FRAMES;
+                drew_this_pass = true;
             }
         }
         END_TIMED_BLOCK(DRAW_WINDOW);
         
+        // The tick itself may have asked for another frame
+        if(curr_window->active_frames || RuntimeWantsFrame((DOM*)curr_window->window_dom))
+        {
+            any_active = true;
+        }
+        
         RuntimeClearTemporal((DOM*)curr_window->window_dom);
         
         curr_window->last_renderque = final_renderque;        
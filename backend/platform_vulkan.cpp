@@ -17,9 +17,12 @@
 #include <vulkan/vulkan.h>
 #include "platform.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <cassert>
 #include "file_system.h"
 #include "graphics_types.h"
+#include "tile_binning.h"
+#include "software_renderer.h"
 
 const char* required_vk_device_extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
@@ -28,9 +31,12 @@ const char* required_vk_device_extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME
 
 #define MAX_RENDER_TILE_SIZE 64 
 
-#define WINDOW_STAGING_SIZE Megabytes(10) // Size of each window's staging buffer
 #define WINDOW_INPUT_SIZE Megabytes(10)
 
+// Note(Leo): Each window's input buffer has the instances followed by the tile bins, the staging buffer has the same layout
+#define WINDOW_TILE_BIN_SIZE Megabytes(4)
+#define WINDOW_STAGING_SIZE (WINDOW_INPUT_SIZE + WINDOW_TILE_BIN_SIZE) // Size of each window's staging buffer
+
 #ifdef NDEBUG
 // Note(Leo): validation layers have/appear to have a memory leak (at least in task manager) so turn them off when investigating leak issues
 #else
@@ -54,6 +60,17 @@ struct vk_atlas_texture
     uvec3 dimensions;
 };
 
+// Note(Leo): Every tile of a loaded image goes up in one submit, the staging buffer is kept until the fence signals and
+//            vk_collect_image_uploads frees it
+struct vk_image_upload
+{
+    VkBuffer stage;
+    VkDeviceMemory stage_memory;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+    vk_image_upload* next;
+};
+
 enum class ScreenOrientation
 {
     ZERO,
@@ -101,15 +118,24 @@ struct VulkanRenderPlatform
     vk_atlas_texture vk_image_atlas;
     uint32_t image_tile_capacity;
     
+    vk_image_upload* vk_pending_uploads;
+    vk_image_upload* vk_free_uploads; // Finished uploads get reused instead of alloc'd again
+    
     Arena* vk_master_arena;
     Arena* vk_swapchain_image_views;
     Arena* image_atlas_tiles;
     Arena* image_handles;
     Arena* vk_binary_data;
+    Arena* vk_image_uploads;
     
     #if PLATFORM_ANDROID
     ScreenOrientation orientation;
     #endif
+    
+    // Note(Leo): Set when vulkan couldnt be started (or RCM_SOFTWARE_RENDERER is set), windows are then drawn by the
+    //            software renderer and presented through the platform instead of a swapchain.
+    bool software;
+    bool software_initialized;
 };
 
 VulkanRenderPlatform rendering_platform;
@@ -664,7 +690,8 @@ bool vk_pick_swapchain_settings(VkSurfaceKHR surface)
     settings.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
     settings.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     settings.presentMode = chosen_mode;
-    settings.clipped = VK_TRUE;
+    // Note(Leo): Partial redraws keep whatever is in the image so obscured pixels cant be left undefined
+    settings.clipped = VK_FALSE;
     settings.oldSwapchain = VK_NULL_HANDLE;
     settings.preTransform = capabilities.currentTransform;
     
@@ -885,6 +912,13 @@ vk_swapchain_image* vk_create_swapchain_image_views(VkSwapchainKHR swapchain)
             printf("Failed to create image view!\n");
         }
         
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if(vkCreateSemaphore(rendering_platform.vk_device, &semaphore_info, 0, &curr->render_finished_semaphore) != VK_SUCCESS)
+        {
+            printf("Failed to create swapchain image semaphore!\n");
+        }
+        
         if(!first)
         {
             first = curr;
@@ -994,7 +1028,14 @@ bool vk_create_descriptor_set_layouts()
     swapchain_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     swapchain_layout_binding.pImmutableSamplers = 0;
     
-    VkDescriptorSetLayoutBinding combined_bindings[] = { input_buffer_layout_binding, swapchain_layout_binding };
+    VkDescriptorSetLayoutBinding tile_bins_layout_binding = {};
+    tile_bins_layout_binding.binding = 2;
+    tile_bins_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    tile_bins_layout_binding.descriptorCount = 1;
+    tile_bins_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    tile_bins_layout_binding.pImmutableSamplers = 0;
+    
+    VkDescriptorSetLayoutBinding combined_bindings[] = { input_buffer_layout_binding, swapchain_layout_binding, tile_bins_layout_binding };
     
     VkDescriptorSetLayoutCreateInfo combined_descriptor_set_create_info = {};
     
@@ -1134,11 +1175,11 @@ bool vk_create_descriptor_pool()
 {
     VkDescriptorPoolSize images_pool_size = {};
     images_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    images_pool_size.descriptorCount = 3 * MAX_WINDOW_COUNT; // Note(Leo): 1 for glyph atlas, 1 for combined images and 1 for output image
+    images_pool_size.descriptorCount = (2 + FRAMES_IN_FLIGHT) * MAX_WINDOW_COUNT; // Note(Leo): 1 for glyph atlas, 1 for combined images and 1 output image for each frame
     
     VkDescriptorPoolSize buffer_pool_size = {};
     buffer_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    buffer_pool_size.descriptorCount = MAX_WINDOW_COUNT; // Note(Leo): 1 input buffer for each window
+    buffer_pool_size.descriptorCount = 2 * FRAMES_IN_FLIGHT * MAX_WINDOW_COUNT; // Note(Leo): 1 input buffer and 1 tile bins buffer for each frame of each window
 
     VkDescriptorPoolSize pool_sizes[] = { images_pool_size, buffer_pool_size };
 
@@ -1146,7 +1187,7 @@ bool vk_create_descriptor_pool()
     pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     pool_info.poolSizeCount = sizeof(pool_sizes)/sizeof(VkDescriptorPoolSize);
     pool_info.pPoolSizes = pool_sizes;
-    pool_info.maxSets = MAX_WINDOW_COUNT * 4;
+    pool_info.maxSets = MAX_WINDOW_COUNT * (FRAMES_IN_FLIGHT + 3);
     
     if(vkCreateDescriptorPool(rendering_platform.vk_device, &pool_info, 0, &(rendering_platform.vk_main_descriptor_pool)) != VK_SUCCESS)
     {
@@ -1192,12 +1233,12 @@ bool vk_create_atlas_descriptor(vk_atlas_texture* input, VkDescriptorType image_
     return true;
 }
 
-bool vk_create_combined_descriptor(PlatformWindow* window)
+bool vk_create_combined_descriptor(vk_window_frame* frame)
 {
-    assert(window);
+    assert(frame);
     assert(rendering_platform.vk_combined_descriptor_layout);
     // Buffer should be created already.
-    assert(window->vk_input_buffer);
+    assert(frame->vk_input_buffer);
     
     VkDescriptorSetAllocateInfo alloc_info = {};
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -1205,32 +1246,42 @@ bool vk_create_combined_descriptor(PlatformWindow* window)
     alloc_info.descriptorSetCount = 1;
     alloc_info.pSetLayouts = &(rendering_platform.vk_combined_descriptor_layout);
     
-    if(vkAllocateDescriptorSets(rendering_platform.vk_device, &alloc_info, &(window->vk_combined_descriptor)) != VK_SUCCESS)
+    if(vkAllocateDescriptorSets(rendering_platform.vk_device, &alloc_info, &(frame->vk_combined_descriptor)) != VK_SUCCESS)
     {
         return false;
     }
     
     VkDescriptorBufferInfo buffer_info = {};
-    buffer_info.buffer = window->vk_input_buffer;
+    buffer_info.buffer = frame->vk_input_buffer;
     buffer_info.offset = 0;
-    buffer_info.range = (uint64_t)window->vk_input_buffer_size;
+    buffer_info.range = WINDOW_INPUT_SIZE;
+    
+    VkDescriptorBufferInfo tile_bins_info = {};
+    tile_bins_info.buffer = frame->vk_input_buffer;
+    tile_bins_info.offset = WINDOW_INPUT_SIZE;
+    tile_bins_info.range = WINDOW_TILE_BIN_SIZE;
     
     VkWriteDescriptorSet buffer_descriptor_write = {};
     buffer_descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    buffer_descriptor_write.dstSet = window->vk_combined_descriptor;
+    buffer_descriptor_write.dstSet = frame->vk_combined_descriptor;
     buffer_descriptor_write.dstBinding = 0;
     buffer_descriptor_write.dstArrayElement = 0;
     buffer_descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     buffer_descriptor_write.descriptorCount = 1;
     buffer_descriptor_write.pBufferInfo = &buffer_info;
     
-    vkUpdateDescriptorSets(rendering_platform.vk_device, 1, &buffer_descriptor_write, 0, 0);
+    VkWriteDescriptorSet tile_bins_descriptor_write = buffer_descriptor_write;
+    tile_bins_descriptor_write.dstBinding = 2;
+    tile_bins_descriptor_write.pBufferInfo = &tile_bins_info;
+    
+    VkWriteDescriptorSet descriptor_writes[] = { buffer_descriptor_write, tile_bins_descriptor_write };
+    vkUpdateDescriptorSets(rendering_platform.vk_device, 2, descriptor_writes, 0, 0);
     
     return true;
 }
 
 // Called every frame to change the swapchain image target of the pipeline.
-void vk_update_combined_descriptor(PlatformWindow* window, VkImageView image_view)
+void vk_update_combined_descriptor(vk_window_frame* frame, VkImageView image_view)
 {
     VkDescriptorImageInfo image_info = {};
     image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
@@ -1239,7 +1290,7 @@ void vk_update_combined_descriptor(PlatformWindow* window, VkImageView image_vie
     
     VkWriteDescriptorSet image_descriptor_write = {};
     image_descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    image_descriptor_write.dstSet = window->vk_combined_descriptor;
+    image_descriptor_write.dstSet = frame->vk_combined_descriptor;
     image_descriptor_write.dstBinding = 1;
     image_descriptor_write.dstArrayElement = 0;
     image_descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
@@ -1299,8 +1350,15 @@ bool vk_create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPrope
     return true;
 }
 
-bool vk_record_command_buffer(VkCommandBuffer buffer, PlatformWindow* window, VkImage target_image, int shape_count)
+// Note(Leo): partial draws only dispatch the dirty_tile_count tiles listed at dirty_tile_offset in the bin buffer and keep
+//            the rest of the image
+// Note(Leo): The frame's staging regions are copied into its input buffer at the start of the same command buffer so the
+//            copy is ordered against the dispatch on the gpu instead of being waited on by the cpu
+bool vk_record_command_buffer(vk_window_frame* frame, PlatformWindow* window, VkImage target_image, int shape_count, TileBins* bins, 
+                              VkBufferCopy* copy_regions, int region_count, bool partial, uint32_t dirty_tile_offset, uint32_t dirty_tile_count)
 {
+    VkCommandBuffer buffer = frame->vk_command_buffer;
+    
     VkCommandBufferBeginInfo begin_recording_info = {};
     begin_recording_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     begin_recording_info.flags = 0; 
@@ -1311,10 +1369,28 @@ bool vk_record_command_buffer(VkCommandBuffer buffer, PlatformWindow* window, Vk
         return false;
     }
     
+    if(region_count)
+    {
+        vkCmdCopyBuffer(buffer, frame->vk_staging_buffer, frame->vk_input_buffer, region_count, copy_regions);
+        
+        VkBufferMemoryBarrier input_barrier = {};
+        input_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        input_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        input_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        input_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        input_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        input_barrier.buffer = frame->vk_input_buffer;
+        input_barrier.offset = 0;
+        input_barrier.size = VK_WHOLE_SIZE;
+        
+        vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, 0, 1, &input_barrier, 0, 0);
+    }
+    
     // Note(Leo): Swapchain image has a unique layout which we have to transfer between to use it.
+    // Coming from UNDEFINED would let the driver throw away the contents partial draws are keeping
     VkImageMemoryBarrier image_barrier = {};
     image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    image_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_barrier.oldLayout = partial ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED;
     image_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
     image_barrier.srcQueueFamilyIndex = rendering_platform.vk_present_queue_family;
     image_barrier.dstQueueFamilyIndex = rendering_platform.vk_compute_queue_family;
@@ -1334,6 +1410,16 @@ bool vk_record_command_buffer(VkCommandBuffer buffer, PlatformWindow* window, Vk
     PushConstants constants = {};
     constants.screen_size = { (float)window->width, (float)window->height };
     constants.shape_count = shape_count;
+    if(bins)
+    {
+        constants.bin_columns = (int32_t)bins->columns;
+        constants.bin_tile_count = (int32_t)(bins->columns*bins->rows);
+    }
+    if(partial)
+    {
+        constants.dirty_tile_offset = (int32_t)dirty_tile_offset;
+        constants.dirty_tile_count = (int32_t)dirty_tile_count;
+    }
     
     #if PLATFORM_ANDROID
     constants.invert_horizontal_axis = rendering_platform.orientation == ScreenOrientation::NINETY;
@@ -1342,7 +1428,7 @@ bool vk_record_command_buffer(VkCommandBuffer buffer, PlatformWindow* window, Vk
 
     vkCmdPushConstants(buffer, rendering_platform.vk_combined_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &constants);
     
-    VkDescriptorSet descriptor_sets[3] = { window->vk_combined_descriptor, rendering_platform.vk_glyph_atlas.descriptor_set, rendering_platform.vk_image_atlas.descriptor_set };
+    VkDescriptorSet descriptor_sets[3] = { frame->vk_combined_descriptor, rendering_platform.vk_glyph_atlas.descriptor_set, rendering_platform.vk_image_atlas.descriptor_set };
     vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, rendering_platform.vk_combined_pipeline_layout, 0, 3, descriptor_sets, 0, 0);
 
     // Note(Leo): The compute shader renders in "tiles" to help with overdraw. Each tile is its own workgroup and invokes the shader
@@ -1364,7 +1450,14 @@ bool vk_record_command_buffer(VkCommandBuffer buffer, PlatformWindow* window, Vk
     uint32_t horizontal_tiles = (width + render_tile_size - 1) / render_tile_size;
     uint32_t vertical_tiles = (height + render_tile_size - 1) / render_tile_size;
     
-    vkCmdDispatch(buffer, horizontal_tiles, vertical_tiles, 1);
+    if(!partial)
+    {
+        vkCmdDispatch(buffer, horizontal_tiles, vertical_tiles, 1);
+    }
+    else if(dirty_tile_count)
+    {
+        vkCmdDispatch(buffer, dirty_tile_count, 1, 1);
+    }
     
     image_barrier = {};
     image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1418,6 +1511,7 @@ void vk_destroy_swapchain_image_views(vk_swapchain_image* first_image_view)
     while(curr)
     {
         vkDestroyImageView(rendering_platform.vk_device, curr->image_view, 0);
+        vkDestroySemaphore(rendering_platform.vk_device, curr->render_finished_semaphore, nullptr);
 
         last = curr;
         curr = curr->next;
@@ -1428,7 +1522,7 @@ void vk_destroy_swapchain_image_views(vk_swapchain_image* first_image_view)
     rendering_platform.vk_swapchain_image_views->first_free.next_free = (FreeBlock*)first_image_view;
 }
 
-int InitializeVulkan(Arena* master_arena, const char** required_extension_names, int required_extension_count, FILE* combined_shader)
+int vk_create_instance(const char** required_extension_names, int required_extension_count, FILE* combined_shader)
 {
     if(!vk_get_hook_address())
     {
@@ -1477,11 +1571,6 @@ int InitializeVulkan(Arena* master_arena, const char** required_extension_names,
     }
     */
     
-    rendering_platform = {};
-    rendering_platform.vk_master_arena = (Arena*)Alloc(master_arena, sizeof(Arena), zero());
-    *(rendering_platform.vk_master_arena) = CreateArena(100*sizeof(Arena), sizeof(Arena));
-    
-    
     VkApplicationInfo app_info = {};
     
     app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -1552,18 +1641,43 @@ int InitializeVulkan(Arena* master_arena, const char** required_extension_names,
     rendering_platform.vk_binary_data = (Arena*)Alloc(rendering_platform.vk_master_arena, sizeof(Arena), zero());
     *(rendering_platform.vk_binary_data) = CreateArena(10000000*sizeof(char), sizeof(char));
     
+    rendering_platform.vk_image_uploads = (Arena*)Alloc(rendering_platform.vk_master_arena, sizeof(Arena), zero());
+    *(rendering_platform.vk_image_uploads) = CreateArena(1000*sizeof(vk_image_upload), sizeof(vk_image_upload));
+    
+    rendering_platform.vk_combined_shader.shader_bin = vk_read_shader_bin(combined_shader, &rendering_platform.vk_combined_shader.shader_length);
+    
+    return 0;   
+}
+
+int InitializeVulkan(Arena* master_arena, const char** required_extension_names, int required_extension_count, FILE* combined_shader)
+{
+    rendering_platform = {};
+    rendering_platform.vk_master_arena = (Arena*)Alloc(master_arena, sizeof(Arena), zero());
+    *(rendering_platform.vk_master_arena) = CreateArena(100*sizeof(Arena), sizeof(Arena));
+    
     rendering_platform.image_atlas_tiles = (Arena*)Alloc(rendering_platform.vk_master_arena, sizeof(Arena), zero());
     *(rendering_platform.image_atlas_tiles) = CreateArena(1000*sizeof(RenderPlatformImageTile), sizeof(RenderPlatformImageTile));
     
     rendering_platform.image_handles = (Arena*)Alloc(rendering_platform.vk_master_arena, sizeof(Arena), zero());
     *(rendering_platform.image_handles) = CreateArena(1000*sizeof(LoadedImageHandle), sizeof(LoadedImageHandle));
     
-    rendering_platform.vk_combined_shader.shader_bin = vk_read_shader_bin(combined_shader, &rendering_platform.vk_combined_shader.shader_length);
+    if(getenv("RCM_SOFTWARE_RENDERER"))
+    {
+        printf("Using the software renderer\n");
+        rendering_platform.software = true;
+        return 0;
+    }
     
-    return 0;   
+    if(vk_create_instance(required_extension_names, required_extension_count, combined_shader) != 0)
+    {
+        printf("Vulkan is unavailable, falling back to the software renderer\n");
+        rendering_platform.software = true;
+    }
+    
+    return 0;
 }
 
-bool vk_create_sync_objects(PlatformWindow* window)
+bool vk_create_sync_objects(vk_window_frame* frame)
 {
     VkSemaphoreCreateInfo semaphore_info = {};
     semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1573,15 +1687,11 @@ bool vk_create_sync_objects(PlatformWindow* window)
     // Note(Leo): Create the fence signalled so renderWindow doesnt get stuck waiting. 
     fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
     
-    if(vkCreateSemaphore(rendering_platform.vk_device, &semaphore_info, 0, &(window->vk_image_available_semaphore)) != VK_SUCCESS)
+    if(vkCreateSemaphore(rendering_platform.vk_device, &semaphore_info, 0, &(frame->vk_image_available_semaphore)) != VK_SUCCESS)
     {
         return false;
     }
-    if(vkCreateSemaphore(rendering_platform.vk_device, &semaphore_info, 0, &(window->vk_render_finished_semaphore)) != VK_SUCCESS)
-    {
-        return false;
-    }
-    if(vkCreateFence(rendering_platform.vk_device, &fence_info, 0, &(window->vk_in_flight_fence)) != VK_SUCCESS)
+    if(vkCreateFence(rendering_platform.vk_device, &fence_info, 0, &(frame->vk_in_flight_fence)) != VK_SUCCESS)
     {
         return false;
     }
@@ -1589,60 +1699,21 @@ bool vk_create_sync_objects(PlatformWindow* window)
     return true;
 }
 
-bool vk_copy_buffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, int src_offset = 0, int dst_offset = 0)
+void vk_destroy_sync_objects(vk_window_frame* frame)
 {
-    VkCommandBufferAllocateInfo alloc_info = {};
-    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    alloc_info.commandPool = rendering_platform.vk_transient_command_pool;
-    alloc_info.commandBufferCount = 1;
-
-    VkCommandBuffer temp_command_buffer;
-    if(vkAllocateCommandBuffers(rendering_platform.vk_device, &alloc_info, &temp_command_buffer) != VK_SUCCESS)
-    {
-        return false;
-    }
-    
-    VkCommandBufferBeginInfo begin_info = {};
-    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    
-    if(vkBeginCommandBuffer(temp_command_buffer, &begin_info) != VK_SUCCESS)
-    {
-        return false;
-    }
-    
-    VkBufferCopy copy_region = {};
-    copy_region.srcOffset = src_offset; 
-    copy_region.dstOffset = dst_offset; 
-    copy_region.size = size;
-    vkCmdCopyBuffer(temp_command_buffer, src_buffer, dst_buffer, 1, &copy_region);
-    
-    vkEndCommandBuffer(temp_command_buffer);
-    VkSubmitInfo submit_info = {};
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &temp_command_buffer;
-    
-    if(vkQueueSubmit(rendering_platform.vk_compute_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
-    {
-        return false;
-    }
-    
-    vkQueueWaitIdle(rendering_platform.vk_compute_queue);
-    
-    vkFreeCommandBuffers(rendering_platform.vk_device, rendering_platform.vk_transient_command_pool, 1, &temp_command_buffer);
-    return true;
+    vkDestroySemaphore(rendering_platform.vk_device, frame->vk_image_available_semaphore, nullptr);
+    vkDestroyFence(rendering_platform.vk_device, frame->vk_in_flight_fence, nullptr);
 }
 
-bool vk_create_staging_buffer(int staging_size, PlatformWindow* window)
+bool vk_create_staging_buffer(int staging_size, vk_window_frame* frame)
 {
-    if(!vk_create_buffer(staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &(window->vk_staging_buffer), &(window->vk_staging_memory)))
+    frame->vk_staging_buffer_size = staging_size;
+    if(!vk_create_buffer(staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &(frame->vk_staging_buffer), &(frame->vk_staging_memory)))
     {
         return false;
     }
     
-    if(vkMapMemory(rendering_platform.vk_device, window->vk_staging_memory, 0, staging_size, 0, &(window->vk_staging_mapped_address)) != VK_SUCCESS)
+    if(vkMapMemory(rendering_platform.vk_device, frame->vk_staging_memory, 0, staging_size, 0, &(frame->vk_staging_mapped_address)) != VK_SUCCESS)
     {
         return false;
     }
@@ -1968,6 +2039,125 @@ vec3 RenderPlatformGetGlyphPosition(int glyph_slot)
     return { (float)position.x, (float)position.y, (float)position.z };
 }
 
+// Frees the staging buffers of uploads the gpu has finished with, never waits
+void vk_collect_image_uploads()
+{
+    vk_image_upload** link = &rendering_platform.vk_pending_uploads;
+    while(*link)
+    {
+        vk_image_upload* upload = *link;
+        if(vkGetFenceStatus(rendering_platform.vk_device, upload->fence) != VK_SUCCESS)
+        {
+            link = &upload->next;
+            continue;
+        }
+        
+        vkDestroyFence(rendering_platform.vk_device, upload->fence, nullptr);
+        vkFreeCommandBuffers(rendering_platform.vk_device, rendering_platform.vk_transient_command_pool, 1, &upload->command_buffer);
+        vkDestroyBuffer(rendering_platform.vk_device, upload->stage, 0);
+        vkFreeMemory(rendering_platform.vk_device, upload->stage_memory, 0);
+        
+        *link = upload->next;
+        upload->next = rendering_platform.vk_free_uploads;
+        rendering_platform.vk_free_uploads = upload;
+    }
+}
+
+// Note(Leo): The atlas stays in GENERAL (which copies are allowed to target) so frames still in flight can keep sampling
+//            the rest of it, the two barriers only order the copy after earlier dispatches and before later ones.
+//            On success the upload owns stage and stage_memory.
+bool vk_upload_image_tiles(VkBuffer stage, VkDeviceMemory stage_memory, VkBufferImageCopy* regions, uint32_t region_count)
+{
+    VkCommandBufferAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = rendering_platform.vk_transient_command_pool;
+    alloc_info.commandBufferCount = 1;
+    
+    VkCommandBuffer command_buffer;
+    if(vkAllocateCommandBuffers(rendering_platform.vk_device, &alloc_info, &command_buffer) != VK_SUCCESS)
+    {
+        return false;
+    }
+    
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    
+    if(vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+    {
+        vkFreeCommandBuffers(rendering_platform.vk_device, rendering_platform.vk_transient_command_pool, 1, &command_buffer);
+        return false;
+    }
+    
+    VkImageMemoryBarrier image_barrier = {};
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = rendering_platform.vk_image_atlas.image;
+    image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    image_barrier.subresourceRange.baseMipLevel = 0;
+    image_barrier.subresourceRange.levelCount = 1;
+    image_barrier.subresourceRange.baseArrayLayer = 0;
+    image_barrier.subresourceRange.layerCount = 1;
+    image_barrier.srcAccessMask = 0;
+    image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &image_barrier);
+    
+    vkCmdCopyBufferToImage(command_buffer, stage, rendering_platform.vk_image_atlas.image, VK_IMAGE_LAYOUT_GENERAL, region_count, regions);
+    
+    image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, 0, 0, 0, 1, &image_barrier);
+    
+    vkEndCommandBuffer(command_buffer);
+    
+    VkFenceCreateInfo fence_info = {};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    
+    VkFence fence;
+    if(vkCreateFence(rendering_platform.vk_device, &fence_info, 0, &fence) != VK_SUCCESS)
+    {
+        vkFreeCommandBuffers(rendering_platform.vk_device, rendering_platform.vk_transient_command_pool, 1, &command_buffer);
+        return false;
+    }
+    
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    
+    if(vkQueueSubmit(rendering_platform.vk_compute_queue, 1, &submit_info, fence) != VK_SUCCESS)
+    {
+        vkDestroyFence(rendering_platform.vk_device, fence, nullptr);
+        vkFreeCommandBuffers(rendering_platform.vk_device, rendering_platform.vk_transient_command_pool, 1, &command_buffer);
+        return false;
+    }
+    
+    vk_image_upload* upload = rendering_platform.vk_free_uploads;
+    if(upload)
+    {
+        rendering_platform.vk_free_uploads = upload->next;
+    }
+    else
+    {
+        upload = (vk_image_upload*)Alloc(rendering_platform.vk_image_uploads, sizeof(vk_image_upload));
+    }
+    
+    upload->stage = stage;
+    upload->stage_memory = stage_memory;
+    upload->command_buffer = command_buffer;
+    upload->fence = fence;
+    upload->next = rendering_platform.vk_pending_uploads;
+    rendering_platform.vk_pending_uploads = upload;
+    
+    return true;
+}
+
 #define ImageTileSlot(tile_ptr) (((uintptr_t)tile_ptr - rendering_platform.image_atlas_tiles->mapped_address) / sizeof(RenderPlatformImageTile)) 
 
 void RenderplatformLoadImage(FILE* image_file, const char* name)
@@ -2000,9 +2190,36 @@ void RenderplatformLoadImage(FILE* image_file, const char* name)
     created_handle->first_tile = curr_tile;
     
     //Note(Leo): 4 bytes per pixel for RGBA
-    void* working_tile_mem = AllocScratch(IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 4);
-    Arena working_tile = CreateArenaWith(working_tile_mem, IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 4, sizeof(char));
+    uint32_t tile_bytes = IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 4;
+    uint32_t tile_count = created_handle->tiled_width * created_handle->tiled_height;
+    
+    // Note(Leo): On the gpu path every tile is written straight into one staging buffer and they all go up in a single
+    //            submit once the image is tiled, the software atlas takes them one at a time out of working_tile.
+    void* working_tile = NULL;
+    VkBuffer stage = VK_NULL_HANDLE;
+    VkDeviceMemory stage_memory = VK_NULL_HANDLE;
+    void* staging_data = NULL;
+    VkBufferImageCopy* regions = NULL;
+    if(rendering_platform.software)
+    {
+        working_tile = AllocScratch(tile_bytes, no_zero());
+    }
+    else
+    {
+        vk_collect_image_uploads();
+        
+        if(!vk_create_buffer(tile_count * tile_bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stage, &stage_memory))
+        {
+            printf("Failed to create a staging buffer for image: %s\n", name);
+            free(image_pixels);
+            return;
+        }
+        
+        vkMapMemory(rendering_platform.vk_device, stage_memory, 0, tile_count * tile_bytes, 0, &staging_data);
+        regions = (VkBufferImageCopy*)AllocScratch(tile_count * sizeof(VkBufferImageCopy));
+    }
     
+    uint32_t tile_index = 0;
     uint32_t cursor_x = 0;
     uint32_t cursor_y = 0;
     
@@ -2032,53 +2249,39 @@ void RenderplatformLoadImage(FILE* image_file, const char* name)
             // 4 bytes per pixel
             image_copy_offset *= 4;
             
-            for(int copy_row = 0; copy_row < curr_tile->content_height; copy_row++)
-            {
-                void* target_row = Alloc(&working_tile, IMAGE_TILE_SIZE * 4, zero());
-                memcpy(target_row, (void*)((uintptr_t)image_pixels + image_copy_offset), curr_tile->content_width * 4);
-                image_copy_offset += (uintptr_t)(created_handle->image_width * 4);
-            }
+            uint8_t* tile_pixels = rendering_platform.software ? (uint8_t*)working_tile : (uint8_t*)staging_data + tile_index * tile_bytes;
             
-            if(!vk_transition_image_layout(rendering_platform.vk_image_atlas.image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL))
-            {
-                printf("Failed transitioning layout for image atlas!\n");
-                return;
-            }
-
-            VkBuffer temp_stage;
-            VkDeviceMemory temp_stage_memory;
+            // Note(Leo): This isnt neccesary but by not sanitizing the tile totally the renderdoc view of the atlas becomes 
+            //            polluted and difficult to judge whether it is working correctly.
+            memset(tile_pixels, 0, tile_bytes);
             
-            if(!vk_create_buffer(IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &temp_stage, &temp_stage_memory))
+            for(int copy_row = 0; copy_row < curr_tile->content_height; copy_row++)
             {
-                return;
+                memcpy(tile_pixels + copy_row * IMAGE_TILE_SIZE * 4, (void*)((uintptr_t)image_pixels + image_copy_offset), curr_tile->content_width * 4);
+                image_copy_offset += (uintptr_t)(created_handle->image_width * 4);
             }
             
-            void* staging_data;
-            vkMapMemory(rendering_platform.vk_device, temp_stage_memory, 0, IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 4, 0, &staging_data);
-            memcpy(staging_data, (void*)working_tile.mapped_address, IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 4);
-            vkUnmapMemory(rendering_platform.vk_device, temp_stage_memory);
-            
-            ivec3 tile_offsets = {(int32_t)curr_tile->atlas_offsets.x, (int32_t)curr_tile->atlas_offsets.y, (int32_t)curr_tile->atlas_offsets.z};
-                    
-            if(!vk_copy_buffer_to_image(temp_stage, rendering_platform.vk_image_atlas.image, (uint32_t)IMAGE_TILE_SIZE, (uint32_t)IMAGE_TILE_SIZE, tile_offsets))
+            if(rendering_platform.software)
             {
-                return;
+                SoftwareRendererUploadImageTile(working_tile, IMAGE_TILE_SIZE, IMAGE_TILE_SIZE, curr_tile->atlas_offsets);
             }
-            
-            if(!vk_transition_image_layout(rendering_platform.vk_image_atlas.image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL))
+            else
             {
-                printf("Failed transitioning layout for glyph image!\n");
-                return;
+                VkBufferImageCopy* region = regions + tile_index;
+                region->bufferOffset = tile_index * tile_bytes;
+                region->bufferRowLength = 0;
+                region->bufferImageHeight = 0;
+                
+                region->imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region->imageSubresource.mipLevel = 0;
+                region->imageSubresource.baseArrayLayer = 0;
+                region->imageSubresource.layerCount = 1;
+                
+                region->imageOffset = { (int32_t)curr_tile->atlas_offsets.x, (int32_t)curr_tile->atlas_offsets.y, (int32_t)curr_tile->atlas_offsets.z };
+                region->imageExtent = { (uint32_t)IMAGE_TILE_SIZE, (uint32_t)IMAGE_TILE_SIZE, 1 };
             }
+            tile_index++;
             
-            vkDestroyBuffer(rendering_platform.vk_device, temp_stage, 0);
-            vkFreeMemory(rendering_platform.vk_device, temp_stage_memory, 0);
-                        
-            ResetArena(&working_tile);
-            // Note(Leo): This isnt neccesary but by not sanitizing this arena totally the renderdoc view of the atlas becomes 
-            //            polluted and difficult to judge whether it is working correctly.
-            memset((void*)working_tile.mapped_address, 0, IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 4);
-                        
             RenderPlatformImageTile* last_tile = curr_tile;
             
             // Dont alloc on very last iteration
@@ -2094,7 +2297,22 @@ void RenderplatformLoadImage(FILE* image_file, const char* name)
         cursor_y += IMAGE_TILE_SIZE;
     }
     
-    DeAllocScratch(working_tile_mem);
+    if(rendering_platform.software)
+    {
+        DeAllocScratch(working_tile);
+    }
+    else
+    {
+        vkUnmapMemory(rendering_platform.vk_device, stage_memory);
+        if(!vk_upload_image_tiles(stage, stage_memory, regions, tile_count))
+        {
+            printf("Failed to upload image: %s\n", name);
+            vkDestroyBuffer(rendering_platform.vk_device, stage, 0);
+            vkFreeMemory(rendering_platform.vk_device, stage_memory, 0);
+        }
+        DeAllocScratch(regions);
+    }
+    
     free(image_pixels);
 }
 
@@ -2211,10 +2429,67 @@ bool vk_initialize_font_atlas()
     return true;
 }   
 
-bool vk_create_input_buffer(PlatformWindow* window)
+bool vk_create_input_buffer(vk_window_frame* frame)
 {
-    window->vk_input_buffer_size = WINDOW_INPUT_SIZE;
-    return vk_create_buffer(WINDOW_INPUT_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &window->vk_input_buffer, &window->vk_input_memory);
+    frame->vk_input_buffer_size = WINDOW_INPUT_SIZE + WINDOW_TILE_BIN_SIZE;
+    return vk_create_buffer(frame->vk_input_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &frame->vk_input_buffer, &frame->vk_input_memory);
+}
+
+bool vk_create_window_frames(PlatformWindow* window)
+{
+    window->vk_frame_index = 0;
+    for(int i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        vk_window_frame* frame = window->vk_frames + i;
+        if(!vk_create_command_buffer(&(frame->vk_command_buffer)))
+        {
+            printf("Failed to create command buffer\n");
+            return false;
+        }
+        
+        if(!vk_create_sync_objects(frame))
+        {
+            printf("Failed to create sync objects!\n");
+            return false;
+        }
+        
+        if(!vk_create_staging_buffer(WINDOW_STAGING_SIZE, frame))
+        {
+            printf("Failed to create a staging buffer!\n");
+            return false;
+        }
+        
+        if(!vk_create_input_buffer(frame))
+        {
+            printf("Failed to create window input buffer!\n");
+            return false;
+        }
+        
+        if(!vk_create_combined_descriptor(frame))
+        {
+            printf("Failed to create window descriptors!\n");
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Note(Leo): The descriptor sets stay allocated since the pool cant free individual sets
+void vk_destroy_window_frames(PlatformWindow* window)
+{
+    for(int i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        vk_window_frame* frame = window->vk_frames + i;
+        vk_destroy_sync_objects(frame);
+        vkFreeCommandBuffers(rendering_platform.vk_device, rendering_platform.vk_main_command_pool, 1, &frame->vk_command_buffer);
+        
+        vkUnmapMemory(rendering_platform.vk_device, frame->vk_staging_memory);
+        vkDestroyBuffer(rendering_platform.vk_device, frame->vk_staging_buffer, 0);
+        vkFreeMemory(rendering_platform.vk_device, frame->vk_staging_memory, 0);
+        vkDestroyBuffer(rendering_platform.vk_device, frame->vk_input_buffer, 0);
+        vkFreeMemory(rendering_platform.vk_device, frame->vk_input_memory, 0);
+    }
 }
 
 void RenderplatformUploadGlyph(void* glyph_data, int glyph_width, int glyph_height, int glyph_slot)
@@ -2230,6 +2505,13 @@ void RenderplatformUploadGlyph(void* glyph_data, int glyph_width, int glyph_heig
     int glyph_size = glyph_width * glyph_height * sizeof(char);
     assert(glyph_size);
     
+    if(rendering_platform.software)
+    {
+        uvec3 glyph_offsets = vk_get_tile_coordinate(&rendering_platform.vk_glyph_atlas, (uint32_t)FontPlatformGetGlyphSize(), glyph_slot);
+        SoftwareRendererUploadGlyph(glyph_data, glyph_width, glyph_height, glyph_offsets);
+        return;
+    }
+    
     if(!vk_transition_image_layout(rendering_platform.vk_glyph_atlas.image, VK_FORMAT_R8_UINT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL))
     {
         printf("Failed transitioning layout for glyph image!\n");
@@ -2267,25 +2549,212 @@ void RenderplatformUploadGlyph(void* glyph_data, int glyph_width, int glyph_heig
     vkFreeMemory(rendering_platform.vk_device, temp_stage_memory, 0);
 }
 
+// Note(Leo): Draws older than this many draws ago have no damage left to rebuild them from, images last drawn before then
+//            (or never drawn) get redrawn fully.
+#define DAMAGE_HISTORY_FRAMES 4
+
+void create_damage_tracking(PlatformWindow* window)
+{
+    if(!window->drawn_instances.mapped_address)
+    {
+        window->drawn_instances = CreateArena(WINDOW_INPUT_SIZE, sizeof(char));
+    }
+    window->damage_reset = true;
+}
+
+void destroy_damage_tracking(PlatformWindow* window)
+{
+    if(window->drawn_instances.mapped_address)
+    {
+        FreeArena(&window->drawn_instances);
+        window->drawn_instances = {};
+    }
+    free(window->damage_history);
+    window->damage_history = NULL;
+    window->damage_columns = 0;
+    window->damage_rows = 0;
+    window->damage_width = 0;
+    window->damage_height = 0;
+}
+
+// Records which tiles this draw changes compared to the last one and keeps its instances for the next draw. Returns the
+// frame number of this draw.
+uint32_t record_window_damage(PlatformWindow* window, Arena* renderque, uint32_t tile_size)
+{
+    uint32_t columns = ((uint32_t)window->width + tile_size - 1) / tile_size;
+    uint32_t rows = ((uint32_t)window->height + tile_size - 1) / tile_size;
+    uint32_t tile_count = columns*rows;
+    
+    // Note(Leo): Nothing drawn at the old size lines up with the new one, even when the tile grid stays the same the
+    //            software renderer's pixels have a different pitch
+    if(window->width != window->damage_width || window->height != window->damage_height)
+    {
+        if(columns != window->damage_columns || rows != window->damage_rows)
+        {
+            free(window->damage_history);
+            window->damage_history = (uint8_t*)malloc(tile_count*DAMAGE_HISTORY_FRAMES);
+            window->damage_columns = columns;
+            window->damage_rows = rows;
+        }
+        window->damage_width = window->width;
+        window->damage_height = window->height;
+        
+        memset(window->damage_history, 1, tile_count*DAMAGE_HISTORY_FRAMES);
+        window->damage_reset = true;
+    }
+    
+    window->damage_frame++;
+    uint8_t* damage = window->damage_history + (window->damage_frame % DAMAGE_HISTORY_FRAMES)*tile_count;
+    
+    uint32_t renderque_size = renderque->next_address - renderque->mapped_address;
+    uint32_t instance_count = renderque_size / sizeof(combined_instance);
+    uint32_t drawn_size = window->drawn_instances.next_address - window->drawn_instances.mapped_address;
+    uint32_t drawn_count = drawn_size / sizeof(combined_instance);
+    
+    if(window->damage_reset)
+    {
+        memset(damage, 1, tile_count);
+    }
+    else
+    {
+        memset(damage, 0, tile_count);
+        DamageTiles((combined_instance*)window->drawn_instances.mapped_address, drawn_count, (combined_instance*)renderque->mapped_address, instance_count, 
+                    (uint32_t)window->width, (uint32_t)window->height, tile_size, damage);
+    }
+    
+    ResetArena(&window->drawn_instances);
+    window->damage_reset = instance_count*sizeof(combined_instance) > (uint32_t)window->drawn_instances.size;
+    if(!window->damage_reset)
+    {
+        void* drawn = Alloc(&window->drawn_instances, instance_count*sizeof(combined_instance), no_zero());
+        memcpy(drawn, (void*)renderque->mapped_address, instance_count*sizeof(combined_instance));
+    }
+    
+    return window->damage_frame;
+}
+
+// Returns the tiles that changed since the draw with the given frame number as a scratch allocation of dirty flags or NULL
+// if the whole window has to be drawn.
+uint8_t* merge_window_damage(PlatformWindow* window, uint32_t drawn_frame)
+{
+    if(!drawn_frame || window->damage_frame - drawn_frame > DAMAGE_HISTORY_FRAMES)
+    {
+        return NULL;
+    }
+    
+    uint32_t tile_count = window->damage_columns*window->damage_rows;
+    uint8_t* merged = (uint8_t*)AllocScratch(tile_count, zero());
+    for(uint32_t frame = drawn_frame + 1; frame <= window->damage_frame; frame++)
+    {
+        uint8_t* damage = window->damage_history + (frame % DAMAGE_HISTORY_FRAMES)*tile_count;
+        for(uint32_t i = 0; i < tile_count; i++)
+        {
+            merged[i] |= damage[i];
+        }
+    }
+    
+    return merged;
+}
+
+void sw_draw_window(PlatformWindow* window, Arena* renderque)
+{
+    if(window->width <= 0 || window->height <= 0)
+    {
+        return;
+    }
+    
+    int pixel_count = window->width*window->height;
+    if(pixel_count > window->sw_pixels_capacity)
+    {
+        free(window->sw_pixels);
+        window->sw_pixels = (uint32_t*)malloc(pixel_count*sizeof(uint32_t));
+        window->sw_pixels_capacity = window->sw_pixels ? pixel_count : 0;
+        window->sw_drawn_frame = 0;
+        if(!window->sw_pixels)
+        {
+            return;
+        }
+    }
+    
+    uint32_t renderque_size = renderque->next_address - renderque->mapped_address;
+    uint32_t shape_count = renderque_size / sizeof(combined_instance);
+    
+    // Note(Leo): sw_pixels is laid out for the size it was last drawn at so a new size always needs a full draw
+    if(window->width != window->damage_width || window->height != window->damage_height)
+    {
+        window->sw_drawn_frame = 0;
+    }
+    
+    uint32_t frame = record_window_damage(window, renderque, SOFTWARE_TILE_SIZE);
+    uint8_t* damage = merge_window_damage(window, window->sw_drawn_frame);
+    window->sw_drawn_frame = frame;
+    
+    if(!damage)
+    {
+        BEGIN_TIMED_BLOCK(RENDER_SUBMIT);
+        SoftwareRendererDraw((combined_instance*)renderque->mapped_address, shape_count, (uint32_t)window->width, (uint32_t)window->height, window->sw_pixels, (uint32_t)window->width);
+        END_TIMED_BLOCK(RENDER_SUBMIT);
+        
+        BEGIN_TIMED_BLOCK(RENDER_PRESENT);
+        PlatformPresentSoftwareFrame(window, window->sw_pixels, window->width, window->height);
+        END_TIMED_BLOCK(RENDER_PRESENT);
+        return;
+    }
+    
+    // Note(Leo): The rest of sw_pixels still holds the last draw so only the dirty tiles get drawn and presented
+    uint32_t tile_count = window->damage_columns*window->damage_rows;
+    uint32_t* dirty_tiles = (uint32_t*)AllocScratch(tile_count*sizeof(uint32_t), no_zero());
+    DirtyRect* dirty_rects = (DirtyRect*)AllocScratch(tile_count*sizeof(DirtyRect), no_zero());
+    uint32_t dirty_tile_count = CollectDirtyTiles(damage, window->damage_columns, window->damage_rows, dirty_tiles);
+    uint32_t dirty_rect_count = CollectDirtyRects(damage, (uint32_t)window->width, (uint32_t)window->height, SOFTWARE_TILE_SIZE, dirty_rects);
+    
+    if(dirty_tile_count)
+    {
+        BEGIN_TIMED_BLOCK(RENDER_SUBMIT);
+        SoftwareRendererDraw((combined_instance*)renderque->mapped_address, shape_count, (uint32_t)window->width, (uint32_t)window->height, window->sw_pixels, (uint32_t)window->width, 
+                             dirty_tiles, dirty_tile_count);
+        END_TIMED_BLOCK(RENDER_SUBMIT);
+        
+        BEGIN_TIMED_BLOCK(RENDER_PRESENT);
+        PlatformPresentSoftwareFrame(window, window->sw_pixels, window->width, window->height, dirty_rects, dirty_rect_count);
+        END_TIMED_BLOCK(RENDER_PRESENT);
+    }
+    
+    DeAllocScratch(dirty_rects);
+    DeAllocScratch(dirty_tiles);
+    DeAllocScratch(damage);
+}
+
 void RenderplatformDrawWindow(PlatformWindow* window, Arena* renderque)
 {
+    if(rendering_platform.software)
+    {
+        sw_draw_window(window, renderque);
+        return;
+    }
+    
+    // Note(Leo): Only waits for the frame that last used this slot, FRAMES_IN_FLIGHT - 1 newer frames can still be running
+    vk_window_frame* frame = window->vk_frames + window->vk_frame_index;
+    
     BEGIN_TIMED_BLOCK(WAIT_FENCE);
-    vkWaitForFences(rendering_platform.vk_device, 1, &(window->vk_in_flight_fence), VK_TRUE, UINT64_MAX);
+    vkWaitForFences(rendering_platform.vk_device, 1, &(frame->vk_in_flight_fence), VK_TRUE, UINT64_MAX);
     
     uint32_t image_index;
     // Note(Leo): != success indicates that the window has been resized (swapchains need to be recreated), return and wait for it to be caught by our main loop 
-    VkResult surface_status = vkAcquireNextImageKHR(rendering_platform.vk_device, window->vk_window_swapchain, UINT64_MAX, window->vk_image_available_semaphore, VK_NULL_HANDLE, &image_index);
+    VkResult surface_status = vkAcquireNextImageKHR(rendering_platform.vk_device, window->vk_window_swapchain, UINT64_MAX, frame->vk_image_available_semaphore, VK_NULL_HANDLE, &image_index);
     if(surface_status != VK_SUCCESS)
     {
         //vk_window_resized(window);
         return;
     }
     
-    vkResetFences(rendering_platform.vk_device, 1, &(window->vk_in_flight_fence));
-    vkResetCommandBuffer(window->vk_command_buffer, 0);
+    vkResetFences(rendering_platform.vk_device, 1, &(frame->vk_in_flight_fence));
+    vkResetCommandBuffer(frame->vk_command_buffer, 0);
     
     END_TIMED_BLOCK(WAIT_FENCE);
     
+    vk_collect_image_uploads();
+    
     vk_swapchain_image* curr = window->vk_first_image;
     for(int i = 0; i < image_index; i++)
     {
@@ -2294,21 +2763,67 @@ void RenderplatformDrawWindow(PlatformWindow* window, Arena* renderque)
     }
     VkImageView used_image_view = curr->image_view;
     
-    vk_update_combined_descriptor(window, used_image_view);
+    vk_update_combined_descriptor(frame, used_image_view);
     
-    memcpy(window->vk_staging_mapped_address, (void*)renderque->mapped_address, renderque->next_address - renderque->mapped_address);
-    vk_copy_buffer(window->vk_staging_buffer, window->vk_input_buffer, renderque->next_address - renderque->mapped_address, 0, 0);
+    uint32_t renderque_size = renderque->next_address - renderque->mapped_address;
+    int shape_count = renderque_size / sizeof(combined_instance);
     
-    int shape_count = (renderque->next_address - renderque->mapped_address) / sizeof(combined_instance);
+    memcpy(frame->vk_staging_mapped_address, (void*)renderque->mapped_address, renderque_size);
     
-    if(!vk_record_command_buffer(window->vk_command_buffer, window, curr->image, shape_count))
+    // Note(Leo): Bins are built straight into the staging buffer, if they dont fit the shader falls back to testing every
+    //            shape at every pixel.
+    BEGIN_TIMED_BLOCK(BIN_TILES);
+    TileBins bins = {};
+    uint32_t* staged_bins = (uint32_t*)((uintptr_t)frame->vk_staging_mapped_address + WINDOW_INPUT_SIZE);
+    uint32_t bin_capacity = WINDOW_TILE_BIN_SIZE / sizeof(uint32_t);
+    uint32_t bins_length = BinInstances((combined_instance*)renderque->mapped_address, shape_count, window->width, window->height, 
+                                        rendering_platform.render_tile_size, staged_bins, bin_capacity, &bins);
+    END_TIMED_BLOCK(BIN_TILES);
+    
+    // Note(Leo): Swapchain images keep what was last drawn into them, so only the tiles that changed since this image's
+    //            last draw are dispatched. Their list goes in the bin buffer right after the bins.
+    uint32_t damage_frame = record_window_damage(window, renderque, (uint32_t)rendering_platform.render_tile_size);
+    uint8_t* damage = merge_window_damage(window, curr->drawn_frame);
+    curr->drawn_frame = damage_frame;
+    
+    bool partial = false;
+    uint32_t dirty_tile_count = 0;
+    if(damage)
+    {
+        if(window->damage_columns*window->damage_rows <= bin_capacity - bins_length)
+        {
+            partial = true;
+            dirty_tile_count = CollectDirtyTiles(damage, window->damage_columns, window->damage_rows, staged_bins + bins_length);
+        }
+        DeAllocScratch(damage);
+    }
+    
+    VkBufferCopy copy_regions[2] = {};
+    int region_count = 0;
+    if(renderque_size)
+    {
+        copy_regions[region_count].size = renderque_size;
+        region_count++;
+    }
+    if(bins_length + dirty_tile_count)
+    {
+        copy_regions[region_count].srcOffset = WINDOW_INPUT_SIZE;
+        copy_regions[region_count].dstOffset = WINDOW_INPUT_SIZE;
+        copy_regions[region_count].size = (bins_length + dirty_tile_count)*sizeof(uint32_t);
+        region_count++;
+    }
+    
+    if(!vk_record_command_buffer(frame, window, curr->image, shape_count, bins_length ? &bins : NULL, copy_regions, region_count, 
+                                 partial, bins_length, dirty_tile_count))
     {
         printf("ERROR: Couldnt record command buffer!\n");
     }
     
-    VkSemaphore wait_semaphores[] = { window->vk_image_available_semaphore };
-    VkSemaphore signal_semaphores[] = { window->vk_render_finished_semaphore };
-    VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT  };
+    VkSemaphore wait_semaphores[] = { frame->vk_image_available_semaphore };
+    VkSemaphore signal_semaphores[] = { curr->render_finished_semaphore };
+    
+    // Note(Leo): The dispatch reads and writes the acquired image so it cant start until the presentation engine is done
+    VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
     
     VkSubmitInfo submit_info = {};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -2316,13 +2831,13 @@ void RenderplatformDrawWindow(PlatformWindow* window, Arena* renderque)
     submit_info.pWaitSemaphores = wait_semaphores;
     submit_info.pWaitDstStageMask = wait_stages;
     submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &(window->vk_command_buffer);
+    submit_info.pCommandBuffers = &(frame->vk_command_buffer);
     submit_info.signalSemaphoreCount = 1;
     submit_info.pSignalSemaphores = signal_semaphores;
     
     BEGIN_TIMED_BLOCK(RENDER_SUBMIT);
     
-    if(vkQueueSubmit(rendering_platform.vk_compute_queue, 1, &submit_info, window->vk_in_flight_fence) != VK_SUCCESS)
+    if(vkQueueSubmit(rendering_platform.vk_compute_queue, 1, &submit_info, frame->vk_in_flight_fence) != VK_SUCCESS)
     {
         printf("ERROR: Couldnt submit draw command buffer!\n");
     }
@@ -2344,29 +2859,60 @@ void RenderplatformDrawWindow(PlatformWindow* window, Arena* renderque)
     
     VkResult que_status = vkQueuePresentKHR(rendering_platform.vk_present_queue, &present_info);
     
+    window->vk_frame_index = (window->vk_frame_index + 1) % FRAMES_IN_FLIGHT;
+    
     END_TIMED_BLOCK(RENDER_PRESENT);
 }
 
-bool RenderplatformSafeToDelete(PlatformWindow* window)
+bool RenderplatformWindowExposed(PlatformWindow* window)
 {
-    if(vkGetFenceStatus(rendering_platform.vk_device, window->vk_in_flight_fence) != VK_SUCCESS)
+    // Note(Leo): The swapchain is presented by the compositor/driver, only software frames are lost when covered up
+    if(!rendering_platform.software)
     {
         return false;
     }
     
+    window->damage_reset = true;
+    window->sw_drawn_frame = 0;
+    return true;
+}
+
+bool RenderplatformSafeToDelete(PlatformWindow* window)
+{
+    // Note(Leo): Software frames are finished by the time RenderplatformDrawWindow returns
+    if(rendering_platform.software)
+    {
+        return true;
+    }
+    
+    for(int i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        if(vkGetFenceStatus(rendering_platform.vk_device, window->vk_frames[i].vk_in_flight_fence) != VK_SUCCESS)
+        {
+            return false;
+        }
+    }
+    
     return true;
 }
 
 void vk_window_resized(PlatformWindow* window)
 {
+    // Note(Leo): The software pixel buffer grows on the next draw if it needs to
+    if(rendering_platform.software)
+    {
+        return;
+    }
+    
     vkDeviceWaitIdle(rendering_platform.vk_device);
 
     vk_destroy_swapchain_image_views(window->vk_first_image);
     vk_destroy_swapchain(window->vk_window_swapchain);
     
-    vkDestroySemaphore(rendering_platform.vk_device, window->vk_image_available_semaphore, nullptr);
-    vkDestroySemaphore(rendering_platform.vk_device, window->vk_render_finished_semaphore, nullptr);
-    vkDestroyFence(rendering_platform.vk_device, window->vk_in_flight_fence, nullptr);
+    for(int i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        vk_destroy_sync_objects(window->vk_frames + i);
+    }
     
     if(!vk_create_swapchain(window->vk_window_surface, window->width, window->height, &(window->vk_window_swapchain)))
     {
@@ -2375,16 +2921,28 @@ void vk_window_resized(PlatformWindow* window)
     
     window->vk_first_image = vk_create_swapchain_image_views(window->vk_window_swapchain);
     
-    vk_create_sync_objects(window);
+    for(int i = 0; i < FRAMES_IN_FLIGHT; i++)
+    {
+        vk_create_sync_objects(window->vk_frames + i);
+    }
+    window->vk_frame_index = 0;
 }
 
 void vk_destroy_window_surface(PlatformWindow* window)
 {
+    destroy_damage_tracking(window);
+    
+    if(rendering_platform.software)
+    {
+        free(window->sw_pixels);
+        window->sw_pixels = NULL;
+        window->sw_pixels_capacity = 0;
+        return;
+    }
+    
     vkDeviceWaitIdle(rendering_platform.vk_device);
     
-    vkDestroySemaphore(rendering_platform.vk_device, window->vk_image_available_semaphore, nullptr);
-    vkDestroySemaphore(rendering_platform.vk_device, window->vk_render_finished_semaphore, nullptr);
-    vkDestroyFence(rendering_platform.vk_device, window->vk_in_flight_fence, nullptr);
+    vk_destroy_window_frames(window);
 
     vk_destroy_swapchain_image_views(window->vk_first_image);
     vk_destroy_swapchain(window->vk_window_swapchain);
@@ -2422,10 +2980,59 @@ void vk_late_initialize()
     rendering_platform.vk_graphics_pipeline_initialized = true;
 }
 
+// Note(Leo): The software atlases dont have a device limit to fit so they are just square layers of tiles, only the layers
+//            that get written to are ever committed.
+#define SOFTWARE_ATLAS_TILES_PER_SIDE 8
+
+uvec3 sw_pick_atlas_dimensions(int total_tile_target, int tile_width)
+{
+    uint32_t tiles_per_layer = SOFTWARE_ATLAS_TILES_PER_SIDE*SOFTWARE_ATLAS_TILES_PER_SIDE;
+    uint32_t required_depth = (total_tile_target + tiles_per_layer - 1) / tiles_per_layer;
+    uint32_t side = tile_width*SOFTWARE_ATLAS_TILES_PER_SIDE;
+    
+    return { side, side, required_depth };
+}
+
+// Software version of vk_late_initialize, the atlases need the glyph size so this also waits for the first window
+void sw_late_initialize()
+{
+    uint32_t glyph_size = (uint32_t)FontPlatformGetGlyphSize();
+    rendering_platform.vk_glyph_atlas.dimensions = sw_pick_atlas_dimensions(GLYPH_ATLAS_COUNT, glyph_size);
+    FontPlatformUpdateCache(SOFTWARE_ATLAS_TILES_PER_SIDE*SOFTWARE_ATLAS_TILES_PER_SIDE*rendering_platform.vk_glyph_atlas.dimensions.z);
+    
+    rendering_platform.vk_image_atlas.dimensions = sw_pick_atlas_dimensions(IMAGE_ATLAS_SIZE, IMAGE_TILE_SIZE);
+    rendering_platform.image_tile_capacity = SOFTWARE_ATLAS_TILES_PER_SIDE*SOFTWARE_ATLAS_TILES_PER_SIDE*rendering_platform.vk_image_atlas.dimensions.z;
+    
+    if(!InitializeSoftwareRenderer(rendering_platform.vk_glyph_atlas.dimensions, rendering_platform.vk_image_atlas.dimensions))
+    {
+        printf("Failed to initialize the software renderer!\n");
+    }
+    rendering_platform.software_initialized = true;
+}
+
+void sw_create_window_surface(PlatformWindow* window)
+{
+    if(!rendering_platform.software_initialized)
+    {
+        sw_late_initialize();
+    }
+    
+    window->sw_pixels = NULL;
+    window->sw_pixels_capacity = 0;
+}
+
 #if PLATFORM_WINDOWS
 #include <windows.h>
 void win32_vk_create_window_surface(PlatformWindow* window, HMODULE windows_module_handle)
 {
+    create_damage_tracking(window);
+    
+    if(rendering_platform.software)
+    {
+        sw_create_window_surface(window);
+        return;
+    }
+    
     VkWin32SurfaceCreateInfoKHR surface_info = {};
     surface_info.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
     
@@ -2464,29 +3071,9 @@ void win32_vk_create_window_surface(PlatformWindow* window, HMODULE windows_modu
         vk_late_initialize();
     }
     
-    if(!vk_create_command_buffer(&(window->vk_command_buffer)))
-    {
-        printf("Failed to create command buffer\n");
-    }
-    
-    if(!vk_create_sync_objects(window))
-    {
-        printf("Failed to create sync objects!\n");
-    }
-
-    if(!vk_create_staging_buffer(WINDOW_STAGING_SIZE, window))
-    {
-        printf("Failed to create a staging buffer!\n");
-    }
-        
-    if(!vk_create_input_buffer(window))
+    if(!vk_create_window_frames(window))
     {
-        printf("Failed to create window input buffer!\n");
-    }
-
-    if(!vk_create_combined_descriptor(window))
-    {
-        printf("Failed to create window descriptors!\n");
+        printf("Failed to create the window's frames!\n");
     }
 }
 
@@ -2497,6 +3084,14 @@ void win32_vk_create_window_surface(PlatformWindow* window, HMODULE windows_modu
 
 void linux_vk_create_window_surface(PlatformWindow* window, Display* x_display)
 {
+    create_damage_tracking(window);
+    
+    if(rendering_platform.software)
+    {
+        sw_create_window_surface(window);
+        return;
+    }
+    
     VkXlibSurfaceCreateInfoKHR surface_info = {};
     surface_info.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
     
@@ -2536,29 +3131,9 @@ void linux_vk_create_window_surface(PlatformWindow* window, Display* x_display)
         vk_late_initialize();
     }
     
-    if(!vk_create_command_buffer(&(window->vk_command_buffer)))
-    {
-        printf("Failed to create command buffer\n");
-    }
-    
-    if(!vk_create_sync_objects(window))
+    if(!vk_create_window_frames(window))
     {
-        printf("Failed to create sync objects!\n");
-    }
-        
-    if(!vk_create_staging_buffer(WINDOW_STAGING_SIZE, window))
-    {
-        printf("Failed to create a staging buffer!\n");
-    }
-    
-    if(!vk_create_input_buffer(window))
-    {
-        printf("Failed to create window input buffer!\n");
-    }
-    
-    if(!vk_create_combined_descriptor(window))
-    {
-        printf("Failed to create window descriptors!\n");
+        printf("Failed to create the window's frames!\n");
     }
 }
 #endif
@@ -2568,6 +3143,14 @@ void linux_vk_create_window_surface(PlatformWindow* window, Display* x_display)
 
 void android_vk_create_window_surface(PlatformWindow* window)
 {
+    create_damage_tracking(window);
+    
+    if(rendering_platform.software)
+    {
+        sw_create_window_surface(window);
+        return;
+    }
+    
     VkAndroidSurfaceCreateInfoKHR  surface_info = {};
     surface_info.sType = VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR;
     
@@ -2604,29 +3187,9 @@ void android_vk_create_window_surface(PlatformWindow* window)
         vk_late_initialize();
     }
     
-    if(!vk_create_command_buffer(&(window->vk_command_buffer)))
-    {
-        printf("Failed to create command buffer\n");
-    }
-    
-    if(!vk_create_sync_objects(window))
-    {
-        printf("Failed to create sync objects!\n");
-    }
-        
-    if(!vk_create_staging_buffer(WINDOW_STAGING_SIZE, window))
-    {
-        printf("Failed to create a staging buffer!\n");
-    }
-    
-    if(!vk_create_input_buffer(window))
-    {
-        printf("Failed to create window input buffer!\n");
-    }
-    
-    if(!vk_create_combined_descriptor(window))
+    if(!vk_create_window_frames(window))
     {
-        printf("Failed to create window descriptors!\n");
+        printf("Failed to create the window's frames!\n");
     }
 }
 #endif
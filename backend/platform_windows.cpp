@@ -31,6 +31,8 @@ struct win32_platform_state
     
     VirtualKeyboard keyboard_state;
     HCURSOR cursors[20]; // You REALLY shouldnt need more than this
+    
+    HANDLE wake_event; // Set by PlatformWakeMainLoop to cut the wait between unchanged frames short
 };
 win32_platform_state platform;
 
@@ -103,6 +105,19 @@ LRESULT win32_main_callback(HWND window_handle, UINT message, WPARAM w_param, LP
             curr_processed_window->height = (int)HIWORD(l_param);
             break;
         }
+        case(WM_PAINT):
+        {
+            // Note(Leo): Software frames are only presented where they changed, so skipping the draw for an unchanged
+            //            renderque would leave the uncovered part empty
+            PAINTSTRUCT paint;
+            BeginPaint(window_handle, &paint);
+            EndPaint(window_handle, &paint);
+            if(RenderplatformWindowExposed(curr_processed_window))
+            {
+                curr_processed_window->last_renderque = NULL;
+            }
+            break;
+        }
         case(WM_DESTROY):
         {
             //curr_processed_window_events.destroy_window = true;
@@ -262,6 +277,38 @@ PlatformWindow* win32_create_window(Arena* windows_arena, const char* window_nam
     return created_window;
 }
 
+void win32_present_rows(HDC device_context, uint32_t* pixels, int width, DirtyRect rect)
+{
+    // Note(Leo): 0xAARRGGBB is the layout of a 32 bit BI_RGB DIB, negative height makes it top down like the frame. The DIB
+    //            starts at the rect's first row so the source y is always 0 (its meaning flips between top down and bottom up).
+    BITMAPINFO frame_info = {};
+    frame_info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    frame_info.bmiHeader.biWidth = width;
+    frame_info.bmiHeader.biHeight = -(LONG)rect.height;
+    frame_info.bmiHeader.biPlanes = 1;
+    frame_info.bmiHeader.biBitCount = 32;
+    frame_info.bmiHeader.biCompression = BI_RGB;
+    
+    StretchDIBits(device_context, rect.x, rect.y, rect.width, rect.height, rect.x, 0, rect.width, rect.height, pixels + rect.y*width, &frame_info, DIB_RGB_COLORS, SRCCOPY);
+}
+
+void PlatformPresentSoftwareFrame(PlatformWindow* window, uint32_t* pixels, int width, int height, DirtyRect* rects, uint32_t rect_count)
+{
+    HDC device_context = GetDC(window->window_handle);
+    if(rects)
+    {
+        for(uint32_t i = 0; i < rect_count; i++)
+        {
+            win32_present_rows(device_context, pixels, width, rects[i]);
+        }
+    }
+    else
+    {
+        win32_present_rows(device_context, pixels, width, { 0, 0, (uint32_t)width, (uint32_t)height });
+    }
+    ReleaseDC(window->window_handle, device_context);
+}
+
 // Returns -1 if searched char is not found, otherwise returns the index of the last instance of searched_char
 int find_last_of(const char* c_string, char searched_char)
 {
@@ -403,6 +450,9 @@ void win32_process_window_events(PlatformWindow* target_window)
         DispatchMessage(&message);
     }
     
+    // Note(Leo): Committed after the whole pump since WM_CHAR fills in the key event that came before it
+    CommitEvents((DOM*)target_window->window_dom);
+    last_event = NULL;
     curr_processed_window = NULL;
     
     target_window->flags = target_window->flags | return_value;
@@ -456,6 +506,9 @@ int main()
     
     platform.cursors[0] = LoadCursor(NULL, IDC_ARROW);
     
+    // Note(Leo): Auto reset so a wake only cuts one wait short
+    platform.wake_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    
     InitializeFontPlatform(&(platform.master_arena), 0);
     
     FILE* default_font = win32_open_relative_file_path("resources/fonts/default.ttf", "rb");
@@ -576,7 +629,8 @@ int main()
             if(curr_window->last_renderque && CompareArenaContents(curr_window->last_renderque, final_renderque))
             {
                 // Todo(Leo): Figure out a more dynamic way of deciding how much we wanna wait!
-                Sleep(6);
+                // Note(Leo): Input or a PlatformWakeMainLoop from another thread ends the wait early
+                MsgWaitForMultipleObjects(1, &platform.wake_event, FALSE, 6, QS_ALLINPUT);
             }
             else
             {
@@ -611,6 +665,12 @@ void PlatformRegisterDom(void* dom)
     platform.first_window = created_window;
 }
 
+// Note(Leo): The main loop here keeps ticking and only waits between unchanged frames, this ends that wait early
+void PlatformWakeMainLoop()
+{
+    SetEvent(platform.wake_event);
+}
+
 void PlatformSetWindowTitle(DOM* dom, const char* utf8_buffer, uint32_t buffer_len)
 {
     PlatformWindow* curr_window = platform.first_window;
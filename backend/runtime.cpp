@@ -22,6 +22,8 @@ void InitRuntime(Arena* master_arena, Runtime* target)
     target->styles = (Arena*)Alloc(master_arena, sizeof(Arena));
     target->bound_expressions = (Arena*)Alloc(master_arena, sizeof(Arena));
     target->strings = (Arena*)Alloc(master_arena, sizeof(Arena));
+    target->type_styles = (Arena*)Alloc(master_arena, sizeof(Arena));
+    target->class_styles = (Arena*)Alloc(master_arena, sizeof(Arena));
 
     *(target->loaded_files) = CreateArena(100*sizeof(LoadedFileHandle), sizeof(LoadedFileHandle));
     *(target->loaded_tags) = CreateArena(10000*sizeof(Compiler::Tag), sizeof(Compiler::Tag));
@@ -35,6 +37,8 @@ void InitRuntime(Arena* master_arena, Runtime* target)
     *(target->styles) = CreateArena(100*sizeof(Style), sizeof(Style));
     *(target->bound_expressions) = CreateArena(1000*sizeof(BoundExpression), sizeof(BoundExpression));
     *(target->strings) = CreateArena(1000000*sizeof(StringBlock), sizeof(StringBlock));
+    *(target->type_styles) = CreateArena(100*sizeof(FileTypeStyles), sizeof(FileTypeStyles));
+    *(target->class_styles) = CreateArena(10000*sizeof(SelectorVariants), sizeof(SelectorVariants));
 }
 
 Runtime runtime;
@@ -186,6 +190,24 @@ int InitializeRuntime(Arena* master_arena, FileSearchResult* first_binary)
         curr++;
     }
     
+    // Note(Leo): Done after every file is loaded since selectors can use styles from any file
+    LoadedFileHandle* curr_file = (LoadedFileHandle*)runtime.loaded_files->mapped_address;
+    while((uintptr_t)curr_file < runtime.loaded_files->next_address)
+    {
+        ConvertTypeStyles(curr_file->file_id);
+        curr_file++;
+    }
+    
+    Compiler::Attribute* curr_attribute = (Compiler::Attribute*)runtime.loaded_attributes->mapped_address;
+    while((uintptr_t)curr_attribute < runtime.loaded_attributes->next_address)
+    {
+        if(curr_attribute->type == Compiler::AttributeType::BAKED_CLASS)
+        {
+            ConvertClassStyles(curr_attribute);
+        }
+        curr_attribute++;
+    }
+    
     register_binding_subscriptions(&runtime);
     
     return 0;
@@ -258,14 +280,19 @@ void SwitchPage(DOM* dom, int id, int flags)
     // Clear elements/data from dom
     ResetArena(dom->cached_cstrings);
     ResetArena(dom->dynamic_cstrings);
+    memset(dom->free_text_buffers, 0, sizeof(dom->free_text_buffers));
     ResetArena(dom->strings);
     ResetArena(dom->pointer_arrays);
     ResetArena(dom->elements);
+    dom->live_element_count = 0;
+    dom->layout_spacer_count = 0;
+    ResetArena(dom->override_styles);
     ResetArena(dom->attributes);
-    ResetArena(dom->events);
+    memset(dom->free_attribute_blocks, 0, sizeof(dom->free_attribute_blocks));
+    ClearEvents(dom);
+    ResetArena(dom->hover_chain);
+    dom->hit_grid = NULL;
     dom->focused_element = NULL;
-    dom->event_count = 0;
-    dom->last_event = 0;
     
     InstancePage(dom, id);    
 }
@@ -339,66 +366,185 @@ Selector* GetGlobalSelector(StringView local_name, int file_id)
     return found;
 }
 
-// Merge the style of an element based on its type selector into the given style
-void merge_element_type_style(ElementType type, bool is_hovered, int file_id, InFlightStyle* target)
+// Name of the selector that selects each element type, NULL for types that cant be selected
+const char* type_selector_names[ELEMENT_TYPE_COUNT] = {
+    NULL,   // NONE
+    "root", // ROOT
+    NULL,   // TEXT
+    "hdiv", // HDIV
+    "vdiv", // VDIV
+    NULL,   // CUSTOM
+    "grid", // GRID
+    "img",  // IMG
+    NULL,   // VIDEO
+    NULL,   // EACH
+};
+
+// Suffixes of the state variants of a selector, indexed by SelectorState
+const char* selector_state_suffixes[(int)SelectorState::COUNT] = { "", "!hover", "!mousedown" };
+
+// Merges the state variants of a selector into target, each state is merged on top of the state before it.
+void merge_selector_variants(Selector** variants, SelectorVariants* target)
 {
-    ArenaString* selector = CreateString(runtime.strings);
-    switch(type)
+    for(int i = 0; i < (int)SelectorState::COUNT; i++)
     {
-        case(ElementType::ROOT):
+        if(i == 0)
         {
-            Append(selector, "root");
-            break;
+            DefaultStyle(&target->styles[i]);
+            target->has_style[i] = false;
         }
-        case(ElementType::HDIV):
-        {
-            Append(selector, "hdiv");
-            break;
-        }
-        case(ElementType::VDIV):
+        else
         {
-            Append(selector, "hdiv");
-            break;
+            memcpy(&target->styles[i], &target->styles[i - 1], sizeof(InFlightStyle));
+            target->has_style[i] = target->has_style[i - 1];
         }
-        case(ElementType::IMG):
+        
+        if(variants[i])
         {
-            Append(selector, "img");
-            break;
+            MergeStyles(&target->styles[i], merge_selector_styles(variants[i]));
+            target->has_style[i] = true;
         }
-        case(ElementType::GRID):
+    }
+}
+
+// Resolves all the type selectors of a file into the runtime's type style table
+void ConvertTypeStyles(int file_id)
+{
+    FileTypeStyles* arena_base = (FileTypeStyles*)runtime.type_styles->mapped_address;
+    
+    // Test if we need to allocate more space for this file to have its slot
+    if((arena_base + file_id) >= (FileTypeStyles*)runtime.type_styles->next_address) 
+    {
+        // + 1 since if we are allocated up to the required address we are still 1 short
+        int allocated_count = ((arena_base + file_id) + 1) - (FileTypeStyles*)runtime.type_styles->next_address;
+        Alloc(runtime.type_styles, sizeof(FileTypeStyles) * allocated_count, zero());
+    }
+    
+    FileTypeStyles* added = arena_base + file_id;
+    
+    for(int i = 0; i < ELEMENT_TYPE_COUNT; i++)
+    {
+        const char* name = type_selector_names[i];
+        if(!name)
         {
-            Append(selector, "grid");
-            break;
+            continue;
         }
-        default:
+        
+        Selector* variants[(int)SelectorState::COUNT] = {};
+        
+        for(int j = 0; j < (int)SelectorState::COUNT; j++)
         {
-            break;
+            int variant_length = snprintf(NULL, 0, "%s%s", name, selector_state_suffixes[j]);
+            char* variant_name = (char*)AllocScratch((variant_length + 1)*sizeof(char)); // +1 to fit \0
+            sprintf(variant_name, "%s%s", name, selector_state_suffixes[j]);
+            
+            variants[j] = GetGlobalSelector({variant_name, (uint32_t)variant_length}, file_id);
+            
+            DeAllocScratch(variant_name);
         }
+        
+        merge_selector_variants(variants, &added->types[i]);
     }
+}
+
+// Merges the variants of a class that was baked by the compiler into the runtime's class style table
+void ConvertClassStyles(Compiler::Attribute* baked_class)
+{
+    assert(baked_class->type == Compiler::AttributeType::BAKED_CLASS);
     
-    char* base_name = Flatten(selector);
-    Selector* base_selector = GetGlobalSelector({base_name, (uint32_t)selector->length}, file_id);
+    int selector_id = baked_class->BakedClass.selector_ids[0];
+    SelectorVariants* arena_base = (SelectorVariants*)runtime.class_styles->mapped_address;
     
-    if(base_selector)
+    // Test if we need to allocate more space for this class to have its slot
+    if((arena_base + selector_id) >= (SelectorVariants*)runtime.class_styles->next_address) 
     {
-        InFlightStyle* base_style = merge_selector_styles(base_selector);
-        MergeStyles(target, base_style);
+        // + 1 since if we are allocated up to the required address we are still 1 short
+        int allocated_count = ((arena_base + selector_id) + 1) - (SelectorVariants*)runtime.class_styles->next_address;
+        Alloc(runtime.class_styles, sizeof(SelectorVariants) * allocated_count, zero());
     }
-    if(is_hovered)
+    
+    SelectorVariants* added = arena_base + selector_id;
+    
+    // Note(Leo): Every element with this class shares the same slot so it only needs to be merged once
+    if(added->has_style[(int)SelectorState::NORMAL])
     {
-        Append(selector, "!hover");
-        char* hovered_name = Flatten(selector);
-        Selector* hovered_selector = GetGlobalSelector({hovered_name, (uint32_t)selector->length}, file_id);
-        if(hovered_selector)
-        {
-            InFlightStyle* hovered_style = merge_selector_styles(hovered_selector);
-            MergeStyles(target, hovered_style);
-        }
-        DeAllocScratch(hovered_name);
+        return;
+    }
+    
+    Selector* variants[(int)SelectorState::COUNT] = {};
+    for(int i = 0; i < (int)SelectorState::COUNT; i++)
+    {
+        int variant_id = baked_class->BakedClass.selector_ids[i];
+        variants[i] = variant_id ? (Selector*)runtime.selectors->mapped_address + variant_id : NULL;
     }
     
-    DeAllocScratch(base_name); 
-    FreeString(selector);
+    merge_selector_variants(variants, added);
+}
+
+FileTypeStyles* GetFileTypeStyles(int file_id)
+{
+    FileTypeStyles* found = (FileTypeStyles*)runtime.type_styles->mapped_address + file_id;
+    if((uintptr_t)found >= runtime.type_styles->next_address)
+    {
+        return NULL;
+    }
+    
+    return found;
+}
+
+SelectorVariants* GetClassStyles(int selector_id)
+{
+    SelectorVariants* found = (SelectorVariants*)runtime.class_styles->mapped_address + selector_id;
+    if(!selector_id || (uintptr_t)found >= runtime.class_styles->next_address)
+    {
+        return NULL;
+    }
+    
+    return found;
+}
+
+// Which state variant of its selectors an element should be styled with
+SelectorState get_selector_state(Element* element)
+{
+    if((element->flags & is_hovered()) == 0)
+    {
+        return SelectorState::NORMAL;
+    }
+    
+    if(element->click_state == ClickState::MOUSE_DOWN)
+    {
+        return SelectorState::MOUSEDOWN;
+    }
+    
+    return SelectorState::HOVER;
+}
+
+// Merge the style of an element based on its type selector into the given style
+void merge_element_type_style(ElementType type, SelectorState state, int file_id, InFlightStyle* target)
+{
+    FileTypeStyles* file_styles = GetFileTypeStyles(file_id);
+    if(!file_styles)
+    {
+        return;
+    }
+    
+    SelectorVariants* type_styles = &file_styles->types[(int)type];
+    if(type_styles->has_style[(int)state])
+    {
+        MergeStyles(target, &type_styles->styles[(int)state]);
+    }
+}
+
+// Merge the style of an element's baked class into the given style
+void merge_baked_class_style(Attribute* class_attribute, SelectorState state, InFlightStyle* target)
+{
+    assert(class_attribute->type == AttributeType::BAKED_CLASS);
+    
+    SelectorVariants* class_styles = class_attribute->BakedClass.styles;
+    if(class_styles && class_styles->has_style[(int)state])
+    {
+        MergeStyles(target, &class_styles->styles[(int)state]);
+    }
 }
 
 void update_click_state(Element* target, PlatformControlState* controls)
@@ -550,40 +696,289 @@ void merge_element_class_style(Element* element, Attribute* class_attribute)
     FreeString(class_string);
 }
 
-// Note(Leo): Called for every element every frame!!!!!!
-void runtime_evaluate_attributes(DOM* dom, PlatformControlState* controls, Element* element)
+// FNV-1a over the blocks of an arena string, mixed with its length so it can be compared without flattening
+uint64_t fingerprint_string(ArenaString* string)
 {
-    BEGIN_TIMED_BLOCK(EVALUATE_ATTRIBUTES);
+    uint64_t hash = 14695981039346656037ULL;
+    StringBlock* curr_block = string->head;
+    while(curr_block)
+    {
+        for(int i = 0; i < curr_block->fill_level; i++)
+        {
+            hash ^= (uint8_t)curr_block->content[i];
+            hash *= 1099511628211ULL;
+        }
+        curr_block = curr_block->next;
+    }
     
-    DefaultStyle(&element->working_style);
-    if(element->last_sizing)
+    return hash ^ ((uint64_t)string->length << 32);
+}
+
+uint64_t fingerprint_bytes(uint64_t hash, const void* data, uint32_t size)
+{
+    for(uint32_t i = 0; i < size; i++)
     {
-        // Element is hovered
-        if(controls->cursor_pos.x != 0.0f && controls->cursor_pos.y != 0.0f &&
-            PointInsideBounds(element->last_sizing->bounds, controls->cursor_pos))
+        hash ^= ((uint8_t*)data)[i];
+        hash *= 1099511628211ULL;
+    }
+    
+    return hash;
+}
+
+// Hashes everything evaluation produces that the layout of the element depends on
+uint64_t get_layout_fingerprint(Element* element)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t hidden = element->flags & is_hidden();
+    
+    hash = fingerprint_bytes(hash, &element->working_style, sizeof(InFlightStyle));
+    hash = fingerprint_bytes(hash, &hidden, sizeof(uint64_t));
+    
+    switch(element->type)
+    {
+        case(ElementType::TEXT):
         {
-            element->flags = element->flags | is_hovered(); 
+            // Note(Leo): Text without a key is bound text too large to keep on the text buffers, it is rewritten to the
+            //            frame arena every frame (where addresses repeat) so the binding output's fingerprint stands in.
+            if(element->Text.text_key)
+            {
+                hash = fingerprint_bytes(hash, &element->Text.text_key, sizeof(uint32_t));
+            }
+            else
+            {
+                hash = fingerprint_bytes(hash, &element->Text.fingerprint, sizeof(uint64_t));
+            }
+            hash = fingerprint_bytes(hash, &element->Text.temporal_text_length, sizeof(uint32_t));
+            break;
+        }
+        case(ElementType::IMG):
+        {
+            hash = fingerprint_bytes(hash, &element->Image.handle, sizeof(LoadedImageHandle*));
+            break;
+        }
+        case(ElementType::EACH):
+        {
+            hash = fingerprint_bytes(hash, &element->Each.leading_space, sizeof(float));
+            hash = fingerprint_bytes(hash, &element->Each.trailing_space, sizeof(float));
+            break;
         }
-        else // Not hovered
+        default:
         {
-            element->flags &= ~is_hovered(); 
+            break;
         }
     }
     
-    update_click_state(element, controls);
+    return hash;
+}
+
+// Moves the output of a text binding into the element, reusing the last output if it hasnt changed
+void set_bound_text(DOM* dom, Element* element, ArenaString* binding_text)
+{
+    uint64_t fingerprint = fingerprint_string(binding_text);
+    uint32_t length = (uint32_t)binding_text->length;
+    
+    if(element->Text.stable_text && element->Text.fingerprint == fingerprint)
+    {
+        // Note(Leo): Same output as last time so the stable copy, its cache key and shaped handle are all still good
+        element->Text.temporal_text = element->Text.stable_text;
+        element->Text.temporal_text_length = length;
+        return;
+    }
+    
+    // Note(Leo): A \0 is automatically added by flatten so account for it
+    if(element->Text.stable_text && element->Text.stable_text_capacity < length + 1)
+    {
+        DeAllocTextBuffer(dom, element->Text.stable_text, element->Text.stable_text_capacity);
+        element->Text.stable_text = NULL;
+        element->Text.stable_text_capacity = 0;
+    }
+    if(!element->Text.stable_text)
+    {
+        element->Text.stable_text = AllocTextBuffer(dom, length + 1, &element->Text.stable_text_capacity);
+    }
+    
+    element->Text.temporal_text_length = length;
+    element->Text.shaped_handle = 0;
+    
+    if(!element->Text.stable_text) // Too large to keep around so it goes on the frame arena every time
+    {
+        // Note(Leo): Kept so the layout fingerprint still changes with the text, the check above needs stable_text
+        //            so this never lets the frame arena copy be reused
+        element->Text.fingerprint = fingerprint;
+        element->Text.text_key = 0;
+        element->Text.temporal_text = (char*)Alloc(dom->frame_arena, sizeof(char)*(length + 1));
+        Flatten(binding_text, element->Text.temporal_text, length + 1);
+        return;
+    }
+    
+    Flatten(binding_text, element->Text.stable_text, length + 1);
+    element->Text.temporal_text = element->Text.stable_text;
+    element->Text.fingerprint = fingerprint;
+    element->Text.text_key = FontPlatformHashText(element->Text.stable_text, length);
+}
+
+#define VIRTUAL_EACH_OVERSCAN 4 // Extra instances kept on either side of the visible ones
+#define VIRTUAL_EACH_DEFAULT_ROW_HEIGHT 20.0f // Used until a virtual each without a fixed row height has been laid out
+
+inline float pixel_size(Measurement measurement)
+{
+    return measurement.type == MeasurementType::PIXELS ? measurement.size : 0.0f;
+}
+
+// Size of a laid out element along one axis including its margins
+inline float outer_size(LayoutElement* sizing, bool is_vertical)
+{
+    size_axis* axis = is_vertical ? &sizing->sizing.height : &sizing->sizing.width;
+    return axis->current + pixel_size(axis->margin1) + pixel_size(axis->margin2);
+}
+
+// Works out which indices of a virtual each are inside its parent's visible region (based on last frame's layout) 
+// Note(Leo): Only vdivs, hdivs and roots stack the instances so that their position can be worked out from the index,
+//            under anything else (a grid) the each instances the whole array.
+void get_virtual_window(DOM* dom, Element* each, float fixed_row_height, int count, int* first_index, int* window_count)
+{
+    Element* viewport = each->parent;
     
-    merge_element_type_style(element->type, element->flags & is_hovered(), ((ElementMaster*)element->master)->file_id, &element->working_style);
+    bool is_vertical = viewport->type == ElementType::VDIV || viewport->type == ElementType::ROOT;
+    bool is_horizontal = viewport->type == ElementType::HDIV;
+    if((!is_vertical && !is_horizontal) || count <= 0)
+    {
+        *first_index = 0;
+        *window_count = MAX(count, 0);
+        SetEachSpace(dom, each, 0.0f, 0.0f);
+        return;
+    }
+    
+    float row_height = fixed_row_height;
+    if(!row_height)
+    {
+        // Estimate from the instances that were laid out last frame
+        float measured = 0.0f;
+        int measured_count = 0;
+        Element* curr = each->first_child;
+        while(curr)
+        {
+            if(curr->last_sizing && (curr->flags & is_hidden()) == 0)
+            {
+                measured += outer_size(curr->last_sizing, is_vertical);
+                measured_count++;
+            }
+            curr = curr->next_sibling;
+        }
+        
+        if(measured_count && each->Each.last_count && measured > 0.0f)
+        {
+            each->Each.row_height = measured / (float)each->Each.last_count;
+        }
+        row_height = each->Each.row_height ? each->Each.row_height : VIRTUAL_EACH_DEFAULT_ROW_HEIGHT;
+    }
+    
+    int first = 0;
+    int last = MIN(count, VIRTUAL_EACH_OVERSCAN*2);
+    
+    if(viewport->last_sizing)
+    {
+        LayoutElement* viewport_sizing = viewport->last_sizing;
+        size_axis* viewport_axis = is_vertical ? &viewport_sizing->sizing.height : &viewport_sizing->sizing.width;
+        
+        // Content of the viewport that comes before the each
+        float leading_content = pixel_size(viewport_axis->padding1);
+        Element* curr = viewport->first_child;
+        while(curr && curr != each)
+        {
+            if(curr->last_sizing && (curr->flags & is_hidden()) == 0)
+            {
+                leading_content += outer_size(curr->last_sizing, is_vertical);
+            }
+            curr = curr->next_sibling;
+        }
+        
+        // The visible region of the viewport in the coordinates of the each's first instance
+        float visible_start;
+        float visible_end;
+        if(is_vertical)
+        {
+            visible_start = (viewport_sizing->bounds.y - viewport_sizing->position.y) + viewport->scroll.y - leading_content;
+            visible_end = visible_start + viewport_sizing->bounds.height;
+        }
+        else
+        {
+            visible_start = (viewport_sizing->bounds.x - viewport_sizing->position.x) + viewport->scroll.x - leading_content;
+            visible_end = visible_start + viewport_sizing->bounds.width;
+        }
+        
+        // Note(Leo): Truncating instead of rounding outwards is fine since the overscan covers it
+        first = (int)(visible_start / row_height) - VIRTUAL_EACH_OVERSCAN;
+        last = (int)(visible_end / row_height) + 1 + VIRTUAL_EACH_OVERSCAN;
+        
+        first = MAX(0, MIN(first, count));
+        last = MAX(first, MIN(last, count));
+    }
+    
+    *first_index = first;
+    *window_count = last - first;
+    SetEachSpace(dom, each, (float)first * row_height, (float)(count - last) * row_height);
+}
 
-    if(element->do_override_style)
+// Flags the unbound text children of an element so they pick up its new font/text color when they are visited
+void mark_text_children_dirty(Element* element)
+{
+    Element* curr_child = element->first_child;
+    while(curr_child)
     {
-        MergeStyles(&element->working_style, &element->override_style);
+        if(curr_child->type == ElementType::TEXT && (curr_child->flags & is_bound()) == 0)
+        {
+            curr_child->flags |= structure_dirty();
+            element->flags |= subtree_dirty();
+        }
+        curr_child = curr_child->next_sibling;
     }
+}
+
+// Attribute types that runtime_evaluate_attributes does something with
+#define evaluated_attributes() (attribute_bit(AttributeType::TEXT) | attribute_bit(AttributeType::SRC) | attribute_bit(AttributeType::LOOP) |     \
+    attribute_bit(AttributeType::ON_CLICK) | attribute_bit(AttributeType::THIS_ELEMENT) | attribute_bit(AttributeType::CONDITION) |          \
+    attribute_bit(AttributeType::ON_FOCUS) | attribute_bit(AttributeType::FOCUSABLE) | attribute_bit(AttributeType::TICKING) |               \
+    attribute_bit(AttributeType::CLASS) | attribute_bit(AttributeType::BAKED_CLASS))
 
-    Attribute* curr_attribute = element->first_attribute;
+// Note(Leo): Called for every element that gets visited by the tick, elements that are clean early out.
+//            Hover/click state is resolved before the walk by update_hover_chain.
+void runtime_evaluate_attributes(DOM* dom, Element* element)
+{
+    BEGIN_TIMED_BLOCK(EVALUATE_ATTRIBUTES);
+    
+    // Note(Leo): Dirty flags are cleared before evaluating so that anything flagged by bindings while we evaluate
+    //            is picked up next frame.
+    uint64_t dirty = element->flags & dirty_flags();
+    element->flags &= ~dirty_flags();
     
-    while(curr_attribute)
+    // Nothing that the working style or attributes depend on has changed since last time we evaluated
+    if(!dirty && (element->flags & is_bound()) == 0)
     {
-        assert(curr_attribute != curr_attribute->next_attribute);
+        END_TIMED_BLOCK(EVALUATE_ATTRIBUTES);
+        return;
+    }
+    
+    // Note(Leo): Text children inherit these so they have to be re-evaluated if they change
+    uint16_t previous_font_id = element->working_style.font_id;
+    uint16_t previous_font_size = element->working_style.font_size;
+    StyleColor previous_text_color = element->working_style.text_color;
+    
+    DefaultStyle(&element->working_style);
+    
+    merge_element_type_style(element->type, get_selector_state(element), ((ElementMaster*)element->master)->file_id, &element->working_style);
+
+    if(element->override_style)
+    {
+        MergeStyles(&element->working_style, element->override_style);
+    }
+
+    // Note(Leo): Elements that only have attributes the evaluator ignores (ID, COMP_ID, ROW...) skip the loop entirely
+    int evaluated_count = (element->attribute_mask & evaluated_attributes()) ? element->num_attributes : 0;
+    
+    for(int i = 0; i < evaluated_count; i++)
+    {
+        Attribute* curr_attribute = element->first_attribute + i;
         switch(curr_attribute->type)
         {
             case(AttributeType::TEXT):
@@ -597,9 +992,16 @@ void runtime_evaluate_attributes(DOM* dom, PlatformControlState* controls, Eleme
                 
                 if(!curr_attribute->Text.binding_id) // Text is known
                 {
-                    element->Text.temporal_text = (char*)Alloc(dom->frame_arena, sizeof(char)*curr_attribute->Text.value_length);
-                    memcpy(element->Text.temporal_text, curr_attribute->Text.static_value, sizeof(char)*curr_attribute->Text.value_length);
+                    // Note(Leo): The static value lives as long as the loaded file so it can be used directly
+                    if(!curr_attribute->Text.text_key && curr_attribute->Text.value_length)
+                    {
+                        curr_attribute->Text.text_key = FontPlatformHashText(curr_attribute->Text.static_value, curr_attribute->Text.value_length);
+                    }
+                    
+                    element->flags |= static_text();
+                    element->Text.temporal_text = curr_attribute->Text.static_value;
                     element->Text.temporal_text_length = curr_attribute->Text.value_length;
+                    element->Text.text_key = curr_attribute->Text.text_key;
                     break;
                 }
                 // Text has to come from a binding
@@ -617,12 +1019,8 @@ void runtime_evaluate_attributes(DOM* dom, PlatformControlState* controls, Eleme
                     binding_text = binding->arr_stub_string((void*)element->context_master, (void*)element->master, runtime.strings, element->context_index);
                 }
                 
-                element->Text.temporal_text_length = binding_text->length;
-                
-                // Note(Leo): A \0 is automatically added by flatten so account for it
-                element->Text.temporal_text = (char*)Alloc(dom->frame_arena, sizeof(char)*(binding_text->length + 1));
-                Flatten(binding_text, element->Text.temporal_text, binding_text->length + 1);
-            
+                element->flags &= ~static_text();
+                set_bound_text(dom, element, binding_text);
                 FreeString(binding_text);
                 
                 break;
@@ -669,56 +1067,38 @@ void runtime_evaluate_attributes(DOM* dom, PlatformControlState* controls, Eleme
                     count = binding->arr_stub_int((void*)element->context_master, (void*)element->master, element->context_index);
                 }
                 
-                if(element->Each.last_count == count)
+                int first_index = 0;
+                int window_count = count;
+                
+                Attribute* virtual_attribute = GetAttribute(element, AttributeType::VIRTUAL);
+                if(virtual_attribute)
+                {
+                    get_virtual_window(dom, element, virtual_attribute->Virtual.row_height, count, &first_index, &window_count);
+                }
+                
+                if(element->Each.total_count == count && element->Each.first_index == first_index && element->Each.last_count == window_count)
                 {
                     break;
                 }
+                element->Each.total_count = count;
                 
-                element->Each.last_count = count;
                 binding = GetBoundExpression(curr_attribute->Loop.array_binding);
                 assert(binding->type == BoundExpressionType::PTR_RET);
                 
-                element->Each.array_ptr = NULL;
+                void* array_ptr = NULL;
                 
                 if(binding->context == BindingContext::GLOBAL) 
                 {
-                    element->Each.array_ptr = binding->stub_get_ptr((void*)element->master);
+                    array_ptr = binding->stub_get_ptr((void*)element->master);
                 }
                 else
                 {
-                    element->Each.array_ptr = binding->arr_stub_get_ptr((void*)element->context_master, element->context_index);
+                    array_ptr = binding->arr_stub_get_ptr((void*)element->context_master, element->context_index);
                 }
                 
-                // Remove old array elements
-                if(element->first_child)
-                {
-                    Element* prev_freed = element->first_child;
-                    Element* next_freed = element->first_child->next_sibling;
-                    
-                    while(prev_freed)
-                    {
-                        FreeSubtreeObjects(prev_freed, dom);
-                        prev_freed = next_freed;
-                        if(next_freed)
-                        {
-                            next_freed = next_freed->next_sibling;
-                        }
-                    }
-                    
-                    element->first_child = NULL;
-                }
-                
-                if(!element->Each.array_ptr || count == 0)
-                {
-                    break;
-                }
-                
-                // Note(Leo): adding template elements backwards since they are appended as the first child of 
-                //            the EACH, meaning the last one to get added is the first child
-                for(int i = (count - 1); i >= 0; i--)
-                {
-                    InstanceTemplate(dom, element, element->Each.array_ptr, curr_attribute->Loop.template_id, i);
-                }
+                // Note(Leo): Only the instances whose key was added/removed get created/freed, the rest are kept 
+                //            (with their components' state) and moved to their new index.
+                ReconcileEach(dom, element, curr_attribute, array_ptr, first_index, window_count);
                 
                 break;
             }
@@ -816,6 +1196,9 @@ void runtime_evaluate_attributes(DOM* dom, PlatformControlState* controls, Eleme
                 tick_event->type = EventType::TICK;
                 tick_event->Tick.target = element;
                 
+                // Ticking elements keep the platform from going idle
+                dom->frame_requested = true;
+                
                 break;
             }
             case(AttributeType::CLASS):
@@ -824,14 +1207,31 @@ void runtime_evaluate_attributes(DOM* dom, PlatformControlState* controls, Eleme
                 
                 break;
             }
+            case(AttributeType::BAKED_CLASS):
+            {
+                merge_baked_class_style(curr_attribute, get_selector_state(element), &element->working_style);
+                
+                break;
+            }
             default:
             {
                 break;
             }
         
         }
-        
-        curr_attribute = curr_attribute->next_attribute; 
+    }
+    
+    if(previous_font_id != element->working_style.font_id || previous_font_size != element->working_style.font_size ||
+        memcmp(&previous_text_color, &element->working_style.text_color, sizeof(StyleColor)))
+    {
+        mark_text_children_dirty(element);
+    }
+    
+    uint64_t layout_fingerprint = get_layout_fingerprint(element);
+    if(layout_fingerprint != element->layout_fingerprint)
+    {
+        element->layout_fingerprint = layout_fingerprint;
+        MarkLayoutDirty(element);
     }
     
     END_TIMED_BLOCK(EVALUATE_ATTRIBUTES);
@@ -844,7 +1244,9 @@ void PlatformEvaluateAttributes(DOM* dom, Element* target)
         return;
     }
     
-    runtime_evaluate_attributes(dom, dom->controls, target);
+    // Note(Leo): The caller wants the element's state right now so force a full evaluation even if it is clean
+    target->flags |= structure_dirty();
+    runtime_evaluate_attributes(dom, target);
 }
 
 void RuntimeClearTemporal(DOM* target)
@@ -1031,10 +1433,179 @@ void FocusElement(DOM* dom, Element* old_focused, Element* new_focused)
     dom->focused_element = new_focused;
 }
 
+// Adds an element to the chain being built for this frame unless a previous cursor already hit it
+void add_to_hover_query(Element* element, uint32_t* chain, uint32_t* chain_count)
+{
+    if(element->flags & in_hover_query())
+    {
+        return;
+    }
+    
+    element->flags |= in_hover_query();
+    chain[*chain_count] = (uint32_t)element->id;
+    (*chain_count)++;
+}
+
+void update_element_click(Element* element, PlatformControlState* controls)
+{
+    ClickState previous_click_state = element->click_state;
+    update_click_state(element, controls);
+    
+    if(previous_click_state != element->click_state || (element->flags & is_clicked()))
+    {
+        MarkDirty(element, click_dirty());
+    }
+}
+
+// Note(Leo): Queries last frame's hit grid for the elements under each cursor and diffs them against the chain from
+//            last frame. Only elements that enter or leave the chain change hover state and only elements in either
+//            chain can change click state (clicks need hover) so nothing else has to be looked at.
+void update_hover_chain(DOM* dom, PlatformControlState* controls, Element* root_element)
+{
+    uint32_t* old_chain = (uint32_t*)dom->hover_chain->mapped_address;
+    uint32_t old_count = (dom->hover_chain->next_address - dom->hover_chain->mapped_address)/sizeof(uint32_t);
+    
+    uint32_t entry_count = dom->hit_grid ? dom->hit_grid->entry_count : 0;
+    
+    // Note(Leo): Each entry can also pull in the custom element it stands in for, hence 2x
+    void* chain_memory = AllocScratch((2*entry_count + 1)*sizeof(uint32_t), no_zero());
+    uint32_t* chain = align_mem(chain_memory, uint32_t);
+    uint32_t chain_count = 0;
+    
+    void* hits_memory = AllocScratch((entry_count + 1)*sizeof(uint32_t), no_zero());
+    uint32_t* hits = align_mem(hits_memory, uint32_t);
+    
+    // Note(Leo): Mice only ever have the 1 cursor
+    int cursor_count = controls->cursor_source == CursorSource::TOUCH ? MIN((int)controls->cursor_count, 5) : 1;
+    for(int i = 0; i < cursor_count; i++)
+    {
+        vec2 cursor = controls->cursor_positions[i];
+        if(cursor.x == 0.0f || cursor.y == 0.0f)
+        {
+            continue;
+        }
+        
+        uint32_t hit_count = HitTestGridQuery(dom->hit_grid, cursor, hits);
+        for(uint32_t j = 0; j < hit_count; j++)
+        {
+            Element* hit = root_element + hits[j];
+            add_to_hover_query(hit, chain, &chain_count);
+            
+            // Note(Leo): Layout flattens custom elements into their component root so the root is what gets hit
+            if(hit->type == ElementType::ROOT && hit->parent && hit->parent->type == ElementType::CUSTOM)
+            {
+                add_to_hover_query(hit->parent, chain, &chain_count);
+            }
+        }
+    }
+    
+    // Left the chain
+    for(uint32_t i = 0; i < old_count; i++)
+    {
+        Element* element = root_element + old_chain[i];
+        
+        // Note(Leo): Elements that were freed since last frame have had their flags cleared
+        if((element->flags & is_hovered()) == 0 || element->flags & in_hover_query())
+        {
+            continue;
+        }
+        
+        element->flags &= ~is_hovered();
+        MarkDirty(element, hover_dirty());
+        update_element_click(element, controls);
+    }
+    
+    // Entered or stayed in the chain
+    for(uint32_t i = 0; i < chain_count; i++)
+    {
+        Element* element = root_element + chain[i];
+        element->flags &= ~in_hover_query();
+        
+        if((element->flags & is_hovered()) == 0)
+        {
+            element->flags |= is_hovered();
+            MarkDirty(element, hover_dirty());
+        }
+        update_element_click(element, controls);
+    }
+    
+    ResetArena(dom->hover_chain);
+    if(chain_count)
+    {
+        memcpy(Alloc(dom->hover_chain, chain_count*sizeof(uint32_t), no_zero()), chain, chain_count*sizeof(uint32_t));
+    }
+    
+    DeAllocScratch(hits_memory);
+    DeAllocScratch(chain_memory);
+}
+
+// Evaluates an element for the tick and returns whether its children have to be visited this frame.
+bool visit_element(DOM* dom, PlatformControlState* controls, Element* element, Element** scroll_capturer)
+{
+    bool visit_children = element->flags & subtree_dirty();
+    
+    // Note(Leo): Cleared here and re-accumulated by leave_element once the subtree is done
+    element->flags &= ~subtree_dirty();
+    
+    runtime_evaluate_attributes(dom, element);
+    
+    sanitize_scrollable(element);
+    if(should_capture_scroll(controls, element))
+    {
+        *scroll_capturer = element;
+    }
+    
+    // Evaluating may have instanced new children (EACH)
+    if(element->flags & subtree_dirty())
+    {
+        visit_children = true;
+    }
+    
+    return visit_children && element->first_child;
+}
+
+// Called once the tick is done with an element's subtree, flags the parent if anything in this subtree needs to be 
+// visited next frame.
+void leave_element(Element* element)
+{
+    if(!element->parent)
+    {
+        return;
+    }
+    
+    bool is_scrollable = element->working_style.vertical_clipping == ClipStyle::SCROLL || element->working_style.horizontal_clipping == ClipStyle::SCROLL;
+    
+    // Note(Leo): Scrollables need sanitize_scrollable called every frame since their content can change size without them changing
+    if(element->flags & (is_bound() | subtree_dirty() | dirty_flags()) || is_scrollable)
+    {
+        element->parent->flags |= subtree_dirty();
+    }
+}
+
+void RequestFrame(DOM* dom)
+{
+    dom->frame_requested = true;
+    PlatformWakeMainLoop();
+}
+
+bool RuntimeWantsFrame(DOM* dom)
+{
+    return dom->frame_requested || dom->switch_request.file_id;
+}
+
 Arena* RuntimeTickAndBuildRenderque(Arena* renderque, DOM* dom, PlatformControlState* controls, int window_width, int window_height)
 {
     dom->controls = controls;
     
+    // Note(Leo): Cleared before the tick so that ticking elements and anything the frame does can ask again
+    dom->frame_requested = false;
+    
+    // Note(Leo): Nothing from the last frame is holding onto elements yet so its safe to move them
+    if(ShouldCompactElements(dom))
+    {
+        CompactElements(dom);
+    }
+    
     // Note(Leo): Page root element is always at the first address of the dom
     Element* old_focused = dom->focused_element;
     
@@ -1048,18 +1619,16 @@ Arena* RuntimeTickAndBuildRenderque(Arena* renderque, DOM* dom, PlatformControlS
         SwitchPage(dom, dom->switch_request.file_id, dom->switch_request.flags);
         dom->switch_request = {};
     }
+    
+    update_hover_chain(dom, controls, root_element);
       
     Element* scroll_capturer = NULL; // The current deepest element asking to capture scroll
     
     Element* curr_element = root_element;
     
     PREFETCH_INTRINSIC(curr_element);
-    runtime_evaluate_attributes(dom, controls, curr_element);
-    sanitize_scrollable(curr_element);
-    if(should_capture_scroll(controls, curr_element)) // Root is allowed to capture scroll
-    {
-        scroll_capturer = curr_element;
-    }
+    // Note(Leo): Root is allowed to capture scroll
+    bool visit_children = visit_element(dom, controls, curr_element, &scroll_capturer);
     
     // Depth first walk
     while(curr_element)
@@ -1069,31 +1638,20 @@ Arena* RuntimeTickAndBuildRenderque(Arena* renderque, DOM* dom, PlatformControlS
         PREFETCH_INTRINSIC(curr_element->next_sibling);
         PREFETCH_INTRINSIC(curr_element->parent);
     
-        if(curr_element->first_child && curr_element->flags ^ is_hidden())
+        if(visit_children && curr_element->flags ^ is_hidden())
         {
             curr_element = curr_element->first_child;
-            
-            runtime_evaluate_attributes(dom, controls, curr_element);
-            
-            sanitize_scrollable(curr_element);
-            if(should_capture_scroll(controls, curr_element))
-            {
-                scroll_capturer = curr_element;
-            }
+            visit_children = visit_element(dom, controls, curr_element, &scroll_capturer);
             
             continue;
         }
+        
+        leave_element(curr_element);
+        
         if(curr_element->next_sibling)
         {
             curr_element = curr_element->next_sibling;
-            
-            runtime_evaluate_attributes(dom, controls, curr_element);
-            
-            sanitize_scrollable(curr_element);
-            if(should_capture_scroll(controls, curr_element))
-            {
-                scroll_capturer = curr_element;
-            }
+            visit_children = visit_element(dom, controls, curr_element, &scroll_capturer);
             
             continue;
         }
@@ -1104,17 +1662,12 @@ Arena* RuntimeTickAndBuildRenderque(Arena* renderque, DOM* dom, PlatformControlS
         {
             PREFETCH_INTRINSIC(curr_element->parent);
             
+            leave_element(curr_element);
+            
             if(curr_element->next_sibling)
             {
                 curr_element = curr_element->next_sibling;
-                
-                runtime_evaluate_attributes(dom, controls, curr_element);
-                
-                sanitize_scrollable(curr_element);
-                if(should_capture_scroll(controls, curr_element))
-                {
-                    scroll_capturer = curr_element;
-                }
+                visit_children = visit_element(dom, controls, curr_element, &scroll_capturer);
                 
                 break;
             }
@@ -1143,15 +1696,18 @@ Arena* RuntimeTickAndBuildRenderque(Arena* renderque, DOM* dom, PlatformControlS
         FocusElement(dom, old_focused, dom->focused_element);
     }
 
+    // Note(Leo): Publish the tick/focus events from this frame so OnFrame sees them
+    CommitEvents(dom);
     call_page_frame(dom, ((ElementMaster*)root_element->master)->file_id, root_element->master);    
     
-    // Note(Leo): This is an approximation of the element count since there could be empty space inside the arena but we
-    //            will never underestimate so its ok.
-    int element_count = (dom->elements->next_address - dom->elements->mapped_address)/sizeof(Element);
+    // Note(Leo): Every layout element comes from a live element or is a virtual each's spacer so this is the most
+    //            the layout can need.
+    int element_count = (int)(dom->live_element_count + dom->layout_spacer_count);
+    TRACK_HIGH_WATER(DOM_ELEMENTS, element_count);
 
     BEGIN_TIMED_BLOCK(PLATFORM_SHAPE);
 
-    Arena* result = ShapingPlatformShape(root_element, renderque, element_count, window_width, window_height);
+    Arena* result = ShapingPlatformShape(root_element, renderque, element_count, window_width, window_height, &dom->hit_grid);
     END_TIMED_BLOCK(PLATFORM_SHAPE);
     
     return result;
@@ -1298,23 +1854,69 @@ FontPlatformShapedGlyph* PlatformGetGlyphAt(Element* text, vec2 pos)
     // Todo(Leo): Make this work with text that ISNT just the first text element of a parent
     assert(text->last_sizing->type == LayoutElementType::TEXT_COMBINED);
     
-    FontPlatformShapedGlyph* curr = text->last_sizing->TEXT_COMBINED.first_glyph;
-    uint32_t count = text->last_sizing->TEXT_COMBINED.glyph_count;
+    FontPlatformShapedGlyph* glyphs = text->last_sizing->TEXT_COMBINED.first_glyph;
+    FontPlatformShapedLine* lines = text->last_sizing->TEXT_COMBINED.first_line;
+    uint32_t line_count = text->last_sizing->TEXT_COMBINED.line_count;
     
     float base_x = text->last_sizing->position.x;
     float base_y = text->last_sizing->position.y;
+    float x = pos.x - base_x;
+    float y = pos.y - base_y;
     
-    for(uint32_t i = 0; i < count; i++)
+    // Note(Leo): Line extents only grow down the text so this finds the first line that could hold the point, 
+    //            glyphs that reach into the next lines mean a couple more might need to be checked after it.
+    uint32_t low = 0;
+    uint32_t high = line_count;
+    while(low < high)
     {
-        bounding_box curr_bounds = { base_x + curr->placement_offsets.x, base_y + curr->placement_offsets.y,
-                                     curr->placement_size.x, curr->placement_size.y };
+        uint32_t middle = (low + high) / 2;
+        if(lines[middle].bottom < y)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    
+    for(uint32_t i = low; i < line_count && lines[i].top <= y; i++)
+    {
+        FontPlatformShapedGlyph* line_glyphs = glyphs + lines[i].first_glyph;
         
-        if(PointInsideBounds(curr_bounds, pos))
+        // Last glyph on the line that starts before the point
+        uint32_t left = 0;
+        uint32_t right = lines[i].glyph_count;
+        while(left < right)
         {
-            return curr;
+            uint32_t middle = (left + right) / 2;
+            if(line_glyphs[middle].placement_offsets.x <= x)
+            {
+                left = middle + 1;
+            }
+            else
+            {
+                right = middle;
+            }
         }
         
-        curr++;
+        // Walk back over any glyphs that still reach the point
+        for(uint32_t j = left; j > 0; j--)
+        {
+            FontPlatformShapedGlyph* curr = line_glyphs + j - 1;
+            if(curr->placement_offsets.x + curr->placement_size.x < x)
+            {
+                break;
+            }
+            
+            bounding_box curr_bounds = { base_x + curr->placement_offsets.x, base_y + curr->placement_offsets.y,
+                                         curr->placement_size.x, curr->placement_size.y };
+            
+            if(PointInsideBounds(curr_bounds, pos))
+            {
+                return curr;
+            }
+        }
     }
     
     return NULL;
@@ -1340,48 +1942,38 @@ FontPlatformShapedGlyph* PlatformGetGlyphForBufferIndex(Element* text, uint32_t
     assert(text->last_sizing->type == LayoutElementType::TEXT_COMBINED);
     
     FontPlatformShapedGlyph* glyphs = text->last_sizing->TEXT_COMBINED.first_glyph;
-    uint32_t count = text->last_sizing->TEXT_COMBINED.glyph_count;
+    uint32_t* order = text->last_sizing->TEXT_COMBINED.buffer_order;
+    uint32_t count = text->last_sizing->TEXT_COMBINED.buffer_glyph_count;
     
-    // Note(Leo): Simple binary search
+    // Note(Leo): Binary search for the last glyph that starts at or before the index, glyphs are looked at through the
+    //            order table if they arent in buffer order already.
     uint32_t left = 0;
-    uint32_t right = count - 1;
-    
-    // Check starting limits
-    if(index >= glyphs->buffer_index && index < (glyphs->buffer_index + glyphs->run_length))
-    {
-        return glyphs;
-    }
-    
-    if(index >= (glyphs + right)->buffer_index && index < ((glyphs + right)->buffer_index + (glyphs + right)->run_length))
-    {
-        return glyphs + right;
-    }
-    
-    // Check that out search is not out of bounds
-    if(index >= ((glyphs + right)->buffer_index + (glyphs + right)->run_length))
-    {
-        return NULL;
-    }
-    
-    while(left != right)
+    uint32_t right = count;
+    while(left < right)
     {
         uint32_t split = left;
         split += (right - left) >> 1; // Note(Leo): This shift replaces a div by 2
-        FontPlatformShapedGlyph* curr = glyphs + split;
+        FontPlatformShapedGlyph* curr = glyphs + (order ? order[split] : split);
         
-        // Need to go right
-        if(index >= (curr->buffer_index + curr->run_length))
+        if(curr->buffer_index <= index)
         {
-            left = split;
+            left = split + 1;
         }
-        else if(index < curr->buffer_index) // Need to go left
+        else
         {
             right = split;
         }
-        else // Found it
-        {
-            return curr;
-        }
+    }
+    
+    if(!left)
+    {
+        return NULL;
+    }
+    
+    FontPlatformShapedGlyph* found = glyphs + (order ? order[left - 1] : left - 1);
+    if(index < found->buffer_index + found->run_length)
+    {
+        return found;
     }
     
     return NULL;
@@ -1477,13 +2069,16 @@ void PlatformUpdateStyle(Element* target)
         return;
     }
 
+    // Note(Leo): The style changes outside of a tick so the next layout cant reuse anything from this subtree
+    MarkLayoutDirty(target);
+    
     // Note(Leo): Most of this is copy pasta from runtime_evaluate_attributes
     DefaultStyle(&target->working_style);
-    merge_element_type_style(target->type, target->flags & is_hovered(), ((ElementMaster*)target->master)->file_id, &target->working_style);
+    merge_element_type_style(target->type, get_selector_state(target), ((ElementMaster*)target->master)->file_id, &target->working_style);
     
-    if(target->do_override_style)
+    if(target->override_style)
     {
-        MergeStyles(&target->working_style, &target->override_style);
+        MergeStyles(&target->working_style, target->override_style);
     }
     
     if(target->type == ElementType::TEXT)
@@ -1501,4 +2096,11 @@ void PlatformUpdateStyle(Element* target)
     {
         merge_element_class_style(target, class_attribute);
     }
+    
+    class_attribute = GetAttribute(target, AttributeType::BAKED_CLASS);
+    
+    if(class_attribute)
+    {
+        merge_baked_class_style(class_attribute, get_selector_state(target), &target->working_style);
+    }
 }
\ No newline at end of file
@@ -1,6 +1,18 @@
+// Note(Leo): The standard threading headers have to come before the arena macros
+#include <mutex>
+#include <atomic>
 #include "platform.h"
+#include "job_pool.h"
 #include "simd.h"
 
+// Note(Leo): Large doms split the subtrees under wide containers off and lay them out on the job pool.
+#define LAYOUT_SPLIT_MIN_ELEMENTS 2048 // Doms with less elements than this are always laid out on the main thread
+#define LAYOUT_SPLIT_MIN_CHILDREN 4 // Containers with at least this many children get their children split off
+
+// Note(Leo): Parents with at least this many children size them in the final pass with the simd kernels
+#define LAYOUT_SIMD_MIN_CHILDREN 16
+#define SOA_LANES 4 // Kernels run on 128 bit registers which every simd level we support has
+
 struct shaping_context 
 {
     uint32_t element_count;
@@ -14,8 +26,85 @@ struct shaping_context
     Arena* shape_arena;
     Arena* layout_element_arena;
     Arena* final_renderque;
+    
+    Element* root_element;
+    
+    uint32_t generation;
+    uint32_t previous_generation; // Generation of the last layout of this dom, 0 if it cant be reused
+    
+    // Note(Leo): Set while layout jobs are running, every job allocates out of the same shape arena so allocating has
+    //            to hold it. The font platform has its own lock.
+    std::mutex* shape_arena_lock;
 };
 
+void lock_shape_arena(shaping_context* context)
+{
+    if(context->shape_arena_lock)
+    {
+        context->shape_arena_lock->lock();
+    }
+}
+
+void unlock_shape_arena(shaping_context* context)
+{
+    if(context->shape_arena_lock)
+    {
+        context->shape_arena_lock->unlock();
+    }
+}
+
+// Note(Leo): Layout jobs shape into their own thread's arena so the shape arena is only locked to copy the result in.
+thread_local Arena staged_text = Arena();
+
+Arena* get_staged_text_arena()
+{
+    if(!staged_text.mapped_address)
+    {
+        staged_text = CreateArena(Megabytes(64), sizeof(char));
+    }
+    
+    ResetArena(&staged_text);
+    return &staged_text;
+}
+
+// Copies the glyphs, lines and buffer order of a combined text into the shape arena, they only have to be readable
+// where they are now
+void move_combined_text(shaping_context* context, LayoutElement* text)
+{
+    uint32_t glyph_count = text->TEXT_COMBINED.glyph_count;
+    uint32_t line_count = text->TEXT_COMBINED.line_count;
+    uint32_t order_count = text->TEXT_COMBINED.buffer_order ? text->TEXT_COMBINED.buffer_glyph_count : 0;
+    
+    // Note(Leo): +1 on every block to leave alignment room
+    lock_shape_arena(context);
+    void* glyph_memory = glyph_count ? Alloc(context->shape_arena, (glyph_count + 1)*sizeof(FontPlatformShapedGlyph), no_zero()) : NULL;
+    void* line_memory = line_count ? Alloc(context->shape_arena, (line_count + 1)*sizeof(FontPlatformShapedLine), no_zero()) : NULL;
+    void* order_memory = order_count ? Alloc(context->shape_arena, (order_count + 1)*sizeof(uint32_t), no_zero()) : NULL;
+    unlock_shape_arena(context);
+    
+    if(glyph_count)
+    {
+        FontPlatformShapedGlyph* glyphs = align_mem(glyph_memory, FontPlatformShapedGlyph);
+        memcpy(glyphs, text->TEXT_COMBINED.first_glyph, glyph_count*sizeof(FontPlatformShapedGlyph));
+        text->TEXT_COMBINED.first_glyph = glyphs;
+    }
+    if(line_count)
+    {
+        FontPlatformShapedLine* lines = align_mem(line_memory, FontPlatformShapedLine);
+        memcpy(lines, text->TEXT_COMBINED.first_line, line_count*sizeof(FontPlatformShapedLine));
+        text->TEXT_COMBINED.first_line = lines;
+    }
+    if(order_count)
+    {
+        uint32_t* order = align_mem(order_memory, uint32_t);
+        memcpy(order, text->TEXT_COMBINED.buffer_order, order_count*sizeof(uint32_t));
+        text->TEXT_COMBINED.buffer_order = order;
+    }
+}
+
+// Note(Leo): Generations are unique across every layout so a stale last_sizing can never pass for part of the last one
+static uint32_t layout_generation = 0;
+
 // Returns true if two bounding boxes intersect and optionally returns the intersection region
 bool boxes_intersect(bounding_box* first, bounding_box* second, bounding_box* region = NULL)
 {
@@ -99,6 +188,65 @@ void convert_element_style(InFlightStyle* in, LayoutElement* target)
     }
 }
 
+// Pushes a spacer standing in for the instances a virtual each left out, it only takes up space along its parent's
+// direction so it is zero sized across and never gets drawn or hit.
+void push_each_spacer(shaping_context* context, Element* each, float space)
+{
+    LayoutElement* spacer = (LayoutElement*)Push(context->layout_element_arena, sizeof(LayoutElement));
+    spacer->element_id = each->id;
+    spacer->generation = context->generation;
+    spacer->type = LayoutElementType::SPACER;
+    spacer->dir = LayoutDirection::NONE;
+    spacer->display = DisplayType::NORMAL;
+    
+    size_axis* axes[2] = {&spacer->sizing.width, &spacer->sizing.height};
+    for(int i = 0; i < 2; i++)
+    {
+        for(int j = 0; j < 7; j++)
+        {
+            axes[i]->measures[j] = {0.0f, MeasurementType::PIXELS};
+        }
+    }
+    
+    // Note(Leo): The runtime only gives an each space under a vdiv, hdiv or root so anything that isnt an hdiv is vertical
+    size_axis* along = each->parent->type == ElementType::HDIV ? &spacer->sizing.width : &spacer->sizing.height;
+    along->desired.size = space;
+    along->min.size = space;
+    along->max.size = space;
+    along->current = space;
+}
+
+// Returns true if the children of the element can be copied from the last layout instead of being unpacked again
+bool is_layout_boundary(shaping_context* context, Element* element, LayoutElement* converted, LayoutElement* previous)
+{
+    if(!context->previous_generation || !previous || (element->flags & layout_dirty()))
+    {
+        return false;
+    }
+    
+    // Note(Leo): last_sizing may be left over from an older layout or point at the text preview
+    if(previous->generation != context->previous_generation || previous->element_id != (uint32_t)element->id || 
+       previous->type != LayoutElementType::NORMAL)
+    {
+        return false;
+    }
+    
+    // Note(Leo): Only fixed size elements are boundaries since anything else depends on its parent or its children 
+    //            and would have to be sized again anyways.
+    size_axis* axes[2] = {&converted->sizing.width, &converted->sizing.height};
+    for(int i = 0; i < 2; i++)
+    {
+        size_axis* axis = axes[i];
+        if(axis->desired.type != MeasurementType::PIXELS || axis->min.type != MeasurementType::PIXELS ||
+           axis->max.type != MeasurementType::PIXELS)
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 // 'unpacks' the children of a parent element into a contiguous array of LayoutElements and puts the pointer to the
 // first child into first_child and the count of children into child_count.
 void unpack(shaping_context* context, Element* first_child, LayoutElement** first_unpacked_child, uint16_t* child_count)
@@ -120,7 +268,9 @@ void unpack(shaping_context* context, Element* first_child, LayoutElement** firs
         count++;
         LayoutElement* converted = (LayoutElement*)Push(context->layout_element_arena, sizeof(LayoutElement));
         converted->element_id = curr->id;
+        converted->generation = context->generation;
         
+        LayoutElement* previous = curr->last_sizing;
         curr->last_sizing = converted;
         
         // Converting element type to layout element type
@@ -149,6 +299,16 @@ void unpack(shaping_context* context, Element* first_child, LayoutElement** firs
                 // Moving over the element's scroll
                 converted->NORMAL.clipping.left_scroll = curr->scroll.x;
                 converted->NORMAL.clipping.top_scroll = curr->scroll.y;
+                
+                if(is_layout_boundary(context, curr, converted, previous))
+                {
+                    // Note(Leo): The children are copied out of the last layout when the main loop gets to this element
+                    converted->cache = LayoutCache::BOUNDARY;
+                    converted->children = previous->children;
+                    converted->child_count = previous->child_count;
+                    converted->sizing.width.current = previous->sizing.width.current;
+                    converted->sizing.height.current = previous->sizing.height.current;
+                }
                 break;
             }
             case(ElementType::CUSTOM):
@@ -157,6 +317,7 @@ void unpack(shaping_context* context, Element* first_child, LayoutElement** firs
                 // and replacing it with its root
                 Element* comp_root = curr->first_child;
                 assert(comp_root->type == ElementType::ROOT);
+                comp_root->flags &= ~layout_dirty();
                 converted->element_id = comp_root->id;
                 converted->type = LayoutElementType::NORMAL;
                 converted->dir = LayoutDirection::VERTICAL;
@@ -169,6 +330,7 @@ void unpack(shaping_context* context, Element* first_child, LayoutElement** firs
                 converted->dir = LayoutDirection::NONE;
                 converted->TEXT.text_content = curr->Text.temporal_text;
                 converted->TEXT.text_length = curr->Text.temporal_text_length;
+                converted->TEXT.text_key = curr->Text.text_key;
                 convert_element_style(&curr->working_style, converted);
                 break;
             }
@@ -185,11 +347,27 @@ void unpack(shaping_context* context, Element* first_child, LayoutElement** firs
                 // Note(Leo): Each gets flat unpacked into its parent since it does not actually have sizing 
                 //            (it isnt a container)
                 Pop(context->layout_element_arena, sizeof(LayoutElement));
+                curr->last_sizing = NULL;
+                count--;
+                
+                // Note(Leo): A virtual each stands in for the instances outside of its window with a spacer on 
+                //            either side of them, the space is kept out of the instances' own margins.
+                if(curr->Each.leading_space)
+                {
+                    push_each_spacer(context, curr, curr->Each.leading_space);
+                    count++;
+                }
+                
                 uint16_t extra_children = 0;
                 LayoutElement* first_unpacked;
                 unpack(context, curr->first_child, &first_unpacked, &extra_children);
                 count += extra_children;
-                count--;
+                
+                if(curr->Each.trailing_space)
+                {
+                    push_each_spacer(context, curr, curr->Each.trailing_space);
+                    count++;
+                }
                 break;
             }
             default:
@@ -197,12 +375,68 @@ void unpack(shaping_context* context, Element* first_child, LayoutElement** firs
                 break;
         }
         
+        curr->flags &= ~layout_dirty();
         curr = curr->next_sibling;
     }
     
     *child_count = count; 
 }
 
+// Copies the children of a cached element out of the last layout along with their sizing and shaped text
+void copy_cached_children(shaping_context* context, LayoutElement* parent)
+{
+    LayoutElement* previous_children = parent->children;
+    parent->children = (LayoutElement*)context->layout_element_arena->next_address; 
+    
+    for(int i = 0; i < parent->child_count; i++)
+    {
+        LayoutElement* copied = (LayoutElement*)Push(context->layout_element_arena, sizeof(LayoutElement), no_zero());
+        memcpy(copied, previous_children + i, sizeof(LayoutElement));
+        copied->cache = LayoutCache::COPIED;
+        copied->generation = context->generation;
+        
+        // Note(Leo): Spacers point at their each which doesnt have a layout of its own
+        if(copied->type == LayoutElementType::SPACER)
+        {
+            continue;
+        }
+        
+        // Note(Leo): Component roots stand in for their custom element which is the one that points at the layout
+        Element* element = context->root_element + copied->element_id;
+        if(element->type == ElementType::ROOT && element->parent && element->parent->type == ElementType::CUSTOM)
+        {
+            element = element->parent;
+        }
+        element->last_sizing = copied;
+        
+        switch(copied->type)
+        {
+            case(LayoutElementType::NORMAL):
+            {
+                // Note(Leo): Scrolling doesnt change sizing so it doesnt dirty the layout, it still has to be picked up
+                Element* scrolled = context->root_element + copied->element_id;
+                copied->NORMAL.clipping.left_scroll = scrolled->scroll.x;
+                copied->NORMAL.clipping.top_scroll = scrolled->scroll.y;
+                break;
+            }
+            case(LayoutElementType::TEXT_COMBINED):
+            {
+                // Note(Leo): The glyphs live in the last shape arena so they have to move with the element
+                move_combined_text(context, copied);
+                context->glyph_count += copied->TEXT_COMBINED.glyph_count;
+                break;
+            }
+            case(LayoutElementType::IMAGE):
+            {
+                context->image_tile_count += copied->IMAGE.handle->tiled_width * copied->IMAGE.handle->tiled_height;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
 void sanitize_size_axis(size_axis* parent, size_axis* child)
 {
     // Checking all disalowed measuremnt combinations
@@ -338,6 +572,12 @@ void shape_first_pass(shaping_context* context, LayoutElement* parent)
             void* text_color_mem = AllocScratch((parent->child_count + 1)*sizeof(StyleColor));
             StyleColor* text_colors = align_mem(text_color_mem, StyleColor);
             
+            void* text_key_mem = AllocScratch((parent->child_count + 1)*sizeof(uint32_t));
+            uint32_t* text_keys = align_mem(text_key_mem, uint32_t);
+            
+            void* shaped_handle_mem = AllocScratch((parent->child_count + 1)*sizeof(uint32_t));
+            uint32_t* shaped_handles = align_mem(shaped_handle_mem, uint32_t);
+            
             // Aggregate text children
             int text_sibling_count = 0;
             LayoutElement* curr_text = curr_child;
@@ -348,6 +588,9 @@ void shape_first_pass(shaping_context* context, LayoutElement* parent)
                 text_fonts[text_sibling_count] = curr_text->TEXT.font_id;
                 font_sizes[text_sibling_count] = curr_text->TEXT.font_size;
                 text_colors[text_sibling_count] = curr_text->TEXT.text_color;
+                text_keys[text_sibling_count] = curr_text->TEXT.text_key;
+                // Note(Leo): The shaped handle is only meaningful for text that has a key from the runtime
+                shaped_handles[text_sibling_count] = curr_text->TEXT.text_key ? (context->root_element + curr_text->element_id)->Text.shaped_handle : 0;
                  
                 text_sibling_count++;
                 curr_text++;
@@ -394,16 +637,36 @@ void shape_first_pass(shaping_context* context, LayoutElement* parent)
             
             // Shape text
             FontPlatformShapedText result = {};
+            Arena* glyph_arena = context->shape_arena_lock ? get_staged_text_arena() : context->shape_arena;
             BEGIN_TIMED_BLOCK(TEXT_SHAPE);
-            FontPlatformShapeMixed(context->shape_arena, &result, text_views, text_fonts, font_sizes, text_colors, text_sibling_count, wrapping_point);
+            FontPlatformShapeMixed(glyph_arena, &result, text_views, text_fonts, font_sizes, text_colors, text_sibling_count, wrapping_point, text_keys, shaped_handles);
             END_TIMED_BLOCK(TEXT_SHAPE);
             
+            // Hand the handles back so next frame can skip the cache lookup if the text is unchanged
+            for(int i = 0; i < text_sibling_count; i++)
+            {
+                if(text_keys[i])
+                {
+                    (context->root_element + curr_child[i].element_id)->Text.shaped_handle = shaped_handles[i];
+                }
+            }
+            
             context->glyph_count += result.glyph_count;
             
             // Convert current TEXT element to a combined text
             curr_child->type = LayoutElementType::TEXT_COMBINED;
             curr_child->TEXT_COMBINED.first_glyph = result.first_glyph; 
             curr_child->TEXT_COMBINED.glyph_count = result.glyph_count; 
+            curr_child->TEXT_COMBINED.first_line = result.first_line; 
+            curr_child->TEXT_COMBINED.line_count = result.line_count; 
+            curr_child->TEXT_COMBINED.buffer_order = result.buffer_order; 
+            curr_child->TEXT_COMBINED.buffer_glyph_count = result.buffer_glyph_count; 
+            
+            if(glyph_arena != context->shape_arena)
+            {
+                move_combined_text(context, curr_child);
+            }
+            
             curr_child->sizing.width.current = (float)result.required_width;
             curr_child->sizing.height.current = (float)result.required_height;
 
@@ -414,6 +677,8 @@ void shape_first_pass(shaping_context* context, LayoutElement* parent)
             curr_child->sizing.height.desired.size = (float)result.required_height;
             curr_child->sizing.height.desired.type = MeasurementType::PIXELS;
             
+            DeAllocScratch(shaped_handle_mem);
+            DeAllocScratch(text_key_mem);
             DeAllocScratch(text_color_mem);
             DeAllocScratch(font_size_mem);
             DeAllocScratch(text_font_mem);
@@ -707,6 +972,261 @@ void grow_child(size_axis* child, float growth_space)
     }
 }
 
+#if ARCH_X64 || ARCH_NEON || ARCH_X64_SSE
+// Note(Leo): One axis of a run of siblings with every field of their size_axis in its own array. Lanes past the last 
+//            sibling are zeroed so they have the NONE type and dont do anything.
+struct sibling_axis_soa
+{
+    float* desired;
+    float* min;
+    float* max;
+    float* margin1;
+    float* margin2;
+    float* current;
+    
+    int32_t* desired_type;
+    int32_t* min_type;
+    int32_t* max_type;
+    int32_t* margin1_type;
+    int32_t* margin2_type;
+};
+
+#define SOA_AXIS_ARRAYS 11
+
+void soa_slice_axis(sibling_axis_soa* axis, uint32_t* memory, uint32_t lane_count)
+{
+    float** values[] = {&axis->desired, &axis->min, &axis->max, &axis->margin1, &axis->margin2, &axis->current};
+    int32_t** types[] = {&axis->desired_type, &axis->min_type, &axis->max_type, &axis->margin1_type, &axis->margin2_type};
+    
+    for(int i = 0; i < 6; i++)
+    {
+        *values[i] = (float*)(memory + (i*lane_count));
+    }
+    for(int i = 0; i < 5; i++)
+    {
+        *types[i] = (int32_t*)(memory + ((6 + i)*lane_count));
+    }
+}
+
+void soa_gather_axis(sibling_axis_soa* axis, uint32_t lane, size_axis* in)
+{
+    axis->desired[lane] = in->desired.size;
+    axis->desired_type[lane] = (int32_t)in->desired.type;
+    axis->min[lane] = in->min.size;
+    axis->min_type[lane] = (int32_t)in->min.type;
+    axis->max[lane] = in->max.size;
+    axis->max_type[lane] = (int32_t)in->max.type;
+    axis->margin1[lane] = in->margin1.size;
+    axis->margin1_type[lane] = (int32_t)in->margin1.type;
+    axis->margin2[lane] = in->margin2.size;
+    axis->margin2_type[lane] = (int32_t)in->margin2.type;
+    axis->current[lane] = in->current;
+}
+
+void soa_scatter_axis(sibling_axis_soa* axis, uint32_t lane, size_axis* out)
+{
+    out->desired = {axis->desired[lane], (MeasurementType)axis->desired_type[lane]};
+    out->min = {axis->min[lane], (MeasurementType)axis->min_type[lane]};
+    out->max = {axis->max[lane], (MeasurementType)axis->max_type[lane]};
+    out->margin1 = {axis->margin1[lane], (MeasurementType)axis->margin1_type[lane]};
+    out->margin2 = {axis->margin2[lane], (MeasurementType)axis->margin2_type[lane]};
+    out->current = axis->current[lane];
+}
+
+// Mask of the lanes whose measurement is of the given type
+f128 soa_type_mask(int32_t* types, MeasurementType type)
+{
+    return cast_i128_f128(cmp_i32_128(load_i128(types), set_i32_128((int32_t)type)));
+}
+
+// Turns the percent lanes of a measurement into pixels, returns the mask of the lanes that were turned
+f128 soa_resolve_percent(float* sizes, int32_t* types, f128 p_sizes)
+{
+    f128 percent = soa_type_mask(types, MeasurementType::PERCENT);
+    f128 values = load_f128(sizes);
+    store_f128(select_f128(values, mul_f128(values, p_sizes), percent), sizes);
+    
+    i128 value_types = load_i128(types);
+    store_i128(select_i128(value_types, set_i32_128((int32_t)MeasurementType::PIXELS), cast_f128_i128(percent)), types);
+    
+    return percent;
+}
+
+// Lane wise size_child_axis
+void soa_size_child_axis(sibling_axis_soa* axis, uint32_t lane_count, float p_size)
+{
+    f128 p_sizes = set_f128(p_size);
+    for(uint32_t lane = 0; lane < lane_count; lane += SOA_LANES)
+    {
+        soa_resolve_percent(axis->desired + lane, axis->desired_type + lane, p_sizes);
+        f128 max_resolved = soa_resolve_percent(axis->max + lane, axis->max_type + lane, p_sizes);
+        f128 min_resolved = soa_resolve_percent(axis->min + lane, axis->min_type + lane, p_sizes);
+        soa_resolve_percent(axis->margin1 + lane, axis->margin1_type + lane, p_sizes);
+        soa_resolve_percent(axis->margin2 + lane, axis->margin2_type + lane, p_sizes);
+        
+        // Clip elements against the min/max that were just calculated
+        f128 desired_pixels = soa_type_mask(axis->desired_type + lane, MeasurementType::PIXELS);
+        f128 desired = load_f128(axis->desired + lane);
+        desired = select_f128(desired, min_f128(load_f128(axis->max + lane), desired), and_f128(max_resolved, desired_pixels));
+        desired = select_f128(desired, max_f128(load_f128(axis->min + lane), desired), and_f128(min_resolved, desired_pixels));
+        store_f128(desired, axis->desired + lane);
+    }
+}
+
+// Lane wise accumulate_child_axis plus the current size of grow sized lanes, also returns how many grow measures each
+// lane has
+f128 soa_accumulate_child_axis(sibling_axis_soa* axis, uint32_t lane, f128* grow_counts)
+{
+    f128 ones = set_f128(1.0f);
+    f128 desired_grow = soa_type_mask(axis->desired_type + lane, MeasurementType::GROW);
+    f128 margin1_grow = soa_type_mask(axis->margin1_type + lane, MeasurementType::GROW);
+    f128 margin2_grow = soa_type_mask(axis->margin2_type + lane, MeasurementType::GROW);
+    *grow_counts = add_f128(add_f128(and_f128(desired_grow, ones), and_f128(margin1_grow, ones)), and_f128(margin2_grow, ones));
+    
+    f128 size = and_f128(load_f128(axis->desired + lane), soa_type_mask(axis->desired_type + lane, MeasurementType::PIXELS));
+    size = add_f128(size, and_f128(load_f128(axis->margin1 + lane), soa_type_mask(axis->margin1_type + lane, MeasurementType::PIXELS)));
+    size = add_f128(size, and_f128(load_f128(axis->margin2 + lane), soa_type_mask(axis->margin2_type + lane, MeasurementType::PIXELS)));
+    size = add_f128(size, and_f128(load_f128(axis->current + lane), desired_grow));
+    
+    return size;
+}
+
+// Lane wise grow_child
+void soa_grow_child(sibling_axis_soa* axis, uint32_t lane, f128 growth_space)
+{
+    i128 pixels = set_i32_128((int32_t)MeasurementType::PIXELS);
+    
+    f128 desired_grow = soa_type_mask(axis->desired_type + lane, MeasurementType::GROW);
+    f128 max = load_f128(axis->max + lane);
+    f128 grown = max_f128(load_f128(axis->min + lane), add_f128(load_f128(axis->current + lane), growth_space));
+    grown = select_f128(grown, min_f128(grown, max), cmpgt_f128(max, zero_f128()));
+    
+    store_f128(select_f128(load_f128(axis->desired + lane), grown, desired_grow), axis->desired + lane);
+    store_f128(select_f128(load_f128(axis->current + lane), grown, desired_grow), axis->current + lane);
+    store_i128(select_i128(load_i128(axis->desired_type + lane), pixels, cast_f128_i128(desired_grow)), axis->desired_type + lane);
+    
+    float* margins[] = {axis->margin1 + lane, axis->margin2 + lane};
+    int32_t* margin_types[] = {axis->margin1_type + lane, axis->margin2_type + lane};
+    for(int i = 0; i < 2; i++)
+    {
+        f128 margin_grow = soa_type_mask(margin_types[i], MeasurementType::GROW);
+        store_f128(select_f128(load_f128(margins[i]), growth_space, margin_grow), margins[i]);
+        store_i128(select_i128(load_i128(margin_types[i]), pixels, cast_f128_i128(margin_grow)), margin_types[i]);
+    }
+}
+
+float soa_horizontal_sum(f128 values)
+{
+    float lanes[SOA_LANES];
+    store_f128(values, lanes);
+    
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Does the sizing part of the final pass for parents with lots of children, the children are gathered into arrays
+// so percent resolution, accumulation and growing can be done on several siblings at once.
+// Returns false without changing anything if the parent cant be sized this way.
+bool shape_final_pass_wide(LayoutElement* parent, float p_width, float p_height)
+{
+    LayoutElement* children = parent->children;
+    
+    // Note(Leo): Manually placed children have their own rules in the final pass so they are left to it
+    uint32_t sized_count = 0;
+    for(int i = 0; i < parent->child_count; i++)
+    {
+        if(children[i].display == DisplayType::RELATIONAL || children[i].display == DisplayType::MANUAL)
+        {
+            return false;
+        }
+        if(children[i].type != LayoutElementType::TEXT)
+        {
+            sized_count++;
+        }
+    }
+    
+    uint32_t lane_count = (sized_count + SOA_LANES - 1) & ~(SOA_LANES - 1);
+    
+    // Note(Leo): +1 to leave space for alignment
+    void* sized_memory = AllocScratch((sized_count + 1)*sizeof(LayoutElement*));
+    LayoutElement** sized = align_mem(sized_memory, LayoutElement*);
+    
+    void* soa_memory = AllocScratch((2*SOA_AXIS_ARRAYS*lane_count + SOA_LANES)*sizeof(uint32_t), zero());
+    uint32_t* soa_block = align_mem(soa_memory, uint32_t);
+    
+    sibling_axis_soa width = {};
+    sibling_axis_soa height = {};
+    soa_slice_axis(&width, soa_block, lane_count);
+    soa_slice_axis(&height, soa_block + (SOA_AXIS_ARRAYS*lane_count), lane_count);
+    
+    uint32_t lane = 0;
+    for(int i = 0; i < parent->child_count; i++)
+    {
+        if(children[i].type == LayoutElementType::TEXT) // We need to skip all the non-combined text
+        {
+            continue;
+        }
+        sized[lane] = &children[i];
+        soa_gather_axis(&width, lane, &children[i].sizing.width);
+        soa_gather_axis(&height, lane, &children[i].sizing.height);
+        lane++;
+    }
+    
+    soa_size_child_axis(&width, lane_count, p_width);
+    soa_size_child_axis(&height, lane_count, p_height);
+    
+    // Note(Leo): Sizes add together along the layout direction, across it every child grows into the whole parent
+    //            on its own.
+    bool horizontal = parent->dir == LayoutDirection::HORIZONTAL;
+    sibling_axis_soa* along = horizontal ? &width : &height;
+    sibling_axis_soa* across = horizontal ? &height : &width;
+    float p_along = horizontal ? p_width : p_height;
+    float p_across = horizontal ? p_height : p_width;
+    
+    f128 accumulated = zero_f128();
+    f128 grow_counts = zero_f128();
+    f128 ones = set_f128(1.0f);
+    for(lane = 0; lane < lane_count; lane += SOA_LANES)
+    {
+        f128 lane_grow_counts;
+        accumulated = add_f128(accumulated, soa_accumulate_child_axis(along, lane, &lane_grow_counts));
+        grow_counts = add_f128(grow_counts, lane_grow_counts);
+        
+        f128 child_size = soa_accumulate_child_axis(across, lane, &lane_grow_counts);
+        f128 growth_space = div_f128(sub_f128(set_f128(p_across), child_size), max_f128(lane_grow_counts, ones));
+        soa_grow_child(across, lane, max_f128(growth_space, zero_f128()));
+    }
+    
+    float p_accumulated = soa_horizontal_sum(accumulated);
+    float grow_count = soa_horizontal_sum(grow_counts);
+    if(grow_count)
+    {
+        // Note(Leo): Same as the narrow version, this is the leftover space after the min size of growth elements 
+        f128 growth_space = set_f128(MAX((p_along - p_accumulated) / grow_count, 0.0f));
+        for(lane = 0; lane < lane_count; lane += SOA_LANES)
+        {
+            soa_grow_child(along, lane, growth_space);
+        }
+    }
+    
+    for(lane = 0; lane < sized_count; lane++)
+    {
+        soa_scatter_axis(&width, lane, &sized[lane]->sizing.width);
+        soa_scatter_axis(&height, lane, &sized[lane]->sizing.height);
+    }
+    
+    // Note(Leo): To properly calculate scrollable elements we need the size of the parents contents.
+    size_axis* parent_along = horizontal ? &parent->sizing.width : &parent->sizing.height;
+    size_axis* parent_across = horizontal ? &parent->sizing.height : &parent->sizing.width;
+    parent_along->current = MAX(MAX(p_accumulated, parent_along->current), parent_along->desired.size);
+    parent_across->current = MAX(MAX(0.0f, parent_across->current), parent_across->desired.size);
+    
+    DeAllocScratch(soa_memory);
+    DeAllocScratch(sized_memory);
+    
+    return true;
+}
+#endif
+
 // Note(Leo): Explanation of final pass
 // Final pass is another downward one.
 // All required sizes should be known now. Parents find any grow/percent sized
@@ -736,6 +1256,16 @@ void shape_final_pass(shaping_context* context, LayoutElement* parent)
     float p_height = parent->sizing.height.desired.size - (parent->sizing.height.padding1.size + parent->sizing.height.padding2.size);
     float p_height_accumulated = 0;
     
+    #if ARCH_X64 || ARCH_NEON || ARCH_X64_SSE
+    if(SUPPORTED_SIMD != SimdLevel::NONE && parent->child_count >= LAYOUT_SIMD_MIN_CHILDREN && dir != LayoutDirection::GRID)
+    {
+        if(shape_final_pass_wide(parent, p_width, p_height))
+        {
+            return;
+        }
+    }
+    #endif
+    
     LayoutElement** revisit_width_elements = (LayoutElement**)AllocScratch(parent->child_count*sizeof(LayoutElement*));
     uint32_t revisit_width_element_count = 0;
     
@@ -960,7 +1490,61 @@ void final_place_text(shaping_context* context, LayoutElement* combined_text)
     float base_x = combined_text->position.x;
     float base_y = combined_text->position.y;
     
-    for(uint32_t i = 0; i < combined_text->TEXT_COMBINED.glyph_count; i++)
+    uint32_t first_glyph = 0;
+    uint32_t end_glyph = combined_text->TEXT_COMBINED.glyph_count;
+    
+    // Note(Leo): Only the glyphs of lines that overlap the visible bounds are looked at so long text that is mostly 
+    //            clipped costs about as much as what is on screen.
+    FontPlatformShapedLine* lines = combined_text->TEXT_COMBINED.first_line;
+    uint32_t line_count = combined_text->TEXT_COMBINED.line_count;
+    if(line_count)
+    {
+        float visible_top = combined_text->bounds.y - base_y;
+        float visible_bottom = visible_top + combined_text->bounds.height;
+        
+        // First line that reaches down into the bounds
+        uint32_t low = 0;
+        uint32_t high = line_count;
+        while(low < high)
+        {
+            uint32_t middle = (low + high) / 2;
+            if(lines[middle].bottom < visible_top)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        uint32_t first_line = low;
+        
+        // First line that starts below the bounds
+        high = line_count;
+        while(low < high)
+        {
+            uint32_t middle = (low + high) / 2;
+            if(lines[middle].top <= visible_bottom)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        uint32_t end_line = low;
+        
+        if(first_line >= end_line)
+        {
+            return;
+        }
+        
+        first_glyph = lines[first_line].first_glyph;
+        end_glyph = lines[end_line - 1].first_glyph + lines[end_line - 1].glyph_count;
+    }
+    
+    for(uint32_t i = first_glyph; i < end_glyph; i++)
     {
         FontPlatformShapedGlyph* curr_glyph = combined_text->TEXT_COMBINED.first_glyph + i;
         
@@ -1011,23 +1595,317 @@ void final_place_element(shaping_context* context, LayoutElement* element)
 }
 
 // Note(Leo): The root element should have the screen size as its width/height and the measures should be pixels
-Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int element_count, int window_width, int window_height)
+// Returns the range of grid cells the bounds overlap, clamped to the grid
+void get_hit_test_cells(HitTestGrid* grid, bounding_box* bounds, int* first_column, int* first_row, int* last_column, int* last_row)
+{
+    *first_column = MAX(0, MIN((int)bounds->x / HIT_TEST_CELL_SIZE, grid->columns - 1));
+    *first_row = MAX(0, MIN((int)bounds->y / HIT_TEST_CELL_SIZE, grid->rows - 1));
+    *last_column = MAX(0, MIN((int)(bounds->x + bounds->width) / HIT_TEST_CELL_SIZE, grid->columns - 1));
+    *last_row = MAX(0, MIN((int)(bounds->y + bounds->height) / HIT_TEST_CELL_SIZE, grid->rows - 1));
+}
+
+// Bins the bounds collected by the final pass into a uniform grid that the runtime uses for hover/click
+HitTestGrid* build_hit_test_grid(Arena* shape_arena, HitTestEntry* entries, uint32_t entry_count, int window_width, int window_height)
+{
+    HitTestGrid* grid = align_mem(Alloc(shape_arena, sizeof(HitTestGrid) + alignof(HitTestGrid)), HitTestGrid);
+    grid->entries = entries;
+    grid->entry_count = entry_count;
+    grid->columns = (uint16_t)((MAX(window_width, 1) + HIT_TEST_CELL_SIZE - 1) / HIT_TEST_CELL_SIZE);
+    grid->rows = (uint16_t)((MAX(window_height, 1) + HIT_TEST_CELL_SIZE - 1) / HIT_TEST_CELL_SIZE);
+    
+    uint32_t cell_count = (uint32_t)grid->columns * grid->rows;
+    
+    // Note(Leo): Counting sort, count how many entries land in each cell then turn the counts into offsets.
+    //            Counts are stored one cell ahead so the prefix sum leaves the start of each cell in place.
+    grid->cell_offsets = align_mem(Alloc(shape_arena, (cell_count + 2)*sizeof(uint32_t)), uint32_t);
+    for(uint32_t i = 0; i < entry_count; i++)
+    {
+        int first_column, first_row, last_column, last_row;
+        get_hit_test_cells(grid, &entries[i].bounds, &first_column, &first_row, &last_column, &last_row);
+        
+        for(int row = first_row; row <= last_row; row++)
+        {
+            for(int column = first_column; column <= last_column; column++)
+            {
+                grid->cell_offsets[(row * grid->columns) + column + 1]++;
+            }
+        }
+    }
+    
+    for(uint32_t i = 1; i <= cell_count; i++)
+    {
+        grid->cell_offsets[i] += grid->cell_offsets[i - 1];
+    }
+    
+    grid->cell_entries = align_mem(Alloc(shape_arena, (grid->cell_offsets[cell_count] + 1)*sizeof(uint32_t)), uint32_t);
+    
+    void* fill_memory = AllocScratch((cell_count + 1)*sizeof(uint32_t), no_zero());
+    uint32_t* fill_offsets = align_mem(fill_memory, uint32_t);
+    memcpy(fill_offsets, grid->cell_offsets, cell_count*sizeof(uint32_t));
+    
+    // Entries are added in draw order so each cell stays sorted back to front
+    for(uint32_t i = 0; i < entry_count; i++)
+    {
+        int first_column, first_row, last_column, last_row;
+        get_hit_test_cells(grid, &entries[i].bounds, &first_column, &first_row, &last_column, &last_row);
+        
+        for(int row = first_row; row <= last_row; row++)
+        {
+            for(int column = first_column; column <= last_column; column++)
+            {
+                grid->cell_entries[fill_offsets[(row * grid->columns) + column]++] = i;
+            }
+        }
+    }
+    
+    DeAllocScratch(fill_memory);
+    
+    return grid;
+}
+
+uint32_t HitTestGridQuery(HitTestGrid* grid, vec2 point, uint32_t* element_ids)
+{
+    if(!grid || point.x < 0.0f || point.y < 0.0f)
+    {
+        return 0;
+    }
+    
+    int column = (int)point.x / HIT_TEST_CELL_SIZE;
+    int row = (int)point.y / HIT_TEST_CELL_SIZE;
+    if(column >= grid->columns || row >= grid->rows)
+    {
+        return 0;
+    }
+    
+    uint32_t cell = (row * grid->columns) + column;
+    uint32_t hit_count = 0;
+    for(uint32_t i = grid->cell_offsets[cell]; i < grid->cell_offsets[cell + 1]; i++)
+    {
+        HitTestEntry* entry = &grid->entries[grid->cell_entries[i]];
+        if(PointInsideBounds(entry->bounds, point))
+        {
+            element_ids[hit_count] = entry->element_id;
+            hit_count++;
+        }
+    }
+    
+    return hit_count;
+}
+
+// Unpacks and first passes the children of the element, or copies them from the last layout if it is cached
+void lay_out_children(shaping_context* context, LayoutElement* parent)
+{
+    // Note(Leo): Spacers point at their each, whose instances were already unpacked next to them
+    if(parent->type == LayoutElementType::SPACER)
+    {
+        return;
+    }
+    
+    if(parent->cache != LayoutCache::NONE)
+    {
+        // Note(Leo): Cached children were already through the first pass last layout
+        copy_cached_children(context, parent);
+        return;
+    }
+    
+    // Note(Leo): This relies on elements being indexed into the elements arena by their id
+    Element* unpack_parent = context->root_element + parent->element_id;
+    unpack(context, unpack_parent->first_child, &(parent->children), &(parent->child_count));
+    
+    shape_first_pass(context, parent);
+}
+
+void count_display_type(shaping_context* context, LayoutElement* element)
+{
+    if(element->display == DisplayType::RELATIONAL)
+    {
+        context->relative_element_count++;
+    }
+    else if(element->display == DisplayType::MANUAL)
+    {
+        context->manual_element_count++;
+    }
+}
+
+// Counts every element below the given one along with the spacers of virtual eaches, this is an upper bound on the 
+// layout elements its subtree unpacks into
+uint32_t count_subtree(Element* root)
+{
+    uint32_t count = 0;
+    Element* curr = root->first_child;
+    while(curr)
+    {
+        count++;
+        if(curr->type == ElementType::EACH)
+        {
+            count += EachSpacerCount(curr);
+        }
+        if(curr->first_child)
+        {
+            curr = curr->first_child;
+            continue;
+        }
+        
+        while(curr != root && !curr->next_sibling)
+        {
+            curr = curr->parent;
+        }
+        curr = curr == root ? NULL : curr->next_sibling;
+    }
+    
+    return count;
+}
+
+struct layout_job
+{
+    LayoutElement* root; // Unpacked and first passed by the main thread, the job lays out everything below it
+    shaping_context context; // Counts are added back into the main context once the job is done
+    Arena layout_element_arena;
+};
+
+struct layout_job_queue
+{
+    layout_job* jobs;
+    uint32_t job_count;
+    std::atomic<uint32_t> next_job;
+    
+    // Note(Leo): Jobs carve their layout elements out of what is left of the main layout element block once they know
+    //            how large their subtree is.
+    std::atomic<uintptr_t> layout_cursor;
+    uintptr_t layout_end;
+    
+    std::mutex shape_arena_lock;
+};
+
+static layout_job_queue layout_queue;
+
+// Lays out the subtree of a split off element, this mirrors the main loop of ShapingPlatformShape
+void run_layout_job(layout_job* job)
+{
+    shaping_context* context = &job->context;
+    Element* root_element = context->root_element + job->root->element_id;
+    
+    uint32_t subtree_size = count_subtree(root_element)*sizeof(LayoutElement);
+    uintptr_t subtree_memory = layout_queue.layout_cursor.fetch_add(subtree_size);
+    assert(subtree_memory + subtree_size <= layout_queue.layout_end);
+    
+    job->layout_element_arena = CreateArenaWith((void*)subtree_memory, subtree_size, sizeof(LayoutElement));
+    context->layout_element_arena = &job->layout_element_arena;
+    
+    lay_out_children(context, job->root);
+    uint32_t unpacked_count = job->root->child_count;
+    
+    LayoutElement* curr_element = (LayoutElement*)context->layout_element_arena->mapped_address; 
+    while(unpacked_count)
+    {
+        lay_out_children(context, curr_element);
+        unpacked_count += curr_element->child_count;
+        
+        count_display_type(context, curr_element);
+        
+        curr_element++;
+        unpacked_count--;
+    }
+    
+    curr_element = (LayoutElement*)context->layout_element_arena->next_address;
+    curr_element--;
+    while((uintptr_t)curr_element >= context->layout_element_arena->mapped_address)
+    {
+        if(curr_element->type != LayoutElementType::TEXT && curr_element->cache == LayoutCache::NONE)
+        {
+            shape_second_pass(context, curr_element);
+        }
+        curr_element--;
+    }
+    
+    shape_second_pass(context, job->root);
+}
+
+// Run on the job pool, every thread takes jobs off of the queue until there are none left
+void run_layout_jobs(void* data, uint32_t thread_index)
+{
+    while(true)
+    {
+        uint32_t job_index = layout_queue.next_job.fetch_add(1);
+        if(job_index >= layout_queue.job_count)
+        {
+            return;
+        }
+        run_layout_job(&layout_queue.jobs[job_index]);
+    }
+}
+
+// Lays out every split off element on the job pool, then adds their counts to the context
+void run_split_layout(shaping_context* context, LayoutElement* first_element, LayoutElement* last_element, uint32_t split_count)
+{
+    void* job_memory = Alloc(context->shape_arena, (split_count + 1)*sizeof(layout_job));
+    layout_job* jobs = align_mem(job_memory, layout_job);
+    
+    uint32_t job_count = 0;
+    for(LayoutElement* curr = first_element; curr < last_element; curr++)
+    {
+        if(curr->split_off)
+        {
+            jobs[job_count].root = curr;
+            jobs[job_count].context = *context;
+            jobs[job_count].context.glyph_count = 0;
+            jobs[job_count].context.image_tile_count = 0;
+            jobs[job_count].context.relative_element_count = 0;
+            jobs[job_count].context.manual_element_count = 0;
+            jobs[job_count].context.shape_arena_lock = &layout_queue.shape_arena_lock;
+            job_count++;
+        }
+    }
+    assert(job_count == split_count);
+    
+    layout_queue.jobs = jobs;
+    layout_queue.job_count = job_count;
+    layout_queue.next_job = 0;
+    layout_queue.layout_cursor = context->layout_element_arena->next_address;
+    layout_queue.layout_end = context->layout_element_arena->mapped_address + context->layout_element_arena->size;
+    
+    JobPoolRun(run_layout_jobs, NULL);
+    
+    for(uint32_t i = 0; i < job_count; i++)
+    {
+        context->glyph_count += jobs[i].context.glyph_count;
+        context->image_tile_count += jobs[i].context.image_tile_count;
+        context->relative_element_count += jobs[i].context.relative_element_count;
+        context->manual_element_count += jobs[i].context.manual_element_count;
+    }
+}
+
+Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int element_count, int window_width, int window_height, HitTestGrid** hit_grid)
 {
     shaping_context context = {};
     context.element_count = (uint32_t)element_count;
     
+    layout_generation++;
+    context.generation = layout_generation;
+    
+    // Note(Leo): The last layout can only be reused if it wasnt written into the arena we are about to shape into
+    LayoutElement* previous_root = root_element->last_sizing;
+    if(previous_root && ((uintptr_t)previous_root < shape_arena->mapped_address || 
+       (uintptr_t)previous_root >= shape_arena->mapped_address + shape_arena->size))
+    {
+        context.previous_generation = previous_root->generation;
+    }
+    
     shape_arena->alloc_size = sizeof(LayoutElement);
     
     // Note(Leo): The unpacking behaviour depends on shape_arena being empty.
     assert(shape_arena && shape_arena->next_address == shape_arena->mapped_address);
     
-    void* memory_block = Alloc(shape_arena, element_count*sizeof(LayoutElement));
+    // Note(Leo): Layout elements are zeroed as they get pushed so the block itself doesnt need to be, that way pages
+    //            past what this layout uses are never touched.
+    void* memory_block = Alloc(shape_arena, element_count*sizeof(LayoutElement), no_zero());
     
     // Note(Leo): Give layout elements their own arena so that when we shape text inbetween unpacks the two things arent mixed
     Arena layout_element_arena = CreateArenaWith(memory_block, element_count*sizeof(LayoutElement), sizeof(LayoutElement));
     
     context.shape_arena = shape_arena;
     context.layout_element_arena = &layout_element_arena;
+    context.root_element = root_element;
 
     // Note(Leo): Root has to have its sizes set as pixels before going into the main loop
     root_element->working_style.width.type = MeasurementType::PIXELS;
@@ -1044,6 +1922,9 @@ Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int eleme
     
     LayoutElement* curr_element = (LayoutElement*)context.layout_element_arena->mapped_address; 
     
+    bool split_layout = element_count >= LAYOUT_SPLIT_MIN_ELEMENTS && JobPoolWorkerCount();
+    uint32_t split_count = 0;
+    
     // Note(Leo): Explanation: 
     // We first unpack root as a child element, which creates it as the first LayoutElement in the layout_element_arena.
     // Then we iterate over the shape arena. Since the unpacked root is the first (and only) element in the shape arena
@@ -1055,36 +1936,57 @@ Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int eleme
     // all children.
     while(unpacked_count)
     {
-        // Note(Leo): This relies on elements being indexed into the elements arena by their id
-        Element* unpack_parent = root_element + curr_element->element_id;
-        
-        unpack(&context, unpack_parent->first_child, &(curr_element->children), &(curr_element->child_count));
-        unpacked_count += curr_element->child_count;
-        
-        BEGIN_TIMED_BLOCK(FIRST_PASS);
-        shape_first_pass(&context, curr_element);
-        END_TIMED_BLOCK(FIRST_PASS);
-        
-        if(curr_element->display == DisplayType::RELATIONAL)
+        // Note(Leo): Split off elements get their subtree laid out by a job once the main loop is done
+        if(!curr_element->split_off)
         {
-            context.relative_element_count++;
-        }
-        else if(curr_element->display == DisplayType::MANUAL)
-        {
-            context.manual_element_count++;
+            BEGIN_TIMED_BLOCK(FIRST_PASS);
+            lay_out_children(&context, curr_element);
+            END_TIMED_BLOCK(FIRST_PASS);
+            unpacked_count += curr_element->child_count;
+            
+            // Note(Leo): Subtrees under a wide container dont depend on each other until the second pass reaches
+            //            the container so they can be laid out in parallel.
+            if(split_layout && curr_element->cache == LayoutCache::NONE && curr_element->child_count >= LAYOUT_SPLIT_MIN_CHILDREN)
+            {
+                for(int i = 0; i < curr_element->child_count; i++)
+                {
+                    LayoutElement* child = curr_element->children + i;
+                    if(child->type == LayoutElementType::NORMAL && child->cache == LayoutCache::NONE && 
+                       (root_element + child->element_id)->first_child)
+                    {
+                        child->split_off = true;
+                        split_count++;
+                    }
+                }
+            }
         }
         
+        count_display_type(&context, curr_element);
+        
         curr_element++;
         unpacked_count--;
     }
     
+    // Note(Leo): Jobs lay out their subtrees after the elements the main loop unpacked so this is where the main 
+    //            loop's elements end.
+    LayoutElement* main_elements_end = (LayoutElement*)context.layout_element_arena->next_address;
+    if(split_count)
+    {
+        BEGIN_TIMED_BLOCK(SPLIT_LAYOUT);
+        run_split_layout(&context, (LayoutElement*)context.layout_element_arena->mapped_address, main_elements_end, split_count);
+        END_TIMED_BLOCK(SPLIT_LAYOUT);
+    }
+    
     // Iterating backwards which is the equivelant of going up from leaf elements.
     // A child element will always be visited before its parent since we unpacked in a breadth first schema
-    curr_element = (LayoutElement*)context.layout_element_arena->next_address;
+    curr_element = main_elements_end;
     curr_element--; // Note(Leo): -1 since we are pointing past the last element.
     while((uintptr_t)curr_element >= context.layout_element_arena->mapped_address)
     {
-        if(curr_element->type != LayoutElementType::TEXT) // Skip non-combined text
+        // Note(Leo): Cached elements keep the sizes from the last layout, the final pass is safe to run on them again
+        //            since it only resolves measurements that arent pixels yet. Split off elements were second 
+        //            passed by their job.
+        if(curr_element->type != LayoutElementType::TEXT && curr_element->cache == LayoutCache::NONE && !curr_element->split_off) // Skip non-combined text
         {
             BEGIN_TIMED_BLOCK(SECOND_PASS);
             shape_second_pass(&context, curr_element);
@@ -1094,7 +1996,7 @@ Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int eleme
     }
     
     // Note(Leo): Leave space for alignment
-    void* final_pass_memory = Alloc(context.shape_arena, (element_count + 1)*sizeof(LayoutElement*));
+    void* final_pass_memory = Alloc(context.shape_arena, (element_count + 1)*sizeof(LayoutElement*), no_zero());
     Arena final_pass_visit = CreateArenaWith(align_mem(final_pass_memory, LayoutElement*), element_count*sizeof(LayoutElement*), sizeof(LayoutElement*));
 
     // Note(Leo): Due to the nature of us adding items to the renderque in a breadth first manner there is an interweave issue
@@ -1102,11 +2004,11 @@ Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int eleme
     //            with the draws of their sibling's subtrees which is fine usually since elements dont overlap, except they can
     //            when manual/relative are used. The deffered que fixes this by allowing all the manual element's siblings to have
     //            fully drawn their subtrees before drawing its own which fixes the weaving issue. 
-    void* relative_pass_memory = Alloc(context.shape_arena, (context.relative_element_count + 1)*sizeof(LayoutElement*));
+    void* relative_pass_memory = Alloc(context.shape_arena, (context.relative_element_count + 1)*sizeof(LayoutElement*), no_zero());
     Arena relative_pass_visit = CreateArenaWith(align_mem(relative_pass_memory, LayoutElement*), context.relative_element_count*sizeof(LayoutElement*), sizeof(LayoutElement*));
     LayoutElement** relative_elements = (LayoutElement**)relative_pass_visit.mapped_address; 
     
-    void* manual_pass_memory = Alloc(context.shape_arena, (context.manual_element_count + 1)*sizeof(LayoutElement*));
+    void* manual_pass_memory = Alloc(context.shape_arena, (context.manual_element_count + 1)*sizeof(LayoutElement*), no_zero());
     Arena manual_pass_visit = CreateArenaWith(align_mem(manual_pass_memory, LayoutElement*), context.manual_element_count*sizeof(LayoutElement*), sizeof(LayoutElement*));
     LayoutElement** manual_elements = (LayoutElement**)manual_pass_visit.mapped_address; 
     
@@ -1135,12 +2037,17 @@ Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int eleme
     // Note(Leo): Need to leave space for padding when we compare renderques, max we need is the size of 1 simd register.
     renderque_size += SIMD_WIDTH * sizeof(float);
     
-    void* final_renderque_memory = Alloc(context.shape_arena, renderque_size);
+    // Note(Leo): Instances are zeroed as they get added and CompareArenaContents zeroes its own padding
+    void* final_renderque_memory = Alloc(context.shape_arena, renderque_size, no_zero());
     
     Arena* final_renderque = (Arena*)align_mem(Alloc(context.shape_arena, 2*sizeof(Arena)), Arena); // +1 for alignment
     *final_renderque = CreateArenaWith(align_mem(final_renderque_memory, combined_instance), renderque_size - sizeof(combined_instance), sizeof(combined_instance));
     context.final_renderque = final_renderque;
     
+    // Every element the final pass visits is visible so it gets an entry for hit testing
+    HitTestEntry* hit_entries = align_mem(Alloc(context.shape_arena, (element_count + 1)*sizeof(HitTestEntry), no_zero()), HitTestEntry);
+    uint32_t hit_entry_count = 0;
+    
     while(visit_count || deferred_relative_count || deferred_manual_count)
     {
         // Note(Leo): Only start grabbing from the deferred relative que once our visit que is exhausted, once deferred
@@ -1187,6 +2094,12 @@ Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int eleme
             }
         }
         
+        if(curr_element->bounds.width > 0.0f && curr_element->bounds.height > 0.0f)
+        {
+            hit_entries[hit_entry_count] = { curr_element->bounds, curr_element->element_id };
+            hit_entry_count++;
+        }
+        
         LayoutDirection dir = curr_element->dir;
         
         float inner_width = curr_element->sizing.width.desired.size;
@@ -1300,6 +2213,14 @@ Arena* ShapingPlatformShape(Element* root_element, Arena* shape_arena, int eleme
         
     }
     
+    if(hit_grid)
+    {
+        *hit_grid = build_hit_test_grid(context.shape_arena, hit_entries, hit_entry_count, window_width, window_height);
+    }
+    
+    TRACK_HIGH_WATER(LAYOUT_ELEMENTS, (layout_element_arena.next_address - layout_element_arena.mapped_address) / sizeof(LayoutElement));
+    TRACK_HIGH_WATER(SHAPE_ARENA_BYTES, shape_arena->next_address - shape_arena->mapped_address);
+    
     return context.final_renderque;
 }
 
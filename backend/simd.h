@@ -57,7 +57,34 @@ extern SimdLevel SUPPORTED_SIMD;
     #define lshift_i128(A, BYTES) _mm_bslli_si128(A, BYTES)
     #define rshift_i128(A, BYTES) _mm_bsrli_si128(A, BYTES)
     #define test_all_ones_i128(A) _mm_test_all_ones(A)
+    #define cmp_i32_128(A, B) _mm_cmpeq_epi32(A, B)
+    #define set_i32_128(value) _mm_set1_epi32(value)
     typedef __m128i i128;
+    
+    // SSE floats
+    #define load_f128(ptr) _mm_loadu_ps((float*)(ptr))
+    #define store_f128(A, ptr) _mm_storeu_ps((float*)(ptr), A)
+    #define set_f128(value) _mm_set1_ps(value)
+    #define zero_f128() _mm_setzero_ps()
+    #define add_f128(A, B) _mm_add_ps(A, B)
+    #define sub_f128(A, B) _mm_sub_ps(A, B)
+    #define mul_f128(A, B) _mm_mul_ps(A, B)
+    #define div_f128(A, B) _mm_div_ps(A, B)
+    #define min_f128(A, B) _mm_min_ps(A, B)
+    #define max_f128(A, B) _mm_max_ps(A, B)
+    #define sqrt_f128(A) _mm_sqrt_ps(A)
+    #define abs_f128(A) _mm_andnot_ps(set_f128(-0.0f), A)
+    #define cmpgt_f128(A, B) _mm_cmpgt_ps(A, B)
+    #define and_f128(A, B) _mm_and_ps(A, B)
+    #define andnot_f128(A, B) _mm_andnot_ps(A, B)
+    #define or_f128(A, B) _mm_or_ps(A, B)
+    #define cast_i128_f128(A) _mm_castsi128_ps(A)
+    #define cast_f128_i128(A) _mm_castps_si128(A)
+    typedef __m128 f128;
+    
+    // Note(Leo): Takes the lanes of B where the mask is set and the lanes of A everywhere else
+    #define select_i128(A, B, mask) or_128(andnot_128(mask, A), and_128(mask, B))
+    #define select_f128(A, B, mask) or_f128(andnot_f128(mask, A), and_f128(mask, B))
 
     // Note(Leo): Inserts value into the lanes in A where the value of the corresponding lane in mask == index
     #define dyn_insert_i8_128(A, mask, value, index) {  \
@@ -87,6 +114,27 @@ extern SimdLevel SUPPORTED_SIMD;
     #define test_equal_i256(A, B) _mm256_testc_si256 (A, B)
     typedef __m256i i256;
     
+    // AVX floats
+    #define load_f256(ptr) _mm256_loadu_ps((float*)(ptr))
+    #define store_f256(A, ptr) _mm256_storeu_ps((float*)(ptr), A)
+    #define set_f256(value) _mm256_set1_ps(value)
+    #define zero_f256() _mm256_setzero_ps()
+    #define add_f256(A, B) _mm256_add_ps(A, B)
+    #define sub_f256(A, B) _mm256_sub_ps(A, B)
+    #define mul_f256(A, B) _mm256_mul_ps(A, B)
+    #define div_f256(A, B) _mm256_div_ps(A, B)
+    #define min_f256(A, B) _mm256_min_ps(A, B)
+    #define max_f256(A, B) _mm256_max_ps(A, B)
+    #define sqrt_f256(A) _mm256_sqrt_ps(A)
+    #define abs_f256(A) _mm256_andnot_ps(set_f256(-0.0f), A)
+    #define cmpgt_f256(A, B) _mm256_cmp_ps(A, B, _CMP_GT_OQ)
+    #define and_f256(A, B) _mm256_and_ps(A, B)
+    #define andnot_f256(A, B) _mm256_andnot_ps(A, B)
+    #define or_f256(A, B) _mm256_or_ps(A, B)
+    typedef __m256 f256;
+    
+    #define select_f256(A, B, mask) or_f256(andnot_f256(mask, A), and_f256(mask, B))
+    
     // Note(Leo): Inserts value into the lanes in A where the value of the corresponding lane in mask == index
     #define dyn_insert_i8_256(A, mask, value, index) {  \
     i256 tmp_reg1 = set_i8_256(index);                  \
@@ -0,0 +1,547 @@
+// Note(Leo): The standard threading headers have to come before the arena macros
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include "platform.h"
+#include "software_renderer.h"
+#include "tile_binning.h"
+#include "job_pool.h"
+#include "simd.h"
+
+#define SOFTWARE_BIN_CAPACITY 4000000 // uint32_t's of tile bins, frames whose bins dont fit test every shape in every tile
+
+struct sw_atlas
+{
+    Arena memory;
+    uvec3 dimensions;
+    uint32_t pixel_size;
+    uint32_t layer_size; // In bytes
+    uint32_t committed_layers; // Layers past this have never been written to and read back as 0
+};
+
+// What a row of a shape needs to work out the rounded rect coverage of its pixels
+struct sw_span
+{
+    int first_x;
+    int count;
+    float centre_x;
+    float half_width;
+    float vertical_distance; // |y - centre y| - half height
+    float left_radius;
+    float right_radius;
+};
+
+// Note(Leo): Tiles accumulate in floats like the shader does and only get packed down once every shape has been blended.
+//            Rows are SOFTWARE_TILE_SIZE wide with room at the end for the last simd register to spill into.
+struct sw_tile_memory
+{
+    float red[SOFTWARE_TILE_SIZE*SOFTWARE_TILE_SIZE + 8];
+    float green[SOFTWARE_TILE_SIZE*SOFTWARE_TILE_SIZE + 8];
+    float blue[SOFTWARE_TILE_SIZE*SOFTWARE_TILE_SIZE + 8];
+    float coverage[SOFTWARE_TILE_SIZE + 8];
+};
+
+struct sw_frame
+{
+    combined_instance* instances;
+    uint32_t instance_count;
+    uint32_t width;
+    uint32_t height;
+    uint32_t* pixels;
+    uint32_t pitch;
+
+    TileBins bins;
+    bool binned;
+    uint32_t* tiles; // Packed dirty tiles to draw, NULL when drawing every tile
+    uint32_t tile_count;
+    std::atomic<uint32_t> next_tile;
+};
+
+typedef void (*rounded_rect_span_fn)(sw_span* span, float* coverage);
+typedef void (*blend_span_fn)(float* red, float* green, float* blue, float* coverage, int count, vec4 color);
+
+struct software_renderer
+{
+    sw_atlas glyph_atlas;
+    sw_atlas image_atlas;
+    Arena memory; // Bins and the per thread tile memory
+
+    uint32_t* bins;
+    sw_tile_memory* tile_memory; // One for each job pool worker and one for the calling thread
+
+    rounded_rect_span_fn rounded_rect_span;
+    blend_span_fn blend_span;
+
+    sw_frame frame;
+};
+
+static software_renderer renderer;
+
+static const float LANE_OFFSETS[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+
+bool create_atlas(sw_atlas* atlas, uvec3 dimensions, uint32_t pixel_size)
+{
+    atlas->dimensions = dimensions;
+    atlas->pixel_size = pixel_size;
+    atlas->layer_size = dimensions.x*dimensions.y*pixel_size;
+    atlas->committed_layers = 0;
+
+    uint64_t atlas_size = (uint64_t)atlas->layer_size*dimensions.z;
+    if(!atlas_size || atlas_size > 0x7FFFFFFF)
+    {
+        return false;
+    }
+
+    // Note(Leo): Only the address space is reserved up front, layers get committed as tiles are written into them
+    atlas->memory = CreateArena((int)atlas_size, pixel_size);
+    return atlas->memory.mapped_address != 0;
+}
+
+uint8_t* get_atlas_row(sw_atlas* atlas, uvec3 offsets, uint32_t row)
+{
+    assert(offsets.z < atlas->dimensions.z);
+    if(offsets.z >= atlas->committed_layers)
+    {
+        uint32_t added_layers = offsets.z + 1 - atlas->committed_layers;
+        Alloc(&atlas->memory, added_layers*atlas->layer_size, zero());
+        atlas->committed_layers = offsets.z + 1;
+    }
+
+    uintptr_t row_offset = (uintptr_t)offsets.z*atlas->layer_size + ((uintptr_t)(offsets.y + row)*atlas->dimensions.x + offsets.x)*atlas->pixel_size;
+    return (uint8_t*)(atlas->memory.mapped_address + row_offset);
+}
+
+// Works out which texel a sampled coordinate lands on, false if it is outside of the atlas (imageLoad returns 0 then)
+inline bool get_texel_coordinate(float value, uint32_t limit, uint32_t* texel)
+{
+    // Note(Leo): ivec conversions truncate towards 0 so anything above -1 still lands on texel 0
+    if(!(value > -1.0f && value < (float)limit))
+    {
+        return false;
+    }
+
+    *texel = (uint32_t)(int)value;
+    return true;
+}
+
+inline uint8_t* get_texel(sw_atlas* atlas, uint32_t x, uint32_t y, uint32_t z)
+{
+    if(x >= atlas->dimensions.x || y >= atlas->dimensions.y || z >= atlas->committed_layers)
+    {
+        return NULL;
+    }
+
+    return (uint8_t*)(atlas->memory.mapped_address + (uintptr_t)z*atlas->layer_size + ((uintptr_t)y*atlas->dimensions.x + x)*atlas->pixel_size);
+}
+
+inline float get_glyph_texel(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint8_t* texel = get_texel(&renderer.glyph_atlas, x, y, z);
+    return texel ? (float)*texel : 0.0f;
+}
+
+inline float smoothstep(float edge_0, float edge_1, float value)
+{
+    float t = (value - edge_0) / (edge_1 - edge_0);
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    return t*t*(3.0f - 2.0f*t);
+}
+
+// Same as sample_font_aa in the shader
+float sample_glyph_coverage(uint32_t x, uint32_t y, uint32_t z)
+{
+    float distance = get_glyph_texel(x, y, z) - 128.0f;
+    float right = get_glyph_texel(x + 1, y, z) - 128.0f;
+    float down = get_glyph_texel(x, y + 1, z) - 128.0f;
+
+    float aaf = fabsf(right - distance) + fabsf(down - distance);
+    if(aaf == 0.0f)
+    {
+        return distance > 0.5f ? 1.0f : 0.0f;
+    }
+
+    return smoothstep(0.5f - aaf, 0.5f + aaf, distance);
+}
+
+// Same as individual_corner_box_aa in the shader, the radius is picked per side since a span only covers one row
+void rounded_rect_span_scalar(sw_span* span, float* coverage)
+{
+    for(int i = 0; i < span->count; i++)
+    {
+        float centre_offset = (float)(span->first_x + i) - span->centre_x;
+        float radius = centre_offset > 0.0f ? span->right_radius : span->left_radius;
+
+        float q_x = fabsf(centre_offset) - span->half_width + radius;
+        float q_y = span->vertical_distance + radius;
+        float outside_x = q_x > 0.0f ? q_x : 0.0f;
+        float outside_y = q_y > 0.0f ? q_y : 0.0f;
+
+        float inside = q_x > q_y ? q_x : q_y;
+        inside = inside < 0.0f ? inside : 0.0f;
+
+        float distance = inside + sqrtf(outside_x*outside_x + outside_y*outside_y) - radius;
+        coverage[i] = 1.0f - smoothstep(0.0f, 2.0f, distance);
+    }
+}
+
+void blend_span_scalar(float* red, float* green, float* blue, float* coverage, int count, vec4 color)
+{
+    for(int i = 0; i < count; i++)
+    {
+        float alpha = coverage[i]*color.a;
+        red[i] += (color.r - red[i])*alpha;
+        green[i] += (color.g - green[i])*alpha;
+        blue[i] += (color.b - blue[i])*alpha;
+    }
+}
+
+// Note(Leo): The simd kernels are the same for every register width so they are stamped out for each one. Rounded rect
+//            spans write coverage for the padding lanes past count too, coverage has room for them.
+#define rounded_rect_span_kernel(bits)                                                                                    \
+void rounded_rect_span_##bits(sw_span* span, float* coverage)                                                           \
+{                                                                                                                       \
+    const int lanes = sizeof(f##bits) / sizeof(float);                                                                  \
+    f##bits zero = zero_f##bits();                                                                                      \
+    f##bits one = set_f##bits(1.0f);                                                                                    \
+    f##bits three = set_f##bits(3.0f);                                                                                  \
+    f##bits half = set_f##bits(0.5f);                                                                                   \
+    f##bits lane_offsets = load_f##bits(LANE_OFFSETS);                                                                  \
+    f##bits centre_x = set_f##bits(span->centre_x);                                                                     \
+    f##bits half_width = set_f##bits(span->half_width);                                                                 \
+    f##bits vertical_distance = set_f##bits(span->vertical_distance);                                                   \
+    f##bits left_radius = set_f##bits(span->left_radius);                                                               \
+    f##bits right_radius = set_f##bits(span->right_radius);                                                             \
+                                                                                                                        \
+    for(int i = 0; i < span->count; i += lanes)                                                                         \
+    {                                                                                                                   \
+        f##bits x = add_f##bits(set_f##bits((float)(span->first_x + i)), lane_offsets);                                 \
+        f##bits centre_offset = sub_f##bits(x, centre_x);                                                               \
+        f##bits radius = select_f##bits(left_radius, right_radius, cmpgt_f##bits(centre_offset, zero));                 \
+                                                                                                                        \
+        f##bits q_x = add_f##bits(sub_f##bits(abs_f##bits(centre_offset), half_width), radius);                         \
+        f##bits q_y = add_f##bits(vertical_distance, radius);                                                           \
+        f##bits outside_x = max_f##bits(q_x, zero);                                                                     \
+        f##bits outside_y = max_f##bits(q_y, zero);                                                                     \
+        f##bits inside = min_f##bits(max_f##bits(q_x, q_y), zero);                                                      \
+                                                                                                                        \
+        f##bits outside = sqrt_f##bits(add_f##bits(mul_f##bits(outside_x, outside_x), mul_f##bits(outside_y, outside_y))); \
+        f##bits distance = sub_f##bits(add_f##bits(inside, outside), radius);                                           \
+                                                                                                                        \
+        f##bits t = min_f##bits(max_f##bits(mul_f##bits(distance, half), zero), one);                                   \
+        f##bits smoothed = mul_f##bits(mul_f##bits(t, t), sub_f##bits(three, add_f##bits(t, t)));                       \
+        store_f##bits(sub_f##bits(one, smoothed), coverage + i);                                                        \
+    }                                                                                                                   \
+}
+
+#define blend_span_kernel(bits)                                                                                           \
+void blend_span_##bits(float* red, float* green, float* blue, float* coverage, int count, vec4 color)                   \
+{                                                                                                                       \
+    const int lanes = sizeof(f##bits) / sizeof(float);                                                                  \
+    f##bits color_red = set_f##bits(color.r);                                                                           \
+    f##bits color_green = set_f##bits(color.g);                                                                         \
+    f##bits color_blue = set_f##bits(color.b);                                                                          \
+    f##bits color_alpha = set_f##bits(color.a);                                                                         \
+                                                                                                                        \
+    int i = 0;                                                                                                          \
+    for(; i + lanes <= count; i += lanes)                                                                               \
+    {                                                                                                                   \
+        f##bits alpha = mul_f##bits(load_f##bits(coverage + i), color_alpha);                                           \
+        f##bits curr_red = load_f##bits(red + i);                                                                       \
+        f##bits curr_green = load_f##bits(green + i);                                                                   \
+        f##bits curr_blue = load_f##bits(blue + i);                                                                     \
+        store_f##bits(add_f##bits(curr_red, mul_f##bits(sub_f##bits(color_red, curr_red), alpha)), red + i);           \
+        store_f##bits(add_f##bits(curr_green, mul_f##bits(sub_f##bits(color_green, curr_green), alpha)), green + i);   \
+        store_f##bits(add_f##bits(curr_blue, mul_f##bits(sub_f##bits(color_blue, curr_blue), alpha)), blue + i);       \
+    }                                                                                                                   \
+    blend_span_scalar(red + i, green + i, blue + i, coverage + i, count - i, color);                                    \
+}
+
+#if ARCH_X64 || ARCH_NEON || ARCH_X64_SSE
+rounded_rect_span_kernel(128)
+blend_span_kernel(128)
+#endif
+#if ARCH_X64
+rounded_rect_span_kernel(256)
+blend_span_kernel(256)
+#endif
+
+void draw_tile(sw_frame* frame, uint32_t column, uint32_t row, sw_tile_memory* memory)
+{
+    uint32_t columns = (frame->width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    uint32_t tile_index = row*columns + column;
+    int tile_x = (int)(column*SOFTWARE_TILE_SIZE);
+    int tile_y = (int)(row*SOFTWARE_TILE_SIZE);
+    int tile_width = MIN(SOFTWARE_TILE_SIZE, (int)frame->width - tile_x);
+    int tile_height = MIN(SOFTWARE_TILE_SIZE, (int)frame->height - tile_y);
+
+    for(int row = 0; row < tile_height; row++)
+    {
+        memset(memory->red + row*SOFTWARE_TILE_SIZE, 0, tile_width*sizeof(float));
+        memset(memory->green + row*SOFTWARE_TILE_SIZE, 0, tile_width*sizeof(float));
+        memset(memory->blue + row*SOFTWARE_TILE_SIZE, 0, tile_width*sizeof(float));
+    }
+
+    uint32_t first_shape = 0;
+    uint32_t last_shape = frame->instance_count;
+    if(frame->binned)
+    {
+        first_shape = frame->bins.offsets[tile_index];
+        last_shape = frame->bins.offsets[tile_index + 1];
+    }
+
+    for(uint32_t shape = first_shape; shape < last_shape; shape++)
+    {
+        combined_instance* curr = frame->instances + (frame->binned ? frame->bins.indices[shape] : shape);
+
+        // Note(Leo): Bounds are inclusive on both sides so the covered pixels are the whole coordinates inside them
+        float left = MAX(curr->bounds.r, (float)tile_x);
+        float top = MAX(curr->bounds.g, (float)tile_y);
+        float right = MIN(curr->bounds.b, (float)(tile_x + tile_width - 1));
+        float bottom = MIN(curr->bounds.a, (float)(tile_y + tile_height - 1));
+        if(!(left <= right && top <= bottom))
+        {
+            continue;
+        }
+
+        int first_x = (int)ceilf(left);
+        int last_x = (int)floorf(right);
+        int first_y = (int)ceilf(top);
+        int last_y = (int)floorf(bottom);
+        if(first_x > last_x || first_y > last_y)
+        {
+            continue;
+        }
+
+        CombinedInstanceType type = (CombinedInstanceType)curr->type;
+
+        // Sampled positions divide by the shape size
+        if(type != CombinedInstanceType::NORMAL && !(curr->shape_size.x > 0.0f && curr->shape_size.y > 0.0f))
+        {
+            continue;
+        }
+
+        float sample_scale_x = curr->sample_size.x / curr->shape_size.x;
+        float sample_scale_y = curr->sample_size.y / curr->shape_size.y;
+
+        sw_span span = {};
+        span.first_x = first_x;
+        span.count = last_x - first_x + 1;
+        span.half_width = curr->shape_size.x / 2.0f;
+        span.centre_x = curr->shape_position.x + span.half_width;
+        float half_height = curr->shape_size.y / 2.0f;
+        float centre_y = curr->shape_position.y + half_height;
+
+        for(int y = first_y; y <= last_y; y++)
+        {
+            int row_offset = (y - tile_y)*SOFTWARE_TILE_SIZE + (first_x - tile_x);
+            float* red = memory->red + row_offset;
+            float* green = memory->green + row_offset;
+            float* blue = memory->blue + row_offset;
+
+            if(type == CombinedInstanceType::GLYPH)
+            {
+                // Note(Leo): Text is not currently allowed to have transparency
+                vec4 text_color = { curr->corners.r, curr->corners.g, curr->corners.b, 1.0f };
+
+                uint32_t sample_y;
+                uint32_t sample_z = (uint32_t)curr->sample_position.z;
+                bool row_inside = get_texel_coordinate(((float)y - curr->shape_position.y)*sample_scale_y + curr->sample_position.y, renderer.glyph_atlas.dimensions.y, &sample_y);
+                for(int i = 0; i < span.count; i++)
+                {
+                    uint32_t sample_x;
+                    float sampled = ((float)(first_x + i) - curr->shape_position.x)*sample_scale_x + curr->sample_position.x;
+                    if(row_inside && get_texel_coordinate(sampled, renderer.glyph_atlas.dimensions.x, &sample_x))
+                    {
+                        memory->coverage[i] = sample_glyph_coverage(sample_x, sample_y, sample_z);
+                    }
+                    else
+                    {
+                        memory->coverage[i] = sample_glyph_coverage(0xFFFFFFFF, 0xFFFFFFFF, sample_z);
+                    }
+                }
+
+                renderer.blend_span(red, green, blue, memory->coverage, span.count, text_color);
+                continue;
+            }
+
+            float centre_offset_y = (float)y - centre_y;
+            span.vertical_distance = fabsf(centre_offset_y) - half_height;
+            span.right_radius = centre_offset_y > 0.0f ? curr->corners.r : curr->corners.g;
+            span.left_radius = centre_offset_y > 0.0f ? curr->corners.b : curr->corners.a;
+            renderer.rounded_rect_span(&span, memory->coverage);
+
+            if(type == CombinedInstanceType::IMAGE_TILE)
+            {
+                uint32_t sample_y;
+                uint32_t sample_z = (uint32_t)curr->sample_position.z;
+                bool row_inside = get_texel_coordinate(((float)y - curr->shape_position.y)*sample_scale_y + curr->sample_position.y, renderer.image_atlas.dimensions.y, &sample_y);
+                for(int i = 0; i < span.count; i++)
+                {
+                    uint32_t sample_x;
+                    float sampled = ((float)(first_x + i) - curr->shape_position.x)*sample_scale_x + curr->sample_position.x;
+                    uint8_t* texel = NULL;
+                    if(row_inside && get_texel_coordinate(sampled, renderer.image_atlas.dimensions.x, &sample_x))
+                    {
+                        texel = get_texel(&renderer.image_atlas, sample_x, sample_y, sample_z);
+                    }
+                    if(!texel)
+                    {
+                        continue;
+                    }
+
+                    float alpha = memory->coverage[i]*((float)texel[3] / 255.0f);
+                    red[i] += ((float)texel[0] / 255.0f - red[i])*alpha;
+                    green[i] += ((float)texel[1] / 255.0f - green[i])*alpha;
+                    blue[i] += ((float)texel[2] / 255.0f - blue[i])*alpha;
+                }
+                continue;
+            }
+
+            vec4 shape_color = { curr->sample_position.x, curr->sample_position.y, curr->sample_position.z, curr->sample_size.x };
+            renderer.blend_span(red, green, blue, memory->coverage, span.count, shape_color);
+        }
+    }
+
+    for(int row = 0; row < tile_height; row++)
+    {
+        uint32_t* target = frame->pixels + (uintptr_t)(tile_y + row)*frame->pitch + tile_x;
+        float* red = memory->red + row*SOFTWARE_TILE_SIZE;
+        float* green = memory->green + row*SOFTWARE_TILE_SIZE;
+        float* blue = memory->blue + row*SOFTWARE_TILE_SIZE;
+        for(int i = 0; i < tile_width; i++)
+        {
+            // Note(Leo): Rounded like a store to a UNORM image
+            uint32_t r = (uint32_t)(MIN(MAX(red[i], 0.0f), 1.0f)*255.0f + 0.5f);
+            uint32_t g = (uint32_t)(MIN(MAX(green[i], 0.0f), 1.0f)*255.0f + 0.5f);
+            uint32_t b = (uint32_t)(MIN(MAX(blue[i], 0.0f), 1.0f)*255.0f + 0.5f);
+            target[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+        }
+    }
+}
+
+// Run on the job pool, every thread draws tiles into its own tile memory until there are none left
+void draw_tiles(void* data, uint32_t thread_index)
+{
+    sw_tile_memory* memory = renderer.tile_memory + thread_index;
+    sw_frame* frame = &renderer.frame;
+    uint32_t columns = (frame->width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+    while(true)
+    {
+        uint32_t job = frame->next_tile.fetch_add(1);
+        if(job >= frame->tile_count)
+        {
+            return;
+        }
+        
+        if(frame->tiles)
+        {
+            draw_tile(frame, dirty_tile_column(frame->tiles[job]), dirty_tile_row(frame->tiles[job]), memory);
+        }
+        else
+        {
+            draw_tile(frame, job % columns, job / columns, memory);
+        }
+    }
+}
+
+bool InitializeSoftwareRenderer(uvec3 glyph_atlas_dimensions, uvec3 image_atlas_dimensions)
+{
+    if(!create_atlas(&renderer.glyph_atlas, glyph_atlas_dimensions, sizeof(uint8_t)))
+    {
+        return false;
+    }
+    if(!create_atlas(&renderer.image_atlas, image_atlas_dimensions, 4*sizeof(uint8_t)))
+    {
+        return false;
+    }
+
+    switch(SUPPORTED_SIMD)
+    {
+        #if ARCH_X64
+        case(SimdLevel::AVX512):
+        case(SimdLevel::AVX2):
+        {
+            renderer.rounded_rect_span = rounded_rect_span_256;
+            renderer.blend_span = blend_span_256;
+            break;
+        }
+        #endif
+        #if ARCH_X64 || ARCH_NEON || ARCH_X64_SSE
+        case(SimdLevel::SSE2):
+        case(SimdLevel::NEON):
+        {
+            renderer.rounded_rect_span = rounded_rect_span_128;
+            renderer.blend_span = blend_span_128;
+            break;
+        }
+        #endif
+        default:
+        {
+            renderer.rounded_rect_span = rounded_rect_span_scalar;
+            renderer.blend_span = blend_span_scalar;
+            break;
+        }
+    }
+
+    // Note(Leo): +1 so the tile memory can be aligned
+    int tile_memory_size = (JobPoolWorkerCount() + 2)*sizeof(sw_tile_memory);
+    renderer.memory = CreateArena(tile_memory_size + SOFTWARE_BIN_CAPACITY*sizeof(uint32_t), sizeof(char));
+    renderer.bins = (uint32_t*)Alloc(&renderer.memory, SOFTWARE_BIN_CAPACITY*sizeof(uint32_t), no_zero());
+    void* tile_memory = Alloc(&renderer.memory, tile_memory_size, no_zero());
+    renderer.tile_memory = align_mem(tile_memory, sw_tile_memory);
+
+    return true;
+}
+
+void SoftwareRendererUploadGlyph(void* glyph_data, int glyph_width, int glyph_height, uvec3 atlas_offsets)
+{
+    assert(atlas_offsets.x + glyph_width <= renderer.glyph_atlas.dimensions.x);
+    assert(atlas_offsets.y + glyph_height <= renderer.glyph_atlas.dimensions.y);
+
+    for(int row = 0; row < glyph_height; row++)
+    {
+        memcpy(get_atlas_row(&renderer.glyph_atlas, atlas_offsets, row), (uint8_t*)glyph_data + row*glyph_width, glyph_width);
+    }
+}
+
+void SoftwareRendererUploadImageTile(void* tile_data, int tile_width, int tile_height, uvec3 atlas_offsets)
+{
+    assert(atlas_offsets.x + tile_width <= renderer.image_atlas.dimensions.x);
+    assert(atlas_offsets.y + tile_height <= renderer.image_atlas.dimensions.y);
+
+    for(int row = 0; row < tile_height; row++)
+    {
+        memcpy(get_atlas_row(&renderer.image_atlas, atlas_offsets, row), (uint8_t*)tile_data + row*tile_width*4, tile_width*4);
+    }
+}
+
+void SoftwareRendererDraw(combined_instance* instances, uint32_t instance_count, uint32_t width, uint32_t height, uint32_t* pixels, uint32_t pitch, 
+                          uint32_t* tiles, uint32_t tile_count)
+{
+    if(!width || !height || (tiles && !tile_count))
+    {
+        return;
+    }
+
+    sw_frame* frame = &renderer.frame;
+    frame->instances = instances;
+    frame->instance_count = instance_count;
+    frame->width = width;
+    frame->height = height;
+    frame->pixels = pixels;
+    frame->pitch = pitch;
+    frame->binned = BinInstances(instances, instance_count, width, height, SOFTWARE_TILE_SIZE, renderer.bins, SOFTWARE_BIN_CAPACITY, &frame->bins) != 0;
+    frame->tiles = tiles;
+    frame->tile_count = tiles ? tile_count : ((width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE)*((height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE);
+    frame->next_tile = 0;
+
+    if(frame->tile_count > 1)
+    {
+        JobPoolRun(draw_tiles, NULL);
+    }
+    else
+    {
+        draw_tiles(NULL, 0);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include "arena.h"
+#include "graphics_types.h"
+
+// Note(Leo): CPU version of combined_shader.comp for machines without a usable vulkan driver and for rendering without a
+//            window. It draws the same combined_instance renderque the shader does, sampling glyphs and images out of
+//            its own copies of the atlases (laid out the same way as the gpu ones so atlas offsets mean the same thing).
+
+#define SOFTWARE_TILE_SIZE 64 // Screen tiles that get handed out to the job pool's threads
+
+// Returns false if the atlases could not be reserved
+bool InitializeSoftwareRenderer(uvec3 glyph_atlas_dimensions, uvec3 image_atlas_dimensions);
+
+// Glyph pixels are 1 byte, offsets are where the glyph's top left goes in the glyph atlas
+void SoftwareRendererUploadGlyph(void* glyph_data, int glyph_width, int glyph_height, uvec3 atlas_offsets);
+
+// Tile pixels are RGBA, 4 bytes each
+void SoftwareRendererUploadImageTile(void* tile_data, int tile_width, int tile_height, uvec3 atlas_offsets);
+
+// Draws the instances into pixels as 0xAARRGGBB, pitch is in pixels. Blocks until the whole frame is drawn.
+// If tiles is given only those tiles (packed like CollectDirtyTiles, SOFTWARE_TILE_SIZE tiles) are drawn and the rest of
+// pixels is left as it was.
+void SoftwareRendererDraw(combined_instance* instances, uint32_t instance_count, uint32_t width, uint32_t height, uint32_t* pixels, uint32_t pitch, 
+                          uint32_t* tiles = NULL, uint32_t tile_count = 0);
@@ -0,0 +1,271 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#define SIMD_IMPLEMENTATION 1
+#include "../simd.h"
+#include "../DOM.h"
+#include "../dom_attatchment.h"
+
+// Note(Leo): Standalone checks for element counting and compaction while an each churns, built and run by build_tests.sh.
+//            Links against DOM.cpp so everything it gets from the compiled project is stubbed out below.
+
+Runtime runtime;
+
+int failed_checks = 0;
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+void check(bool condition, const char* expression, int line)
+{
+    if(!condition)
+    {
+        printf("FAILED (line %d): %s\n", line, expression);
+        failed_checks++;
+    }
+}
+
+// Page laid out like a loaded file, static tags first then the template tags and a zeroed divider:
+// ROOT -> VDIV -> EACH, template 1 is a VDIV holding a TEXT
+Compiler::Tag page_tags[6];
+LoadedFileHandle page_handle;
+
+LoadedFileHandle* GetFileFromId(int id)
+{
+    return id == 1 ? &page_handle : NULL;
+}
+
+SelectorVariants* GetClassStyles(int selector_id)
+{
+    return NULL;
+}
+
+void call_page_main(DOM* dom, int file_id, void** d_void_target)
+{
+    *d_void_target = calloc(1, sizeof(Page));
+}
+
+void call_comp_main(DOM* dom, int file_id, void** d_void_target, CustomArgs* ARGS)
+{
+    *d_void_target = calloc(1, sizeof(Component));
+}
+
+void call_comp_event(DOM* dom, Event* event, int file_id, void* d_void)
+{
+}
+
+void setup_page()
+{
+    Compiler::Tag* root = &page_tags[0];
+    Compiler::Tag* list = &page_tags[1];
+    Compiler::Tag* each = &page_tags[2];
+    Compiler::Tag* item = &page_tags[3];
+    Compiler::Tag* text = &page_tags[4];
+
+    root->type = Compiler::TagType::ROOT;
+    root->tag_id = 1;
+    root->first_child = list;
+
+    list->type = Compiler::TagType::VDIV;
+    list->tag_id = 2;
+    list->parent = root;
+    list->first_child = each;
+
+    each->type = Compiler::TagType::EACH;
+    each->tag_id = 3;
+    each->parent = list;
+
+    // Note(Leo): Template tag ids start again from 1 like the parser assigns them
+    item->type = Compiler::TagType::VDIV;
+    item->tag_id = 1;
+    item->first_child = text;
+
+    text->type = Compiler::TagType::TEXT;
+    text->tag_id = 2;
+    text->parent = item;
+
+    page_handle.file_id = 1;
+    page_handle.root_tag = root;
+    page_handle.file_info.tag_count = 5;
+    page_handle.file_info.static_tag_count = 3;
+    page_handle.file_info.template_count = 1;
+
+    runtime.loaded_templates = (Arena*)calloc(1, sizeof(Arena));
+    *runtime.loaded_templates = CreateArena(sizeof(BodyTemplate)*16, sizeof(BodyTemplate));
+    BodyTemplate* body_template = (BodyTemplate*)Alloc(runtime.loaded_templates, sizeof(BodyTemplate), zero());
+    body_template->id = 1;
+    body_template->first_tag = item;
+    body_template->tag_count = 2;
+    page_handle.first_template = body_template;
+}
+
+uint32_t element_span(DOM* dom)
+{
+    return (uint32_t)((dom->elements->next_address - dom->elements->mapped_address)/sizeof(Element));
+}
+
+Element* find_each(DOM* dom)
+{
+    Element* root = (Element*)dom->elements->mapped_address;
+    return root->first_child->first_child;
+}
+
+// Frees every instance whose index isnt a multiple of kept_every and relinks the survivors, like ReconcileEach does
+void remove_instances(DOM* dom, Element* each, int kept_every)
+{
+    Element* curr = each->first_child;
+    Element* last_kept = NULL;
+    each->first_child = NULL;
+
+    while(curr)
+    {
+        Element* next = curr->next_sibling;
+        if(curr->context_index % kept_every == 0)
+        {
+            curr->next_sibling = NULL;
+            if(last_kept)
+            {
+                last_kept->next_sibling = curr;
+            }
+            else
+            {
+                each->first_child = curr;
+            }
+            last_kept = curr;
+        }
+        else
+        {
+            FreeSubtreeObjects(curr, dom);
+        }
+        curr = next;
+    }
+}
+
+int count_instances(Element* each)
+{
+    int count = 0;
+    for(Element* curr = each->first_child; curr; curr = curr->next_sibling)
+    {
+        count++;
+    }
+    return count;
+}
+
+bool instances_intact(Element* each)
+{
+    for(Element* curr = each->first_child; curr; curr = curr->next_sibling)
+    {
+        if(curr->parent != each || !curr->first_child || curr->first_child->parent != curr)
+        {
+            return false;
+        }
+        if(curr->first_child->type != ElementType::TEXT || curr->first_child->first_child)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_page_live_count(DOM* dom)
+{
+    InstancePage(dom, 1);
+
+    // Template tags sit after the static ones but only get elements when the each instances them
+    CHECK(dom->live_element_count == 3);
+    CHECK(element_span(dom) == 3);
+
+    Element* each = find_each(dom);
+    CHECK(each->type == ElementType::EACH);
+    CHECK(!each->first_child);
+}
+
+// Virtual eaches lay out a spacer for each side that has space, the layout is sized off of this count
+void test_each_spacer_count(DOM* dom)
+{
+    Element* each = find_each(dom);
+
+    SetEachSpace(dom, each, 40.0f, 0.0f);
+    CHECK(dom->layout_spacer_count == 1);
+
+    SetEachSpace(dom, each, 40.0f, 80.0f);
+    SetEachSpace(dom, each, 20.0f, 80.0f);
+    CHECK(dom->layout_spacer_count == 2);
+
+    InvalidateEach(each, dom);
+    CHECK(dom->layout_spacer_count == 0);
+    CHECK(each->Each.leading_space == 0.0f && each->Each.trailing_space == 0.0f);
+}
+
+void test_each_churn(DOM* dom)
+{
+    Element* each = find_each(dom);
+
+    // Grow the each, shrink it back down and grow it again so the arena ends up mostly holes
+    for(int round = 0; round < 3; round++)
+    {
+        for(int i = 0; i < 3000; i++)
+        {
+            InstanceTemplate(dom, each, NULL, 1, round*3000 + i);
+        }
+        remove_instances(dom, each, 50);
+    }
+
+    int instance_count = count_instances(each);
+    CHECK(instance_count == 180);
+    CHECK(dom->live_element_count == (uint32_t)(3 + instance_count*2));
+
+    uint32_t span_before = element_span(dom);
+    CHECK(span_before > dom->live_element_count);
+
+    CHECK(ShouldCompactElements(dom));
+    CHECK(CompactElements(dom));
+
+    // Pointers were relocated so the each has to be found again
+    each = find_each(dom);
+    CHECK(element_span(dom) == dom->live_element_count);
+    CHECK(element_span(dom) < span_before);
+    CHECK(count_instances(each) == instance_count);
+    CHECK(instances_intact(each));
+    CHECK(!ShouldCompactElements(dom));
+
+    // Element ids are their slot after compacting
+    Element* base = (Element*)dom->elements->mapped_address;
+    for(uint32_t i = 0; i < dom->live_element_count; i++)
+    {
+        if(base[i].id != (int)i)
+        {
+            CHECK(base[i].id == (int)i);
+            break;
+        }
+    }
+
+    // New instances keep going from the compacted end
+    InstanceTemplate(dom, each, NULL, 1, 9000);
+    CHECK(element_span(dom) == dom->live_element_count);
+    CHECK(instances_intact(each));
+}
+
+int main()
+{
+    SimdDetectSupport();
+    InitScratch(sizeof(char)*100000);
+
+    Arena master_arena = CreateArena(100000, sizeof(char));
+    DOM* dom = (DOM*)Alloc(&master_arena, sizeof(DOM), zero());
+    InitDOM(&master_arena, dom);
+
+    setup_page();
+
+    test_page_live_count(dom);
+    test_each_spacer_count(dom);
+    test_each_churn(dom);
+
+    if(failed_checks)
+    {
+        printf("%d element compaction checks failed\n", failed_checks);
+        return 1;
+    }
+
+    printf("All element compaction checks passed\n");
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "../tile_binning.h"
+
+// Note(Leo): Standalone checks for the cpu side of tile binning and damage tracking, built and run by build_tests.sh.
+//            Doesnt use assert so it still checks everything in release builds.
+
+int failed_checks = 0;
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+void check(bool condition, const char* expression, int line)
+{
+    if(!condition)
+    {
+        printf("FAILED (line %d): %s\n", line, expression);
+        failed_checks++;
+    }
+}
+
+combined_instance make_instance(float left, float top, float right, float bottom)
+{
+    // Note(Leo): Zeroed like the renderque does so that padding compares equal in DamageTiles
+    combined_instance instance;
+    memset(&instance, 0, sizeof(combined_instance));
+    instance.bounds.r = left;
+    instance.bounds.g = top;
+    instance.bounds.b = right;
+    instance.bounds.a = bottom;
+
+    return instance;
+}
+
+uint32_t tile_length(TileBins* bins, uint32_t tile)
+{
+    return bins->offsets[tile + 1] - bins->offsets[tile];
+}
+
+bool tile_holds(TileBins* bins, uint32_t tile, uint32_t instance)
+{
+    for(uint32_t i = bins->offsets[tile]; i < bins->offsets[tile + 1]; i++)
+    {
+        if(bins->indices[i] == instance)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// 256x128 with 64 pixel tiles is 4 columns by 2 rows
+void test_tile_edges()
+{
+    combined_instance instances[] = {
+        make_instance(64.0f, 0.0f, 64.0f, 10.0f),     // Exactly on the left edge of column 1
+        make_instance(0.0f, 0.0f, 63.9f, 63.9f),      // Just inside tile 0
+        make_instance(63.0f, 63.0f, 64.0f, 64.0f),    // Touches the corner of 4 tiles (bounds are inclusive)
+        make_instance(255.0f, 127.0f, 255.0f, 127.0f),// Last pixel
+        make_instance(200.0f, 0.0f, 1000.0f, 10.0f),  // Runs past the right edge
+    };
+
+    uint32_t target[256];
+    TileBins bins = {};
+    uint32_t written = BinInstances(instances, 5, 256, 128, 64, target, 256, &bins);
+
+    CHECK(written != 0);
+    CHECK(bins.columns == 4 && bins.rows == 2);
+    CHECK(written == 4*2 + 1 + bins.index_count);
+
+    CHECK(tile_length(&bins, 1) == 2 && tile_holds(&bins, 1, 0) && tile_holds(&bins, 1, 2));
+    CHECK(tile_holds(&bins, 0, 1) && tile_holds(&bins, 0, 2) && !tile_holds(&bins, 0, 0));
+    CHECK(tile_holds(&bins, 4, 2) && tile_holds(&bins, 5, 2) && !tile_holds(&bins, 6, 2));
+    CHECK(tile_length(&bins, 7) == 1 && tile_holds(&bins, 7, 3));
+    CHECK(tile_holds(&bins, 3, 4) && !tile_holds(&bins, 2, 4));
+    CHECK(bins.index_count == 1 + 1 + 4 + 1 + 1); // Instance 0 once, 1 once, 2 four times, 3 once and 4 once
+}
+
+void test_rejected_bounds()
+{
+    float nan = std::nanf("");
+    combined_instance instances[] = {
+        make_instance(-20.0f, -20.0f, -1.0f, -1.0f),  // Entirely off the top left
+        make_instance(300.0f, 0.0f, 400.0f, 10.0f),   // Entirely off the right
+        make_instance(0.0f, 128.0f, 10.0f, 200.0f),   // Starts on the first row past the bottom
+        make_instance(nan, 0.0f, 10.0f, 10.0f),
+        make_instance(0.0f, 0.0f, nan, 10.0f),
+        make_instance(50.0f, 0.0f, 10.0f, 10.0f),     // Inverted
+        make_instance(-10.0f, -10.0f, 5.0f, 5.0f),    // Partially on screen, only this one is kept
+    };
+
+    uint32_t target[256];
+    TileBins bins = {};
+    uint32_t written = BinInstances(instances, 7, 256, 128, 64, target, 256, &bins);
+
+    CHECK(written == 4*2 + 1 + 1);
+    CHECK(bins.index_count == 1);
+    CHECK(tile_length(&bins, 0) == 1 && tile_holds(&bins, 0, 6));
+}
+
+void test_renderque_order()
+{
+    combined_instance instances[] = {
+        make_instance(0.0f, 0.0f, 100.0f, 100.0f),
+        make_instance(70.0f, 0.0f, 80.0f, 10.0f),     // Only tile 1
+        make_instance(10.0f, 10.0f, 20.0f, 20.0f),
+        make_instance(0.0f, 0.0f, 255.0f, 127.0f),
+        make_instance(30.0f, 30.0f, 40.0f, 40.0f),
+    };
+
+    uint32_t target[256];
+    TileBins bins = {};
+    CHECK(BinInstances(instances, 5, 256, 128, 64, target, 256, &bins) != 0);
+
+    uint32_t expected_first[] = { 0, 2, 3, 4 };
+    CHECK(tile_length(&bins, 0) == 4);
+    for(uint32_t i = 0; i < 4 && i < tile_length(&bins, 0); i++)
+    {
+        CHECK(bins.indices[bins.offsets[0] + i] == expected_first[i]);
+    }
+
+    uint32_t expected_second[] = { 0, 1, 3 };
+    CHECK(tile_length(&bins, 1) == 3);
+    for(uint32_t i = 0; i < 3 && i < tile_length(&bins, 1); i++)
+    {
+        CHECK(bins.indices[bins.offsets[1] + i] == expected_second[i]);
+    }
+}
+
+void test_capacity_overflow()
+{
+    combined_instance instance = make_instance(0.0f, 0.0f, 255.0f, 127.0f);
+    uint32_t target[256];
+
+    // Offsets alone dont fit
+    CHECK(BinInstances(&instance, 1, 256, 128, 64, target, 8, NULL) == 0);
+
+    // Offsets fit but the 8 indices dont
+    CHECK(BinInstances(&instance, 1, 256, 128, 64, target, 9, NULL) == 0);
+    CHECK(BinInstances(&instance, 1, 256, 128, 64, target, 16, NULL) == 0);
+
+    // Exactly enough
+    CHECK(BinInstances(&instance, 1, 256, 128, 64, target, 17, NULL) == 17);
+
+    // Nothing to bin still needs the offsets
+    CHECK(BinInstances(NULL, 0, 256, 128, 64, target, 9, NULL) == 9);
+}
+
+void test_damage_tiles()
+{
+    combined_instance last[] = {
+        make_instance(0.0f, 0.0f, 10.0f, 10.0f),
+        make_instance(70.0f, 0.0f, 80.0f, 10.0f),
+        make_instance(140.0f, 70.0f, 150.0f, 80.0f),
+    };
+    combined_instance curr[] = {
+        make_instance(0.0f, 0.0f, 10.0f, 10.0f),      // Unchanged
+        make_instance(200.0f, 0.0f, 210.0f, 10.0f),   // Moved from tile 1 to tile 3
+        make_instance(140.0f, 70.0f, 150.0f, 80.0f),  // Unchanged
+        make_instance(10.0f, 70.0f, 20.0f, 80.0f),    // Added in tile 4
+    };
+
+    uint8_t dirty[8] = {};
+    DamageTiles(last, 3, last, 3, 256, 128, 64, dirty);
+    uint8_t clean[8] = {};
+    CHECK(memcmp(dirty, clean, 8) == 0);
+
+    DamageTiles(last, 3, curr, 4, 256, 128, 64, dirty);
+    uint8_t expected[8] = { 0, 1, 0, 1, 1, 0, 0, 0 };
+    CHECK(memcmp(dirty, expected, 8) == 0);
+
+    // Removing an instance dirties where it was, dirty is only ever added to
+    DamageTiles(curr, 3, curr, 2, 256, 128, 64, dirty);
+    uint8_t expected_removed[8] = { 0, 1, 0, 1, 1, 0, 1, 0 };
+    CHECK(memcmp(dirty, expected_removed, 8) == 0);
+
+    // Changes that arent in the bounds still dirty the tiles the instance covers
+    combined_instance recolored = last[0];
+    recolored.corners.r = 1.0f;
+    uint8_t dirty_recolor[8] = {};
+    DamageTiles(last, 1, &recolored, 1, 256, 128, 64, dirty_recolor);
+    CHECK(dirty_recolor[0] == 1 && dirty_recolor[1] == 0);
+}
+
+void test_collect_dirty_tiles()
+{
+    uint8_t dirty[6] = { 1, 0, 0,
+                         0, 1, 1 };
+    uint32_t tiles[6];
+    uint32_t count = CollectDirtyTiles(dirty, 3, 2, tiles);
+
+    CHECK(count == 3);
+    CHECK(dirty_tile_column(tiles[0]) == 0 && dirty_tile_row(tiles[0]) == 0);
+    CHECK(dirty_tile_column(tiles[1]) == 1 && dirty_tile_row(tiles[1]) == 1);
+    CHECK(dirty_tile_column(tiles[2]) == 2 && dirty_tile_row(tiles[2]) == 1);
+}
+
+// 150x100 with 64 pixel tiles leaves a 22 pixel last column and a 36 pixel last row
+void test_collect_dirty_rects()
+{
+    uint8_t dirty[6] = { 0, 1, 1,
+                         1, 0, 1 };
+    DirtyRect rects[6];
+    uint32_t count = CollectDirtyRects(dirty, 150, 100, 64, rects);
+
+    CHECK(count == 3);
+
+    // Run across the partial last column gets merged and clipped
+    CHECK(rects[0].x == 64 && rects[0].y == 0 && rects[0].width == 86 && rects[0].height == 64);
+
+    // Partial last row
+    CHECK(rects[1].x == 0 && rects[1].y == 64 && rects[1].width == 64 && rects[1].height == 36);
+    CHECK(rects[2].x == 128 && rects[2].y == 64 && rects[2].width == 22 && rects[2].height == 36);
+
+    uint8_t none[6] = {};
+    CHECK(CollectDirtyRects(none, 150, 100, 64, rects) == 0);
+
+    uint8_t all[6] = { 1, 1, 1, 1, 1, 1 };
+    CHECK(CollectDirtyRects(all, 150, 100, 64, rects) == 2);
+    CHECK(rects[0].width == 150 && rects[1].height == 36);
+}
+
+int main()
+{
+    test_tile_edges();
+    test_rejected_bounds();
+    test_renderque_order();
+    test_capacity_overflow();
+    test_damage_tiles();
+    test_collect_dirty_tiles();
+    test_collect_dirty_rects();
+
+    if(failed_checks)
+    {
+        printf("%d tile binning checks failed\n", failed_checks);
+        return 1;
+    }
+
+    printf("All tile binning checks passed\n");
+    return 0;
+}
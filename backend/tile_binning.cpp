@@ -0,0 +1,228 @@
+#include <cassert>
+#include <cstring>
+#include "tile_binning.h"
+
+struct tile_range
+{
+    uint32_t first_column;
+    uint32_t last_column;
+    uint32_t first_row;
+    uint32_t last_row;
+};
+
+// Returns false if the instance does not touch any tile
+bool get_tile_range(combined_instance* instance, uint32_t columns, uint32_t rows, uint32_t tile_size, tile_range* range)
+{
+    // Note(Leo): Bounds are inclusive on both sides (see point_inside_bounds in the shader)
+    float left = instance->bounds.r;
+    float top = instance->bounds.g;
+    float right = instance->bounds.b;
+    float bottom = instance->bounds.a;
+    
+    // Note(Leo): Also catches NaN bounds since every comparison with them fails
+    if(!(left <= right && top <= bottom) || right < 0.0f || bottom < 0.0f)
+    {
+        return false;
+    }
+    
+    float max_x = (float)(columns*tile_size);
+    float max_y = (float)(rows*tile_size);
+    if(left >= max_x || top >= max_y)
+    {
+        return false;
+    }
+    
+    left = left < 0.0f ? 0.0f : left;
+    top = top < 0.0f ? 0.0f : top;
+    
+    range->first_column = (uint32_t)left / tile_size;
+    range->first_row = (uint32_t)top / tile_size;
+    range->last_column = right >= max_x ? columns - 1 : (uint32_t)right / tile_size;
+    range->last_row = bottom >= max_y ? rows - 1 : (uint32_t)bottom / tile_size;
+    
+    return true;
+}
+
+uint32_t BinInstances(combined_instance* instances, uint32_t instance_count, uint32_t width, uint32_t height, uint32_t tile_size, 
+                      uint32_t* target, uint32_t target_capacity, TileBins* bins)
+{
+    assert(tile_size);
+    
+    uint32_t columns = (width + tile_size - 1) / tile_size;
+    uint32_t rows = (height + tile_size - 1) / tile_size;
+    uint32_t tile_count = columns*rows;
+    
+    if(tile_count + 1 > target_capacity)
+    {
+        return 0;
+    }
+    
+    uint32_t* offsets = target;
+    uint32_t* indices = target + tile_count + 1;
+    for(uint32_t i = 0; i <= tile_count; i++)
+    {
+        offsets[i] = 0;
+    }
+    
+    // Count pass
+    tile_range range;
+    for(uint32_t i = 0; i < instance_count; i++)
+    {
+        if(!get_tile_range(instances + i, columns, rows, tile_size, &range))
+        {
+            continue;
+        }
+        
+        for(uint32_t row = range.first_row; row <= range.last_row; row++)
+        {
+            for(uint32_t column = range.first_column; column <= range.last_column; column++)
+            {
+                offsets[row*columns + column]++;
+            }
+        }
+    }
+    
+    // Note(Leo): Inclusive prefix sum so each offset ends up at the end of its tile's list
+    uint32_t index_count = 0;
+    for(uint32_t i = 0; i < tile_count; i++)
+    {
+        index_count += offsets[i];
+        offsets[i] = index_count;
+    }
+    offsets[tile_count] = index_count;
+    
+    if((uint64_t)tile_count + 1 + index_count > target_capacity)
+    {
+        return 0;
+    }
+    
+    // Note(Leo): Filling back to front while counting each offset down keeps the lists in renderque order and leaves
+    //            every offset at the start of its tile's list.
+    for(uint32_t i = instance_count; i > 0; i--)
+    {
+        if(!get_tile_range(instances + i - 1, columns, rows, tile_size, &range))
+        {
+            continue;
+        }
+        
+        for(uint32_t row = range.first_row; row <= range.last_row; row++)
+        {
+            for(uint32_t column = range.first_column; column <= range.last_column; column++)
+            {
+                indices[--offsets[row*columns + column]] = i - 1;
+            }
+        }
+    }
+    
+    if(bins)
+    {
+        bins->columns = columns;
+        bins->rows = rows;
+        bins->offsets = offsets;
+        bins->indices = indices;
+        bins->index_count = index_count;
+    }
+    
+    return tile_count + 1 + index_count;
+}
+
+void damage_instance(combined_instance* instance, uint32_t columns, uint32_t rows, uint32_t tile_size, uint8_t* dirty)
+{
+    tile_range range;
+    if(!get_tile_range(instance, columns, rows, tile_size, &range))
+    {
+        return;
+    }
+    
+    for(uint32_t row = range.first_row; row <= range.last_row; row++)
+    {
+        for(uint32_t column = range.first_column; column <= range.last_column; column++)
+        {
+            dirty[row*columns + column] = 1;
+        }
+    }
+}
+
+void DamageTiles(combined_instance* last, uint32_t last_count, combined_instance* curr, uint32_t curr_count, 
+                 uint32_t width, uint32_t height, uint32_t tile_size, uint8_t* dirty)
+{
+    assert(tile_size);
+    
+    uint32_t columns = (width + tile_size - 1) / tile_size;
+    uint32_t rows = (height + tile_size - 1) / tile_size;
+    
+    // Note(Leo): A changed instance dirties where it was and where it is now. Instances are zeroed as they are added so
+    //            their padding compares equal.
+    uint32_t shared_count = last_count < curr_count ? last_count : curr_count;
+    for(uint32_t i = 0; i < shared_count; i++)
+    {
+        if(memcmp(last + i, curr + i, sizeof(combined_instance)) == 0)
+        {
+            continue;
+        }
+        damage_instance(last + i, columns, rows, tile_size, dirty);
+        damage_instance(curr + i, columns, rows, tile_size, dirty);
+    }
+    
+    for(uint32_t i = shared_count; i < last_count; i++)
+    {
+        damage_instance(last + i, columns, rows, tile_size, dirty);
+    }
+    for(uint32_t i = shared_count; i < curr_count; i++)
+    {
+        damage_instance(curr + i, columns, rows, tile_size, dirty);
+    }
+}
+
+uint32_t CollectDirtyTiles(uint8_t* dirty, uint32_t columns, uint32_t rows, uint32_t* target)
+{
+    uint32_t count = 0;
+    for(uint32_t row = 0; row < rows; row++)
+    {
+        for(uint32_t column = 0; column < columns; column++)
+        {
+            if(dirty[row*columns + column])
+            {
+                target[count++] = column | (row << 16);
+            }
+        }
+    }
+    
+    return count;
+}
+
+uint32_t CollectDirtyRects(uint8_t* dirty, uint32_t width, uint32_t height, uint32_t tile_size, DirtyRect* target)
+{
+    assert(tile_size);
+    
+    uint32_t columns = (width + tile_size - 1) / tile_size;
+    uint32_t rows = (height + tile_size - 1) / tile_size;
+    
+    uint32_t count = 0;
+    for(uint32_t row = 0; row < rows; row++)
+    {
+        uint32_t column = 0;
+        while(column < columns)
+        {
+            if(!dirty[row*columns + column])
+            {
+                column++;
+                continue;
+            }
+            
+            uint32_t first_column = column;
+            while(column < columns && dirty[row*columns + column])
+            {
+                column++;
+            }
+            
+            DirtyRect* rect = target + count++;
+            rect->x = first_column*tile_size;
+            rect->y = row*tile_size;
+            rect->width = (column*tile_size < width ? column*tile_size : width) - rect->x;
+            rect->height = ((row + 1)*tile_size < height ? (row + 1)*tile_size : height) - rect->y;
+        }
+    }
+    
+    return count;
+}
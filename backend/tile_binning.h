@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include "graphics_types.h"
+
+// Note(Leo): Binning splits the screen into tile_size*tile_size tiles (the render tiles of the combined shader) and builds
+//            a list for each tile of the instances whose bounds overlap it, in renderque order so blending stays the same.
+//            The lists are written as one block of uint32_t's:
+//            [offsets: tile_count + 1][indices]
+//            Tile t's instances are indices[offsets[t]] up to indices[offsets[t + 1]], tiles are row major.
+struct TileBins
+{
+    uint32_t columns;
+    uint32_t rows;
+    uint32_t* offsets;
+    uint32_t* indices;
+    uint32_t index_count;
+};
+
+// Returns the number of uint32_t's written to target or 0 if the bins did not fit in target_capacity uint32_t's.
+// width and height are in the same space as the instance bounds.
+uint32_t BinInstances(combined_instance* instances, uint32_t instance_count, uint32_t width, uint32_t height, uint32_t tile_size, 
+                      uint32_t* target, uint32_t target_capacity, TileBins* bins = NULL);
+
+// Note(Leo): Damage is tracked in the same tiles, a tile is dirty when an instance that changed between two renderques
+//            overlaps it. Instances are matched up by their index so anything inserted or removed dirties every tile
+//            touched by the instances after it, which is still correct just not as tight.
+struct DirtyRect
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+#define dirty_tile_column(packed_tile) ((packed_tile) & 0xFFFF)
+#define dirty_tile_row(packed_tile) ((packed_tile) >> 16)
+
+// Sets dirty[tile] for every tile the changed instances overlap, dirty is never cleared so damage can be accumulated
+void DamageTiles(combined_instance* last, uint32_t last_count, combined_instance* curr, uint32_t curr_count, 
+                 uint32_t width, uint32_t height, uint32_t tile_size, uint8_t* dirty);
+
+// Writes each dirty tile as column | row << 16, target needs room for every tile. Returns the number written.
+uint32_t CollectDirtyTiles(uint8_t* dirty, uint32_t columns, uint32_t rows, uint32_t* target);
+
+// Merges runs of dirty tiles along each row into rects clipped to width*height, target needs room for columns*rows rects.
+// Returns the number written.
+uint32_t CollectDirtyRects(uint8_t* dirty, uint32_t width, uint32_t height, uint32_t tile_size, DirtyRect* target);
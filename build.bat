@@ -14,10 +14,10 @@ set dep_dir=..\backend\third_party
 set src_dir=..\backend
 
 :: Debug build
-cl -arch:AVX2 /MP12 /Zi /Od /I. /I%dep_dir%\vulkan\Vulkan-Headers-1.4.317\include /I%dep_dir%\freetype\freetype-2.13.3\include -DFT2_BUILD_LIBRARY /EHsc /c %src_dir%\freetype_module.cpp %src_dir%\compiler.cpp %src_dir%\lexer.cpp %src_dir%\parser.cpp %src_dir%\arena.cpp %src_dir%\arena_string.cpp %src_dir%\prepass.cpp %src_dir%\codegen.cpp %src_dir%\runtime.cpp %src_dir%\DOM.cpp %src_dir%\file_system.cpp %src_dir%\platform_windows.cpp %src_dir%\platform_vulkan.cpp %src_dir%\platform_font.cpp %src_dir%\harfbuzz_module.cpp %src_dir%\shaping_platform.cpp 
+cl -arch:AVX2 /MP12 /Zi /Od /I. /I%dep_dir%\vulkan\Vulkan-Headers-1.4.317\include /I%dep_dir%\freetype\freetype-2.13.3\include -DFT2_BUILD_LIBRARY /EHsc /c %src_dir%\freetype_module.cpp %src_dir%\compiler.cpp %src_dir%\lexer.cpp %src_dir%\parser.cpp %src_dir%\arena.cpp %src_dir%\arena_string.cpp %src_dir%\prepass.cpp %src_dir%\codegen.cpp %src_dir%\runtime.cpp %src_dir%\DOM.cpp %src_dir%\file_system.cpp %src_dir%\platform_windows.cpp %src_dir%\platform_vulkan.cpp %src_dir%\platform_font.cpp %src_dir%\harfbuzz_module.cpp %src_dir%\shaping_platform.cpp %src_dir%\tile_binning.cpp %src_dir%\software_renderer.cpp %src_dir%\job_pool.cpp 
 
 :: Release build
-::cl /DNDEBUG -arch:AVX2 /MP12 /O2t /GL /I. /I%dep_dir%\vulkan\Vulkan-Headers-1.4.317\include /I%dep_dir%\freetype\freetype-2.13.3\include -DFT2_BUILD_LIBRARY /EHsc /c %src_dir%\freetype_module.cpp %src_dir%\compiler.cpp %src_dir%\lexer.cpp %src_dir%\parser.cpp %src_dir%\arena.cpp %src_dir%\arena_string.cpp %src_dir%\prepass.cpp %src_dir%\codegen.cpp %src_dir%\runtime.cpp %src_dir%\DOM.cpp %src_dir%\file_system.cpp %src_dir%\platform_windows.cpp %src_dir%\platform_vulkan.cpp %src_dir%\platform_font.cpp %src_dir%\harfbuzz_module.cpp %src_dir%\shaping_platform.cpp 
+::cl /DNDEBUG -arch:AVX2 /MP12 /O2t /GL /I. /I%dep_dir%\vulkan\Vulkan-Headers-1.4.317\include /I%dep_dir%\freetype\freetype-2.13.3\include -DFT2_BUILD_LIBRARY /EHsc /c %src_dir%\freetype_module.cpp %src_dir%\compiler.cpp %src_dir%\lexer.cpp %src_dir%\parser.cpp %src_dir%\arena.cpp %src_dir%\arena_string.cpp %src_dir%\prepass.cpp %src_dir%\codegen.cpp %src_dir%\runtime.cpp %src_dir%\DOM.cpp %src_dir%\file_system.cpp %src_dir%\platform_windows.cpp %src_dir%\platform_vulkan.cpp %src_dir%\platform_font.cpp %src_dir%\harfbuzz_module.cpp %src_dir%\shaping_platform.cpp %src_dir%\tile_binning.cpp %src_dir%\software_renderer.cpp %src_dir%\job_pool.cpp 
 
 IF %ERRORLEVEL% NEQ 0 (
 	echo:
@@ -26,7 +26,7 @@ IF %ERRORLEVEL% NEQ 0 (
 )
 
 :: Link the .lib
-lib /nologo /out:runtime.lib freetype_module.obj runtime.obj arena.obj arena_string.obj DOM.obj platform_windows.obj platform_vulkan.obj file_system.obj platform_font.obj harfbuzz_module.obj shaping_platform.obj
+lib /nologo /out:runtime.lib freetype_module.obj runtime.obj arena.obj arena_string.obj DOM.obj platform_windows.obj platform_vulkan.obj file_system.obj platform_font.obj harfbuzz_module.obj shaping_platform.obj tile_binning.obj software_renderer.obj job_pool.obj
 xcopy /y /s runtime.lib ..\test_build
 
 :: Link the compiler .exe
@@ -10,7 +10,7 @@ src_dir="../backend"
 g++ -g -c -I$dep_dir/vulkan/Vulkan-Headers-1.4.317/include -I$dep_dir/freetype/freetype-2.13.3/include -DFT2_BUILD_LIBRARY $src_dir/*.cpp
 
 ## Link the library ##
-ar rvs runtime.a freetype_module.o runtime.o arena.o arena_string.o DOM.o platform_linux.o platform_vulkan.o file_system.o platform_font.o harfbuzz_module.o shaping_platform.o
+ar rvs runtime.a freetype_module.o runtime.o arena.o arena_string.o DOM.o platform_linux.o platform_vulkan.o file_system.o platform_font.o harfbuzz_module.o shaping_platform.o tile_binning.o software_renderer.o job_pool.o
 
 ## Link the compiler executable ##
 g++ -g -o compiler compiler.o lexer.o parser.o arena.o arena_string.o prepass.o codegen.o file_system.o
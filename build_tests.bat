@@ -0,0 +1,42 @@
+@echo off
+pushd %~dp0
+
+if not exist build mkdir build
+pushd build
+set dep_dir=..\backend\third_party
+set src_dir=..\backend
+
+:: Tile binning / damage tracking
+cl /nologo /Zi /Od /I%dep_dir%\vulkan\Vulkan-Headers-1.4.317\include /EHsc /Fe:tile_binning_test.exe %src_dir%\tests\tile_binning_test.cpp %src_dir%\tile_binning.cpp
+IF %ERRORLEVEL% NEQ 0 (
+	echo:
+	echo Compile error...
+	popd
+	popd
+	EXIT /B 1
+)
+
+tile_binning_test.exe
+set test_result=%ERRORLEVEL%
+IF %test_result% NEQ 0 (
+	popd
+	popd
+	EXIT /B %test_result%
+)
+
+:: Element counting / compaction
+cl /nologo /Zi /Od -arch:AVX2 /I%dep_dir%\vulkan\Vulkan-Headers-1.4.317\include /EHsc /Fe:element_compaction_test.exe %src_dir%\tests\element_compaction_test.cpp %src_dir%\DOM.cpp %src_dir%\arena.cpp %src_dir%\arena_string.cpp
+IF %ERRORLEVEL% NEQ 0 (
+	echo:
+	echo Compile error...
+	popd
+	popd
+	EXIT /B 1
+)
+
+element_compaction_test.exe
+set test_result=%ERRORLEVEL%
+
+popd
+popd
+EXIT /B %test_result%
@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+cd "$(dirname "$0")"
+
+mkdir -p build
+cd build
+
+dep_dir="../backend/third_party"
+src_dir="../backend"
+
+## Tile binning / damage tracking ##
+g++ -g -I$dep_dir/vulkan/Vulkan-Headers-1.4.317/include -o tile_binning_test $src_dir/tests/tile_binning_test.cpp $src_dir/tile_binning.cpp || exit 1
+./tile_binning_test || exit 1
+
+## Element counting / compaction ##
+g++ -g -mavx2 -I$dep_dir/vulkan/Vulkan-Headers-1.4.317/include -o element_compaction_test $src_dir/tests/element_compaction_test.cpp $src_dir/DOM.cpp $src_dir/arena.cpp $src_dir/arena_string.cpp || exit 1
+./element_compaction_test